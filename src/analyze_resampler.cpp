@@ -19,121 +19,807 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "analyze_resampler.h"
 
+#include "bessel.h"
+#include "fft.h"
+#include "filter_bank_cache.h"
 #include "miscmath.h"
 #include "options.h"
 #include "resampler.h"
+#include "resampler_chain.h"
+#include "resampler_kernels.h"
+#include "string_helper.h"
 
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 
 #include <algorithm>
+#include <complex>
+#include <exception>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 
-void analyze_resampler() {
+// Number of test frequencies used by analyze_resampler.
+static constexpr uint32_t ANALYZE_FREQUENCIES = 480;
 
-	// create resampler
-	float ratio = (float) g_option_rate_in / (float) g_option_rate_out * 0.999f;
-	lowrider_resampler resampler(ratio, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain);
+// Number of samples between exact evaluations of the test oscillators.
+static constexpr uint32_t OSCILLATOR_RESYNC = 256;
+
+// Parameters of the chirp measurement: the length of the chirp (in output samples), the FFT frame size, the Kaiser window
+// parameter (which puts the sidelobes far below the errors of any resampler), the number of bins around the expected
+// frequency that are counted as signal (the main lobe of the window), and the number of frequency ranges in the printed
+// results.
+static constexpr uint32_t CHIRP_SAMPLES = 1 << 19;
+static constexpr uint32_t CHIRP_FRAME = 16384;
+static constexpr double CHIRP_WINDOW_BETA = 20.0;
+static constexpr uint32_t CHIRP_GUARD = 8;
+static constexpr uint32_t CHIRP_ROWS = 48;
+
+// Compares a fixed-point kernel against the scalar reference implementation using random data. The coefficients are small
+// enough to avoid overflow of the accumulator, but some outputs are saturated. Returns the largest difference.
+template<typename T, typename F>
+static int64_t verify_resampler_kernel_fixed_point(F firfilter, F firfilter_ref, uint32_t channels, uint32_t filter_length,
+												   uint32_t rows, const float *weights, std::mt19937 &rng) {
+	std::uniform_int_distribution<T> dist_data(std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+	T coef_max = (T) (std::numeric_limits<T>::max() / 264);
+	std::uniform_int_distribution<T> dist_coef(-coef_max, coef_max);
+	std::vector<T> coef(rows * filter_length), data(channels * filter_length);
+	for(T &v : coef) {
+		v = dist_coef(rng);
+	}
+	for(T &v : data) {
+		v = dist_data(rng);
+	}
+	std::vector<const T*> ptr_in(channels);
+	std::vector<T> out_ref(channels), out_test(channels);
+	std::vector<T*> ptr_ref(channels), ptr_test(channels);
+	for(uint32_t c = 0; c < channels; ++c) {
+		ptr_in[c] = data.data() + c * filter_length;
+		ptr_ref[c] = out_ref.data() + c;
+		ptr_test[c] = out_test.data() + c;
+	}
+	float scale = std::ldexp(1.0f, 4 - std::numeric_limits<T>::digits);
+	firfilter_ref(channels, filter_length, coef.data(), weights, scale, ptr_in.data(), 0, ptr_ref.data(), 0);
+	firfilter(channels, filter_length, coef.data(), weights, scale, ptr_in.data(), 0, ptr_test.data(), 0);
+	int64_t max_error = 0;
+	for(uint32_t c = 0; c < channels; ++c) {
+		max_error = std::max(max_error, std::abs((int64_t) out_test[c] - (int64_t) out_ref[c]));
+	}
+	return max_error;
+}
+
+// Reference conversions between device sample formats and float, equivalent to the scalar loops of the ALSA backend.
+static float reference_convert_in(lowrider_sample_format format, const uint8_t *ptr) {
+	switch(format) {
+		case lowrider_sample_format_f32: {
+			float x;
+			memcpy(&x, ptr, sizeof(x));
+			return x;
+		}
+		case lowrider_sample_format_s32:
+		case lowrider_sample_format_s24: {
+			int32_t x;
+			memcpy(&x, ptr, sizeof(x));
+			return (float) x * (float) ((format == lowrider_sample_format_s32)? 1.0 / 2147483648.0 : 1.0 / 8388608.0);
+		}
+		case lowrider_sample_format_s16: {
+			int16_t x;
+			memcpy(&x, ptr, sizeof(x));
+			return (float) x * (float) (1.0 / 32768.0);
+		}
+		case lowrider_sample_format_s24_3le: {
+			int32_t x = (int32_t) ((uint32_t) ptr[0] << 8 | (uint32_t) ptr[1] << 16 | (uint32_t) ptr[2] << 24) >> 8;
+			return (float) x * (float) (1.0 / 8388608.0);
+		}
+		default: assert(false);
+	}
+	return 0.0f;
+}
+static void reference_convert_out(lowrider_sample_format format, float value, uint8_t *ptr) {
+	switch(format) {
+		case lowrider_sample_format_f32: {
+			memcpy(ptr, &value, sizeof(value));
+			break;
+		}
+		case lowrider_sample_format_s32: {
+			int32_t x = rint32(clamp(value * 2147483648.0f, -2147483648.0f, 2147483520.0f));
+			memcpy(ptr, &x, sizeof(x));
+			break;
+		}
+		case lowrider_sample_format_s24: {
+			int32_t x = rint32(clamp(value * 8388608.0f, -8388608.0f, 8388607.0f));
+			memcpy(ptr, &x, sizeof(x));
+			break;
+		}
+		case lowrider_sample_format_s16: {
+			int16_t x = (int16_t) rint32(clamp(value * 32768.0f, -32768.0f, 32767.0f));
+			memcpy(ptr, &x, sizeof(x));
+			break;
+		}
+		case lowrider_sample_format_s24_3le: {
+			int32_t x = rint32(clamp(value * 8388608.0f, -8388608.0f, 8388607.0f));
+			ptr[0] = (uint8_t) x;
+			ptr[1] = (uint8_t) (x >> 8);
+			ptr[2] = (uint8_t) (x >> 16);
+			break;
+		}
+		default: assert(false);
+	}
+}
+
+// Compares the conversion kernels against the reference conversions using random data. The results must be identical.
+// The output data includes values that are out of range and values that are exactly halfway between two integers.
+static bool verify_sample_conversion(const lowrider_resampler_kernels &kernels, std::mt19937 &rng) {
+	std::uniform_int_distribution<uint32_t> dist_byte(0, 255);
+	std::uniform_real_distribution<float> dist(-1.25f, 1.25f);
+	for(uint32_t format = 1; format < lowrider_resampler_kernels::FORMAT_COUNT; ++format) {
+		uint32_t bytes = get_sample_format_bytes((lowrider_sample_format) format);
+		for(uint32_t channels : {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 16, 33}) {
+			lowrider_convert_in_func convert_in = kernels.convert_in[format][(channels <= lowrider_resampler_kernels::CONVERT_CHANNELS_MAX)? channels : 0];
+			lowrider_convert_out_func convert_out = kernels.convert_out[format][(channels <= lowrider_resampler_kernels::CONVERT_CHANNELS_MAX)? channels : 0];
+			for(uint32_t size : {0, 1, 3, 16, 37, 100}) {
+				uint32_t pos = channels % 3;
+
+				// generate random data
+				std::vector<uint8_t> device(channels * size * bytes);
+				for(uint8_t &v : device) {
+					v = (uint8_t) dist_byte(rng);
+				}
+				if(format == lowrider_sample_format_f32) {
+					for(uint32_t i = 0; i < channels * size; ++i) {
+						float x = dist(rng);
+						memcpy(device.data() + i * bytes, &x, sizeof(x));
+					}
+				}
+				std::vector<float> planar(channels * (pos + size));
+				std::vector<float*> ptr(channels);
+				for(uint32_t c = 0; c < channels; ++c) {
+					ptr[c] = planar.data() + c * (pos + size);
+				}
+
+				// convert to float
+				convert_in(channels, device.data(), ptr.data(), pos, size);
+				for(uint32_t i = 0; i < size; ++i) {
+					for(uint32_t c = 0; c < channels; ++c) {
+						if(ptr[c][pos + i] != reference_convert_in((lowrider_sample_format) format, device.data() + (i * channels + c) * bytes)) {
+							return false;
+						}
+					}
+				}
+
+				// convert back
+				for(uint32_t i = 0; i < size; ++i) {
+					for(uint32_t c = 0; c < channels; ++c) {
+						float x = dist(rng);
+						if((i + c) % 4 == 0) {
+							x = std::ldexp(std::round(std::ldexp(x, 15)) + 0.5f, -15);
+						}
+						ptr[c][pos + i] = x;
+					}
+				}
+				std::vector<uint8_t> device_test(device.size()), device_ref(device.size());
+				convert_out(channels, ptr.data(), pos, device_test.data(), size);
+				for(uint32_t i = 0; i < size; ++i) {
+					for(uint32_t c = 0; c < channels; ++c) {
+						reference_convert_out((lowrider_sample_format) format, ptr[c][pos + i], device_ref.data() + (i * channels + c) * bytes);
+					}
+				}
+				if(device_test != device_ref) {
+					return false;
+				}
+
+			}
+		}
+	}
+	return true;
+}
+
+// Compares a set of kernels against the scalar reference implementation using random data.
+// Returns the largest error relative to the sum of the absolute values of the products. Reading the rows backwards from a
+// reversed copy of the coefficients must produce exactly the same result as reading them normally. The 16-bit storage
+// formats are compared with the reference implementation for the same format, so the rounding of the coefficients
+// doesn't affect the result.
+static double verify_resampler_kernel(const lowrider_resampler_kernels &kernels) {
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	double max_error = 0.0;
+	for(uint32_t storage = 0; storage < lowrider_resampler_kernels::STORAGE_COUNT; ++storage) {
+		for(uint32_t interpolation = 0; interpolation < lowrider_resampler_kernels::INTERPOLATION_COUNT; ++interpolation) {
+			uint32_t rows = (interpolation == lowrider_resampler_interpolation_cubic)? 4 : (interpolation == lowrider_resampler_interpolation_none)? 1 : 2;
+			for(uint32_t channels : {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 16, 33}) {
+				for(uint32_t filter_length = 4; filter_length <= 132; filter_length += 4) {
+
+					// generate random data
+					uint32_t offset = channels % 3;
+					std::vector<float> coef(rows * filter_length), data(channels * (filter_length + offset));
+					for(float &v : coef) {
+						v = dist(rng);
+					}
+					std::vector<float> coef_reverse(coef.rbegin(), coef.rend());
+					std::vector<uint16_t> coef_half(coef.size());
+					for(size_t i = 0; i < coef.size(); ++i) {
+						coef_half[i] = (storage == lowrider_resampler_storage_f16)? float_to_f16(coef[i]) : float_to_bf16(coef[i]);
+					}
+					std::vector<uint16_t> coef_half_reverse(coef_half.rbegin(), coef_half.rend());
+					const void *coef_ptr = (storage == lowrider_resampler_storage_f32)? (const void*) coef.data() : (const void*) coef_half.data();
+					const void *coef_reverse_ptr = (storage == lowrider_resampler_storage_f32)? (const void*) (coef_reverse.data() + coef_reverse.size() - 1) :
+												   (const void*) (coef_half_reverse.data() + coef_half_reverse.size() - 1);
+					for(float &v : data) {
+						v = dist(rng);
+					}
+					float weights[4];
+					for(float &v : weights) {
+						v = 0.5f + 0.5f * dist(rng);
+					}
+					std::vector<const float*> ptr_in(channels);
+					for(uint32_t c = 0; c < channels; ++c) {
+						ptr_in[c] = data.data() + c * (filter_length + offset);
+					}
+
+					// run both kernels
+					std::vector<float> out_ref(channels), out_test(channels), out_reverse(channels);
+					std::vector<float*> ptr_ref(channels), ptr_test(channels), ptr_reverse(channels);
+					for(uint32_t c = 0; c < channels; ++c) {
+						ptr_ref[c] = out_ref.data() + c;
+						ptr_test[c] = out_test.data() + c;
+						ptr_reverse[c] = out_reverse.data() + c;
+					}
+					g_resampler_kernels_scalar.firfilter[storage][interpolation][0](channels, filter_length, coef_ptr, weights, false,
+																					ptr_in.data(), offset, ptr_ref.data(), 0);
+					lowrider_firfilter_func firfilter = kernels.firfilter[storage][interpolation][(channels <= lowrider_resampler_kernels::FIRFILTER_CHANNELS_MAX)? channels : 0];
+					firfilter(channels, filter_length, coef_ptr, weights, false, ptr_in.data(), offset, ptr_test.data(), 0);
+					firfilter(channels, filter_length, coef_reverse_ptr, weights, true, ptr_in.data(), offset, ptr_reverse.data(), 0);
+
+					// run the interleaved kernel
+					uint32_t stride = (channels + lowrider_resampler_kernels::INTERLEAVED_ALIGN - 1) / lowrider_resampler_kernels::INTERLEAVED_ALIGN * lowrider_resampler_kernels::INTERLEAVED_ALIGN;
+					std::vector<float> data_interleaved(stride * filter_length, 0.0f), out_interleaved(stride), out_interleaved_reverse(stride);
+					std::vector<float> coef_temp(stride * ((filter_length + stride - 1) / stride));
+					for(uint32_t i = 0; i < filter_length; ++i) {
+						for(uint32_t c = 0; c < channels; ++c) {
+							data_interleaved[i * stride + c] = ptr_in[c][offset + i];
+						}
+					}
+					kernels.firfilter_interleaved[storage][interpolation](stride, filter_length, coef_ptr, weights, false, coef_temp.data(),
+																		  data_interleaved.data(), out_interleaved.data());
+					kernels.firfilter_interleaved[storage][interpolation](stride, filter_length, coef_reverse_ptr, weights, true, coef_temp.data(),
+																		  data_interleaved.data(), out_interleaved_reverse.data());
+
+					// compare
+					for(uint32_t c = 0; c < channels; ++c) {
+						double norm = 0.0;
+						for(uint32_t i = 0; i < filter_length; ++i) {
+							double interp;
+							if(interpolation == lowrider_resampler_interpolation_cubic) {
+								interp = 0.0;
+								for(uint32_t k = 0; k < 4; ++k) {
+									interp += (double) coef[k * filter_length + i] * (double) weights[k];
+								}
+							} else if(interpolation == lowrider_resampler_interpolation_none) {
+								interp = (double) coef[i];
+							} else {
+								interp = (double) coef[i] + ((double) coef[filter_length + i] - (double) coef[i]) * (double) weights[0];
+							}
+							norm += std::abs(interp * (double) ptr_in[c][offset + i]);
+						}
+						max_error = std::max(max_error, std::abs((double) out_test[c] - (double) out_ref[c]) / norm);
+						max_error = std::max(max_error, std::abs((double) out_interleaved[c] - (double) out_ref[c]) / norm);
+						if(out_reverse[c] != out_test[c] || out_interleaved_reverse[c] != out_interleaved[c]) {
+							max_error = std::numeric_limits<double>::infinity();
+						}
+					}
+
+					// the kernels with fused output conversion must match the planar kernel followed by the reference conversion
+					if(storage == lowrider_resampler_storage_f32) {
+						for(uint32_t format = 1; format < lowrider_resampler_kernels::FORMAT_COUNT; ++format) {
+							uint32_t bytes = get_sample_format_bytes((lowrider_sample_format) format);
+							std::vector<uint8_t> device_ref(channels * bytes), device_test(channels * bytes), device_reverse(channels * bytes);
+							for(uint32_t c = 0; c < channels; ++c) {
+								reference_convert_out((lowrider_sample_format) format, out_test[c], device_ref.data() + c * bytes);
+							}
+							lowrider_firfilter_device_func firfilter_device = kernels.firfilter_device[format][interpolation][
+								(channels <= lowrider_resampler_kernels::FIRFILTER_CHANNELS_MAX)? channels : 0];
+							firfilter_device(channels, filter_length, coef_ptr, weights, false, ptr_in.data(), offset, device_test.data());
+							firfilter_device(channels, filter_length, coef_reverse_ptr, weights, true, ptr_in.data(), offset, device_reverse.data());
+							if(device_test != device_ref || device_reverse != device_ref) {
+								max_error = std::numeric_limits<double>::infinity();
+							}
+						}
+					}
+
+				}
+			}
+		}
+	}
+
+	// verify the convolution kernel
+	for(uint32_t filter_length = 1; filter_length <= 40; ++filter_length) {
+		for(uint32_t count : {1, 3, 4, 15, 16, 17, 63, 64, 65, 100}) {
+			std::vector<float> coef(filter_length), data(filter_length + count - 1);
+			for(float &v : coef) {
+				v = dist(rng);
+			}
+			for(float &v : data) {
+				v = dist(rng);
+			}
+			std::vector<float> out_ref(count), out_test(count);
+			g_resampler_kernels_scalar.convolve(filter_length, coef.data(), data.data(), out_ref.data(), count);
+			kernels.convolve(filter_length, coef.data(), data.data(), out_test.data(), count);
+			for(uint32_t m = 0; m < count; ++m) {
+				double norm = 0.0;
+				for(uint32_t i = 0; i < filter_length; ++i) {
+					norm += std::abs((double) coef[i] * (double) data[m + i]);
+				}
+				max_error = std::max(max_error, std::abs((double) out_test[m] - (double) out_ref[m]) / norm);
+			}
+		}
+	}
+
+	// verify the fixed-point kernels, the results may only differ by one due to rounding
+	for(uint32_t interpolation = 0; interpolation < lowrider_resampler_kernels::INTERPOLATION_COUNT; ++interpolation) {
+		uint32_t rows = (interpolation == lowrider_resampler_interpolation_cubic)? 4 : (interpolation == lowrider_resampler_interpolation_none)? 1 : 2;
+		for(uint32_t channels : {1, 2, 3, 8}) {
+			for(uint32_t filter_length = 4; filter_length <= 132; filter_length += 4) {
+				float weights[4];
+				for(float &v : weights) {
+					v = 0.5f + 0.5f * dist(rng);
+				}
+				if(verify_resampler_kernel_fixed_point<int16_t>(kernels.firfilter_s16[interpolation], g_resampler_kernels_scalar.firfilter_s16[interpolation],
+																channels, filter_length, rows, weights, rng) > 1 ||
+				   verify_resampler_kernel_fixed_point<int32_t>(kernels.firfilter_s32[interpolation], g_resampler_kernels_scalar.firfilter_s32[interpolation],
+																channels, filter_length, rows, weights, rng) > 1) {
+					max_error = std::numeric_limits<double>::infinity();
+				}
+			}
+		}
+	}
+
+	// verify the conversion kernels
+	if(!verify_sample_conversion(kernels, rng)) {
+		max_error = std::numeric_limits<double>::infinity();
+	}
+
+	return max_error;
+}
+
+// Sample types used by measure_resampler. Integer test signals use half of the full scale so ringing can't cause
+// clipping, and the results include the rounding errors of the input and output samples. Integer types use the
+// fixed-point path of the resampler.
+template<typename T>
+struct measure_sample {
+	static constexpr double SCALE = -(double) std::numeric_limits<T>::min();
+	static constexpr double AMPLITUDE = 0.5;
+	static T convert(double x) { return (T) rint64(x); }
+	static void prepare(lowrider_resampler_chain &resampler) {
+		resampler.prepare_fixed_point((sizeof(T) == sizeof(int16_t))? lowrider_resampler_fixed_point_s16 : lowrider_resampler_fixed_point_s32);
+	}
+};
+template<>
+struct measure_sample<float> {
+	static constexpr double SCALE = 1.0;
+	static constexpr double AMPLITUDE = 1.0;
+	static float convert(double x) { return (float) x; }
+	static void prepare(lowrider_resampler_chain &resampler) { (void) resampler; }
+};
+
+// Creates a resampler for a measurement. Every measurement thread has its own resampler.
+template<typename T>
+static std::unique_ptr<lowrider_resampler_chain> create_measure_resampler(const analyze_params &params) {
+	std::unique_ptr<lowrider_resampler_chain> resampler(new lowrider_resampler_chain(
+		g_option_rate_in, g_option_rate_out, params.engine, params.multistage, g_option_period_in, params.passband, params.stopband, params.beta,
+		g_option_resampler_gain, params.interpolation, params.phase, params.farrow_taps, params.cache_dir));
+	resampler->set_ratio(params.ratio);
+	resampler->set_storage(params.storage);
+	measure_sample<T>::prepare(*resampler);
+	return resampler;
+}
+
+// Calls worker(t) for t in [0, threads) on separate threads, and rethrows the first exception (if any). If a thread
+// can't be started, its work is done by the current thread instead.
+template<typename F>
+static void run_measure_threads(uint32_t threads, F worker) {
+	std::vector<std::exception_ptr> exceptions(threads);
+	auto wrapper = [&](uint32_t t) {
+		try {
+			worker(t);
+		} catch(...) {
+			exceptions[t] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> workers;
+	for(uint32_t t = 1; t < threads; ++t) {
+		try {
+			workers.emplace_back(wrapper, t);
+		} catch(const std::system_error&) {
+			wrapper(t);
+		}
+	}
+	wrapper(0);
+	for(std::thread &w : workers) {
+		w.join();
+	}
+	for(std::exception_ptr &e : exceptions) {
+		if(e) {
+			std::rethrow_exception(e);
+		}
+	}
+}
+
+// Calculates data[n] = exp(2 * pi * j * step * n) for n < size. Only one in OSCILLATOR_RESYNC samples is evaluated
+// directly, the others are calculated with a complex multiplication, which is much faster than sin/cos. The rounding
+// errors of the recurrence stay far below the errors of the resampler because the oscillator is resynchronized often.
+static void generate_oscillator(std::vector<std::complex<double>> &data, uint32_t size, double step) {
+	data.resize(size);
+	std::complex<double> rotation = std::polar(1.0, 2.0 * M_PI * step);
+	for(uint32_t i = 0; i < size; i += OSCILLATOR_RESYNC) {
+		double phase = (double) i * step;
+		std::complex<double> z = std::polar(1.0, 2.0 * M_PI * (phase - std::floor(phase)));
+		uint32_t end = std::min(size, i + OSCILLATOR_RESYNC);
+		for(uint32_t j = i; j < end; ++j) {
+			data[j] = z;
+			z *= rotation;
+		}
+	}
+}
+
+// Same as generate_oscillator, but for a linear chirp that goes from DC to the Nyquist frequency in 'length' samples,
+// evaluated at positions (start + step * i). The phase at position t is (t^2 / (4 * length)) cycles.
+static void generate_chirp(std::vector<std::complex<double>> &data, uint32_t size, double start, double step, uint32_t length) {
+	data.resize(size);
+	double scale = 1.0 / (4.0 * (double) length);
+	std::complex<double> acceleration = std::polar(1.0, 2.0 * M_PI * 2.0 * sqr(step) * scale);
+	for(uint32_t i = 0; i < size; i += OSCILLATOR_RESYNC) {
+		double t = start + step * (double) i;
+		double phase = sqr(t) * scale, delta = step * (2.0 * t + step) * scale;
+		std::complex<double> z = std::polar(1.0, 2.0 * M_PI * (phase - std::floor(phase)));
+		std::complex<double> rotation = std::polar(1.0, 2.0 * M_PI * (delta - std::floor(delta)));
+		uint32_t end = std::min(size, i + OSCILLATOR_RESYNC);
+		for(uint32_t j = i; j < end; ++j) {
+			data[j] = z;
+			z *= rotation;
+			rotation *= acceleration;
+		}
+	}
+}
+
+// Resamples planar data in blocks, like loopback.cpp does.
+template<typename T>
+static void measure_resample(lowrider_resampler_chain &resampler, uint32_t channels, const std::vector<T> *data_in, std::vector<T> *data_out) {
+	uint32_t samples_in = data_in[0].size();
+	uint32_t pos_in = 0, pos_out = 0;
+	resampler.reset();
+	while(pos_in <= samples_in - resampler.get_filter_length()) {
+
+		uint32_t block_in = std::min(samples_in - pos_in, 1234 + resampler.get_filter_length());
+		uint32_t block_out = resampler.calculate_size_out(block_in);
+
+		const T *ptr_in[2];
+		T *ptr_out[2];
+		for(uint32_t c = 0; c < channels; ++c) {
+			data_out[c].resize(pos_out + block_out);
+			ptr_in[c] = data_in[c].data() + pos_in;
+			ptr_out[c] = data_out[c].data() + pos_out;
+		}
+		auto p = resampler.resample(channels, ptr_in, block_in, ptr_out, block_out);
+		assert(p.first > block_in - resampler.get_filter_length());
+		assert(p.second == block_out);
+
+		pos_in += p.first;
+		pos_out += p.second;
+
+	}
+	for(uint32_t c = 0; c < channels; ++c) {
+		data_out[c].resize(pos_out);
+	}
+}
+
+// Measures the gain and the error of the resampler for one test frequency.
+template<typename T>
+static void measure_tone(lowrider_resampler_chain &resampler, double test_freq, double &gain, double &error) {
 	double actual_rate_out = (double) g_option_rate_in / (double) resampler.get_ratio();
-	/*double actual_latency = (double) (resampler.get_filter_length() / 2 - 1) / (double) resampler.get_ratio();*/
+	double scale_in = measure_sample<T>::SCALE * measure_sample<T>::AMPLITUDE, scale_out = 1.0 / scale_in;
+	uint32_t samples_in = 10000;
 
-	float passband = g_option_resampler_passband * (float) std::min(g_option_rate_in, g_option_rate_out);
-	float stopband = g_option_resampler_stopband * (float) std::min(g_option_rate_in, g_option_rate_out);
+	// generate input
+	std::vector<std::complex<double>> oscillator;
+	generate_oscillator(oscillator, samples_in, test_freq / (double) g_option_rate_in);
+	std::vector<T> data_in(samples_in);
+	for(uint32_t i = 0; i < samples_in; ++i) {
+		data_in[i] = measure_sample<T>::convert(oscillator[i].real() * scale_in);
+	}
 
-	// print header
-	std::cout << "Freq (Hz)   Gain (dB)   Error (dB)" << std::endl;
+	// resample the data
+	std::vector<T> data_out;
+	measure_resample(resampler, 1, &data_in, &data_out);
+	uint32_t samples_out = data_out.size();
 
-	uint32_t freqs = 480;
+	// analyze output
+	generate_oscillator(oscillator, samples_out, test_freq / actual_rate_out);
+	double dot_sin_data = 0.0, dot_cos_data = 0.0, dot_sin_cos = 0.0;
+	double norm_sin = 0.0, norm_cos = 0.0;
+	for(uint32_t i = 0; i < samples_out; ++i) {
+		double vec_sin = oscillator[i].imag();
+		double vec_cos = oscillator[i].real();
+		dot_sin_data += vec_sin * (double) data_out[i] * scale_out;
+		dot_cos_data += vec_cos * (double) data_out[i] * scale_out;
+		dot_sin_cos += vec_sin * vec_cos;
+		norm_sin += sqr(vec_sin);
+		norm_cos += sqr(vec_cos);
+	}
+	double det = norm_sin * norm_cos - sqr(dot_sin_cos);
+	double ampl_sin = (norm_cos * dot_sin_data - dot_sin_cos * dot_cos_data) / det;
+	double ampl_cos = (norm_sin * dot_cos_data - dot_sin_cos * dot_sin_data) / det;
+	gain = sqr(ampl_sin) + sqr(ampl_cos);
+	error = 0.0;
+	for(uint32_t i = 0; i < samples_out; ++i) {
+		error += sqr(ampl_sin * oscillator[i].imag() + ampl_cos * oscillator[i].real() - (double) data_out[i] * scale_out);
+	}
+	error /= (double) samples_out;
+
+}
+
+// Measures the gain and the error of the resampler for 'freqs' test frequencies, optionally prints the results,
+// and returns the average SNR in the passband. The test frequencies are spread across all cores.
+template<typename T>
+static double measure_tones(const analyze_params &params, double passband, uint32_t freqs, bool print) {
+
+	std::vector<double> gains(freqs), errors(freqs);
+	uint32_t threads = clamp(std::thread::hardware_concurrency(), 1u, freqs);
+	run_measure_threads(threads, [&](uint32_t t) {
+		std::unique_ptr<lowrider_resampler_chain> resampler = create_measure_resampler<T>(params);
+		for(uint32_t f = t; f < freqs; f += threads) {
+			double test_freq = 0.5 * (double) g_option_rate_in * ((double) f + 0.5) / (double) freqs;
+			measure_tone<T>(*resampler, test_freq, gains[f], errors[f]);
+		}
+	});
+
+	if(print) {
+		std::cout << "Freq (Hz)   Gain (dB)   Error (dB)" << std::endl;
+	}
 	double average_error = 0.0;
 	uint32_t average_error_count = 0;
 	for(uint32_t f = 0; f < freqs; ++f) {
-
-		uint32_t samples_in = 10000;
-		double test_freq = 0.5 * (double) g_option_rate_in * ((double) f + 0.5) / (float) freqs;
-
-		// generate input
-		std::vector<float> data_in(samples_in);
-		for(uint32_t i = 0; i < samples_in; ++i) {
-			data_in[i] = std::cos(2.0 * M_PI * test_freq * (double) i / (double) g_option_rate_in);
-		}
-
-		// resample the data in blocks
-		std::vector<float> data_out;
-		uint32_t pos_in = 0, pos_out = 0;
-		resampler.reset();
-		while(pos_in <= samples_in - resampler.get_filter_length()) {
-
-			uint32_t block_in = std::min(samples_in - pos_in, 1234 + resampler.get_filter_length());
-			uint32_t block_out = resampler.calculate_size_out(block_in);
-
-			data_out.resize(pos_out + block_out);
-
-			float *ptr_in[1] = {data_in.data() + pos_in};
-			float *ptr_out[1] = {data_out.data() + pos_out};
-			auto p = resampler.resample(1, ptr_in, block_in, ptr_out, block_out);
-			assert(p.first > block_in - resampler.get_filter_length());
-			assert(p.second == block_out);
-
-			pos_in += p.first;
-			pos_out += p.second;
-
-		}
-		uint32_t samples_out = pos_out;
-
-		// analyze output
-		double dot_sin_data = 0.0, dot_cos_data = 0.0, dot_sin_cos = 0.0;
-		double norm_sin = 0.0, norm_cos = 0.0;
-		for(uint32_t i = 0; i < samples_out; ++i) {
-			double vec_sin = std::sin(2.0 * M_PI * test_freq * (double) i / actual_rate_out);
-			double vec_cos = std::cos(2.0 * M_PI * test_freq * (double) i / actual_rate_out);
-			dot_sin_data += vec_sin * (double) data_out[i];
-			dot_cos_data += vec_cos * (double) data_out[i];
-			dot_sin_cos += vec_sin * vec_cos;
-			norm_sin += sqr(vec_sin);
-			norm_cos += sqr(vec_cos);
-		}
-		double det = norm_sin * norm_cos - sqr(dot_sin_cos);
-		double ampl_sin = (norm_cos * dot_sin_data - dot_sin_cos * dot_cos_data) / det;
-		double ampl_cos = (norm_sin * dot_cos_data - dot_sin_cos * dot_sin_data) / det;
-		double gain = sqr(ampl_sin) + sqr(ampl_cos);
-		double error = 0.0;
-		for(uint32_t i = 0; i < samples_out; ++i) {
-			double vec_sin = std::sin(2.0 * M_PI * test_freq * (double) i / actual_rate_out);
-			double vec_cos = std::cos(2.0 * M_PI * test_freq * (double) i / actual_rate_out);
-			error += sqr(ampl_sin * vec_sin + ampl_cos * vec_cos - (double) data_out[i]);
-		}
-		error /= (double) samples_out;
+		double test_freq = 0.5 * (double) g_option_rate_in * ((double) f + 0.5) / (double) freqs;
 		if(test_freq <= passband) {
-			average_error += error;
+			average_error += errors[f];
 			++average_error_count;
 		}
+		if(print) {
+			std::ios_base::fmtflags flags(std::cout.flags());
+			std::cout << std::fixed << std::setw(9) << std::setprecision(2) << test_freq;
+			std::cout << std::fixed << std::setw(12) << std::setprecision(3) << (10.0 * std::log10(gains[f]));
+			std::cout << std::fixed << std::setw(13) << std::setprecision(3) << (10.0 * std::log10(2.0 * errors[f]));
+			std::cout << std::endl;
+			std::cout.flags(flags);
+		}
+	}
+	average_error /= (double) average_error_count;
+
+	return 0.5 * sqr(g_option_resampler_gain) / average_error;
+}
+
+// Measures the response of the resampler to a linear chirp from DC to the Nyquist frequency of the input, which covers
+// the whole spectrum (including the stopband for downsampling) in a single run. The chirp is resampled as two channels
+// (cosine and sine), which together form a complex signal without negative frequencies. The output is multiplied with
+// the complex conjugate of the expected chirp, which turns the signal into DC, and all aliasing images and other errors
+// into (nearly) stationary tones, so they can be separated with long FFT frames. For each frame, the power near DC is
+// the gain, and the power that ends up elsewhere is the leakage. Optionally prints the results for CHIRP_ROWS frequency
+// ranges, and returns the average SNR in the passband. The highest leakage into the passband of the output for any
+// input frequency (i.e. the worst aliasing or image) is returned in 'worst_leakage', relative to the input power.
+template<typename T>
+static double measure_chirp(const analyze_params &params, double passband, bool print, double *worst_leakage) {
+	double actual_rate_out = (double) g_option_rate_in / (double) params.ratio;
+	double scale_in = measure_sample<T>::SCALE * measure_sample<T>::AMPLITUDE, scale_out = 1.0 / scale_in;
+
+	// generate input (long enough to get CHIRP_SAMPLES output samples for downsampling)
+	uint32_t samples_in = (uint32_t) std::lrint((double) CHIRP_SAMPLES * std::max(1.0, (double) params.ratio));
+	std::vector<std::complex<double>> chirp;
+	std::vector<T> data_in[2], data_out[2];
+	generate_chirp(chirp, samples_in, 0.0, 1.0, samples_in);
+	data_in[0].resize(samples_in);
+	data_in[1].resize(samples_in);
+	for(uint32_t i = 0; i < samples_in; ++i) {
+		data_in[0][i] = measure_sample<T>::convert(chirp[i].real() * scale_in);
+		data_in[1][i] = measure_sample<T>::convert(chirp[i].imag() * scale_in);
+	}
+
+	// Resample the data. The first output sample is calculated from the first 'filter length' input samples, so output
+	// sample i corresponds to input position (i * ratio + filter delay).
+	std::unique_ptr<lowrider_resampler_chain> resampler = create_measure_resampler<T>(params);
+	measure_resample(*resampler, 2, data_in, data_out);
+	uint32_t samples_out = data_out[0].size();
+	double delay = resampler->get_filter_delay();
+	generate_chirp(chirp, samples_out, delay, (double) params.ratio, samples_in);
+
+	// window
+	std::vector<double> window(CHIRP_FRAME);
+	double window_power = 0.0;
+	for(uint32_t i = 0; i < CHIRP_FRAME; ++i) {
+		window[i] = kaiser(((double) i + 0.5) / (double) (CHIRP_FRAME / 2) - 1.0, CHIRP_WINDOW_BETA);
+		window_power += sqr(window[i]);
+	}
+	double reference = (double) CHIRP_FRAME * window_power * sqr((double) g_option_resampler_gain);
+
+	// analyze the frames
+	uint32_t frames = (samples_out >= CHIRP_FRAME)? (samples_out - CHIRP_FRAME) / (CHIRP_FRAME / 2) + 1 : 0;
+	std::vector<double> row_gain(CHIRP_ROWS, 0.0), row_leakage(CHIRP_ROWS, 0.0), row_passband_leakage(CHIRP_ROWS, 0.0);
+	std::vector<uint32_t> row_count(CHIRP_ROWS, 0);
+	double average_leakage = 0.0, max_leakage = 0.0;
+	uint32_t average_leakage_count = 0;
+	lowrider_fft fft(CHIRP_FRAME);
+	std::vector<std::complex<double>> spectrum(CHIRP_FRAME);
+	for(uint32_t frame = 0; frame < frames; ++frame) {
+		uint32_t pos = frame * (CHIRP_FRAME / 2);
 
-		/*double error2 = 0.0;
-		for(uint32_t i = 0; i < samples_out; ++i) {
-			double expected = std::cos(2.0 * M_PI * test_freq * ((double) i + actual_latency) / actual_rate_out);
-			error2 += sqr(expected - data_out[i]);
+		// frequency of the input at the center of the frame
+		double center = ((double) pos + 0.5 * (double) CHIRP_FRAME) * (double) params.ratio + delay;
+		double freq = 0.5 * (double) g_option_rate_in * std::min(1.0, center / (double) samples_in);
+
+		for(uint32_t i = 0; i < CHIRP_FRAME; ++i) {
+			std::complex<double> value((double) data_out[0][pos + i], (double) data_out[1][pos + i]);
+			spectrum[i] = value * std::conj(chirp[pos + i]) * (scale_out * window[i]);
 		}
-		error2 /= (double) samples_out;*/
+		fft.forward(spectrum.data());
 
-		// print data
-		std::ios_base::fmtflags flags(std::cout.flags());
-		std::cout << std::fixed << std::setw(9) << std::setprecision(2) << test_freq;
-		std::cout << std::fixed << std::setw(12) << std::setprecision(3) << (10.0 * std::log10(gain));
-		std::cout << std::fixed << std::setw(13) << std::setprecision(3) << (10.0 * std::log10(2.0 * error));
-		/*std::cout << std::fixed << std::setw(13) << std::setprecision(2) << (10.0 * std::log10(2.0 * error2));
-		std::cout << std::fixed << std::setw(13) << std::setprecision(2) << dot_sin_cos;*/
-		std::cout << std::endl;
-		std::cout.flags(flags);
+		// Bin k corresponds to an output frequency of (freq + k * bin_width), wrapped to the Nyquist range of the output.
+		// If the frequency of the input is above the Nyquist frequency of the output, there is no signal at all.
+		bool expected = (freq < 0.5 * actual_rate_out);
+		double signal = 0.0, leakage = 0.0, passband_leakage = 0.0;
+		for(uint32_t k = 0; k < CHIRP_FRAME; ++k) {
+			double power = std::norm(spectrum[k]);
+			int32_t offset = (k < CHIRP_FRAME / 2)? (int32_t) k : (int32_t) k - (int32_t) CHIRP_FRAME;
+			double out_freq = freq + (double) offset * actual_rate_out / (double) CHIRP_FRAME;
+			out_freq -= actual_rate_out * std::floor(out_freq / actual_rate_out + 0.5);
+			if(expected && std::abs(offset) <= (int32_t) CHIRP_GUARD) {
+				signal += power;
+			} else {
+				leakage += power;
+				if(std::abs(out_freq) <= passband) {
+					passband_leakage += power;
+				}
+			}
+		}
+		double gain = ((expected)? signal : leakage) / reference;
+		leakage /= reference;
+		passband_leakage /= reference;
+
+		max_leakage = std::max(max_leakage, passband_leakage);
+		if(freq <= passband) {
+			average_leakage += leakage;
+			++average_leakage_count;
+		}
+		uint32_t row = std::min(CHIRP_ROWS - 1, (uint32_t) (freq / (0.5 * (double) g_option_rate_in) * (double) CHIRP_ROWS));
+		row_gain[row] += gain;
+		row_leakage[row] += leakage;
+		row_passband_leakage[row] += passband_leakage;
+		++row_count[row];
 
 	}
-	average_error /= (double) average_error_count;
+	if(average_leakage_count == 0) {
+		throw std::runtime_error("chirp is too short to measure the passband");
+	}
+	average_leakage /= (double) average_leakage_count;
 
-	double average_snr = 0.5 * sqr(g_option_resampler_gain) / average_error;
-	double average_latency = ((double) (resampler.get_filter_length() / 2) - 0.5) / (double) g_option_rate_in;
+	if(print) {
+		std::cout << "Freq (Hz)   Gain (dB)   Leakage (dB)   Passband Leakage (dB)" << std::endl;
+		for(uint32_t row = 0; row < CHIRP_ROWS; ++row) {
+			if(row_count[row] == 0)
+				continue;
+			double freq = 0.5 * (double) g_option_rate_in * ((double) row + 0.5) / (double) CHIRP_ROWS;
+			std::ios_base::fmtflags flags(std::cout.flags());
+			std::cout << std::fixed << std::setw(9) << std::setprecision(2) << freq;
+			std::cout << std::fixed << std::setw(12) << std::setprecision(3) << (10.0 * std::log10(row_gain[row] / (double) row_count[row]));
+			std::cout << std::fixed << std::setw(15) << std::setprecision(3) << (10.0 * std::log10(row_leakage[row] / (double) row_count[row]));
+			std::cout << std::fixed << std::setw(24) << std::setprecision(3) << (10.0 * std::log10(row_passband_leakage[row] / (double) row_count[row]));
+			std::cout << std::endl;
+			std::cout.flags(flags);
+		}
+	}
+	if(worst_leakage != nullptr) {
+		*worst_leakage = max_leakage;
+	}
+
+	return 1.0 / average_leakage;
+}
+
+// Measures the resampler with the method selected by --analyze-method, optionally prints the results, and returns the
+// average SNR in the passband. The worst leakage is only available for the chirp method.
+template<typename T>
+static double measure_resampler(const analyze_params &params, double passband, uint32_t freqs, bool print, double *worst_leakage) {
+	if(g_option_analyze_method == lowrider_analyze_method_chirp)
+		return measure_chirp<T>(params, passband, print, worst_leakage);
+	return measure_tones<T>(params, passband, freqs, print);
+}
+
+double measure_resampler_snr(const analyze_params &params, double passband, uint32_t freqs) {
+	return measure_resampler<float>(params, passband, freqs, false, nullptr);
+}
+
+// Returns the size of the filter bank or coefficients of a stage in bytes.
+static size_t get_stage_filter_size(lowrider_resampler_chain &resampler, uint32_t stage) {
+	lowrider_resampler *s = resampler.get_stage_resampler(stage);
+	if(s != nullptr)
+		return s->get_filter_bank_storage_size();
+	lowrider_halfband *h = resampler.get_stage_halfband(stage);
+	if(h != nullptr)
+		return 2 * h->get_taps() * sizeof(float);
+	lowrider_fft_filter *f = resampler.get_stage_fft_filter(stage);
+	if(f != nullptr)
+		return f->get_fft_size() * sizeof(std::complex<double>);
+	lowrider_farrow *fa = resampler.get_stage_farrow(stage);
+	if(fa != nullptr)
+		return fa->get_taps() * fa->get_taps() * sizeof(float);
+	return 0;
+}
+
+void analyze_resampler() {
+
+	// create resampler
+	float ratio = (float) g_option_rate_in / (float) g_option_rate_out * 0.999f;
+	lowrider_resampler_chain resampler(g_option_rate_in, g_option_rate_out, g_option_resampler_engine, g_option_resampler_multistage, g_option_period_in,
+									   g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain,
+									   g_option_resampler_interpolation, g_option_resampler_phase, g_option_resampler_farrow_taps,
+									   (g_option_resampler_cache)? get_filter_bank_cache_dir() : std::string());
+	resampler.set_ratio(ratio);
+	resampler.set_storage(g_option_resampler_storage);
+	/*double actual_latency = (double) (resampler.get_filter_length() / 2 - 1) / (double) resampler.get_ratio();*/
+
+	float passband = g_option_resampler_passband * (float) std::min(g_option_rate_in, g_option_rate_out);
+	float stopband = g_option_resampler_stopband * (float) std::min(g_option_rate_in, g_option_rate_out);
+
+	analyze_params params = {
+		g_option_resampler_engine, g_option_resampler_multistage, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+		g_option_resampler_interpolation, g_option_resampler_phase, g_option_resampler_farrow_taps, g_option_resampler_storage,
+		(g_option_resampler_cache)? get_filter_bank_cache_dir() : std::string(), ratio,
+	};
+	double worst_leakage = 0.0;
+	double average_snr = measure_resampler<float>(params, passband, ANALYZE_FREQUENCIES, true, &worst_leakage);
+
+	// measure the fixed-point path if it is available
+	bool fixed_point = resampler.supports_fixed_point();
+	double average_snr_s16 = 0.0, average_snr_s32 = 0.0;
+	if(fixed_point) {
+		resampler.prepare_fixed_point(lowrider_resampler_fixed_point_s16);
+		resampler.prepare_fixed_point(lowrider_resampler_fixed_point_s32);
+		average_snr_s16 = measure_resampler<int16_t>(params, passband, ANALYZE_FREQUENCIES, false, nullptr);
+		average_snr_s32 = measure_resampler<int32_t>(params, passband, ANALYZE_FREQUENCIES, false, nullptr);
+	}
+
+	// measure all storage formats of the filter bank
+	const lowrider_resampler_storage storages[] = {lowrider_resampler_storage_f32, lowrider_resampler_storage_f16, lowrider_resampler_storage_bf16};
+	double storage_snr[3];
+	size_t storage_size[3];
+	for(uint32_t k = 0; k < 3; ++k) {
+		resampler.set_storage(storages[k]);
+		analyze_params storage_params = params;
+		storage_params.storage = storages[k];
+		storage_snr[k] = (storages[k] == g_option_resampler_storage)? average_snr : measure_resampler<float>(storage_params, passband, ANALYZE_FREQUENCIES, false, nullptr);
+		storage_size[k] = 0;
+		for(uint32_t stage = 0; stage < resampler.get_stage_count(); ++stage) {
+			lowrider_resampler *s = resampler.get_stage_resampler(stage);
+			if(s != nullptr) {
+				storage_size[k] += s->get_filter_bank_storage_size();
+			}
+		}
+	}
+	resampler.set_storage(g_option_resampler_storage);
+
+	double average_latency = ((double) resampler.get_filter_delay() - 0.5) / (double) g_option_rate_in;
+	uint32_t bank_error = 0;
+	for(uint32_t stage = 0; stage < resampler.get_stage_count(); ++stage) {
+		lowrider_resampler *s = resampler.get_stage_resampler(stage);
+		if(s != nullptr) {
+			bank_error = std::max(bank_error, s->verify_filter_bank());
+		}
+	}
 
 	std::cout << std::endl;
 	std::cout << "Input Rate:      " << std::fixed << std::setw(14) << std::setprecision(2) << g_option_rate_in << " Hz" << std::endl;
@@ -142,9 +828,195 @@ void analyze_resampler() {
 	std::cout << "Stopband:        " << std::fixed << std::setw(14) << std::setprecision(2) << stopband << " Hz" << std::endl;
 	std::cout << "Beta:            " << std::fixed << std::setw(14) << std::setprecision(4) << g_option_resampler_beta << std::endl;
 	std::cout << "Gain:            " << std::fixed << std::setw(14) << std::setprecision(2) << (20.0f * std::log10(g_option_resampler_gain)) << " dB" << std::endl;
-	std::cout << "Filter Length:   " << std::setw(14) << resampler.get_filter_length() << std::endl;
-	std::cout << "Filter Rows:     " << std::setw(14) << resampler.get_filter_rows() << std::endl;
+	std::cout << "Engine:          " << std::setw(14) << get_resampler_engine_name(resampler.get_engine()) << std::endl;
+	std::cout << "Interpolation:   " << std::setw(14) << ((g_option_resampler_interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear") << std::endl;
+	std::cout << "Phase:           " << std::setw(14) << ((g_option_resampler_phase == lowrider_resampler_phase_minimum)? "minimum" : "linear") << std::endl;
+	std::cout << "Storage:         " << std::setw(14) << get_resampler_storage_name(g_option_resampler_storage) << std::endl;
+	std::cout << "Stages:          " << std::setw(14) << resampler.get_stage_count() << std::endl;
+	std::cout << "Filter Delay:    " << std::fixed << std::setw(14) << std::setprecision(2) << resampler.get_filter_delay() << " samples" << std::endl;
+	std::cout << "Bank Error:      " << std::setw(14) << bank_error << " ulp" << std::endl;
 	std::cout << "Average SNR:     " << std::fixed << std::setw(14) << std::setprecision(2) << (10.0f * std::log10(average_snr)) << " dB" << std::endl;
+	if(g_option_analyze_method == lowrider_analyze_method_chirp) {
+		std::cout << "Worst Leakage:   " << std::fixed << std::setw(14) << std::setprecision(2) << (10.0f * std::log10(worst_leakage)) << " dB" << std::endl;
+	}
+	if(fixed_point) {
+		lowrider_resampler *s = resampler.get_stage_resampler(0);
+		std::cout << "S16 SNR:         " << std::fixed << std::setw(14) << std::setprecision(2) << (10.0f * std::log10(average_snr_s16)) << " dB"
+				  << " (Q" << s->get_fixed_point_shift(lowrider_resampler_fixed_point_s16) << " coefficients)" << std::endl;
+		std::cout << "S32 SNR:         " << std::fixed << std::setw(14) << std::setprecision(2) << (10.0f * std::log10(average_snr_s32)) << " dB"
+				  << " (Q" << s->get_fixed_point_shift(lowrider_resampler_fixed_point_s32) << " coefficients)" << std::endl;
+	} else {
+		std::cout << "S16/S32 SNR:     " << std::setw(14) << "-" << " (fixed-point path requires a single stage)" << std::endl;
+	}
+	for(uint32_t k = 0; k < 3; ++k) {
+		std::string label = make_string(to_upper(get_resampler_storage_name(storages[k])), " Bank SNR:");
+		std::cout << std::left << std::setw(17) << label << std::right;
+		std::cout << std::fixed << std::setw(14) << std::setprecision(2) << (10.0f * std::log10(storage_snr[k])) << " dB";
+		std::cout << " (" << std::fixed << std::setprecision(2) << ((double) storage_size[k] / 1024.0) << " KiB)" << std::endl;
+	}
 	std::cout << "Average latency: " << std::fixed << std::setw(14) << std::setprecision(2) << (average_latency * 1e3) << " ms" << std::endl;
+	std::cout << "Kernel:          " << std::setw(14) << get_resampler_kernels().name << std::endl;
+
+	// print the stages
+	std::cout << std::endl;
+	std::cout << "Stage   Type        Ratio      Interpolation   Filter Length   Filter Rows   Filter Bank (KiB)   Bank Source" << std::endl;
+	for(uint32_t stage = 0; stage < resampler.get_stage_count(); ++stage) {
+		std::ios_base::fmtflags flags(std::cout.flags());
+		std::cout << std::setw(5) << stage;
+		lowrider_resampler *s = resampler.get_stage_resampler(stage);
+		if(s != nullptr) {
+			const char *interpolation_name = (s->get_interpolation() == lowrider_resampler_interpolation_none)? "none" :
+											 (s->get_interpolation() == lowrider_resampler_interpolation_cubic)? "cubic" : "linear";
+			std::cout << "   " << std::left << std::setw(9) << "resampler" << std::right;
+			std::cout << std::fixed << std::setw(10) << std::setprecision(6) << s->get_ratio();
+			std::cout << "   " << std::left << std::setw(13) << interpolation_name << std::right;
+			std::cout << std::setw(16) << s->get_filter_length();
+			std::cout << std::setw(14) << s->get_filter_rows();
+			std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) s->get_filter_bank_storage_size() / 1024.0);
+			std::cout << "   " << get_filter_bank_source_name(s->get_filter_bank_source());
+		} else if(resampler.get_stage_halfband(stage) != nullptr) {
+			lowrider_halfband *h = resampler.get_stage_halfband(stage);
+			std::cout << "   " << std::left << std::setw(9) << "halfband" << std::right;
+			std::cout << std::fixed << std::setw(10) << std::setprecision(6) << h->get_ratio();
+			std::cout << "   " << std::left << std::setw(13) << "-" << std::right;
+			std::cout << std::setw(16) << h->get_filter_length();
+			std::cout << std::setw(14) << "-";
+			std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) get_stage_filter_size(resampler, stage) / 1024.0);
+			std::cout << "   " << "-";
+		} else if(resampler.get_stage_fft_filter(stage) != nullptr) {
+			lowrider_fft_filter *f = resampler.get_stage_fft_filter(stage);
+			std::cout << "   " << std::left << std::setw(9) << "fft" << std::right;
+			std::cout << std::fixed << std::setw(10) << std::setprecision(6) << f->get_ratio();
+			std::cout << "   " << std::left << std::setw(13) << "-" << std::right;
+			std::cout << std::setw(16) << f->get_filter_length();
+			std::cout << std::setw(14) << "-";
+			std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) get_stage_filter_size(resampler, stage) / 1024.0);
+			std::cout << "   " << "-" << " (FFT size " << f->get_fft_size() << ")";
+		} else if(resampler.get_stage_farrow(stage) != nullptr) {
+			lowrider_farrow *f = resampler.get_stage_farrow(stage);
+			std::cout << "   " << std::left << std::setw(9) << "farrow" << std::right;
+			std::cout << std::fixed << std::setw(10) << std::setprecision(6) << f->get_ratio();
+			std::cout << "   " << std::left << std::setw(13) << "lagrange" << std::right;
+			std::cout << std::setw(16) << f->get_filter_length();
+			std::cout << std::setw(14) << "-";
+			std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) get_stage_filter_size(resampler, stage) / 1024.0);
+			std::cout << "   " << "-";
+		} else {
+			lowrider_slip *sl = resampler.get_stage_slip(stage);
+			std::cout << "   " << std::left << std::setw(9) << "slip" << std::right;
+			std::cout << std::fixed << std::setw(10) << std::setprecision(6) << sl->get_ratio();
+			std::cout << "   " << std::left << std::setw(13) << "-" << std::right;
+			std::cout << std::setw(16) << sl->get_filter_length();
+			std::cout << std::setw(14) << "-";
+			std::cout << std::fixed << std::setw(20) << std::setprecision(2) << 0.0;
+			std::cout << "   " << "-";
+		}
+		std::cout << std::endl;
+		std::cout.flags(flags);
+	}
+
+	// compare engines, multistage, interpolation methods and phase responses (or the number of taps for the Farrow engine)
+	struct config {
+		lowrider_resampler_interpolation interpolation;
+		lowrider_resampler_phase phase;
+		uint32_t farrow_taps;
+	};
+	std::cout << std::endl;
+	std::cout << "Engine      Stages   Interpolation   Phase      Filter Bank (KiB)   Average SNR (dB)   Average latency (ms)" << std::endl;
+	bool multistage_possible = (lowrider_resampler_chain::get_halfband_decimate_stages(g_option_rate_in, g_option_rate_out) != 0 ||
+								lowrider_resampler_chain::get_halfband_interpolate_stages(g_option_rate_in, g_option_rate_out) != 0);
+	for(lowrider_resampler_engine engine : {lowrider_resampler_engine_polyphase, lowrider_resampler_engine_rational, lowrider_resampler_engine_fft,
+											lowrider_resampler_engine_farrow, lowrider_resampler_engine_slip}) {
+		for(bool multistage : {false, true}) {
+			if(multistage && !multistage_possible)
+				continue;
+			if(lowrider_resampler_chain::resolve_engine(g_option_rate_in, g_option_rate_out, engine, multistage, g_option_period_in, g_option_resampler_passband,
+														g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_phase) != engine)
+				continue;
+			std::vector<config> configs;
+			if(engine == lowrider_resampler_engine_farrow) {
+				for(uint32_t taps : {2u, 4u, 6u, 8u}) {
+					configs.push_back({g_option_resampler_interpolation, lowrider_resampler_phase_linear, taps});
+				}
+			} else if(engine == lowrider_resampler_engine_slip) {
+				configs.push_back({g_option_resampler_interpolation, lowrider_resampler_phase_linear, g_option_resampler_farrow_taps});
+			} else {
+				for(lowrider_resampler_interpolation interpolation : {lowrider_resampler_interpolation_linear, lowrider_resampler_interpolation_cubic}) {
+					for(lowrider_resampler_phase phase : {lowrider_resampler_phase_linear, lowrider_resampler_phase_minimum}) {
+						configs.push_back({interpolation, phase, g_option_resampler_farrow_taps});
+					}
+				}
+			}
+			for(const config &c : configs) {
+				lowrider_resampler_chain resampler2(g_option_rate_in, g_option_rate_out, engine, multistage, g_option_period_in,
+													g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain,
+													c.interpolation, c.phase, c.farrow_taps, std::string());
+				resampler2.set_ratio(ratio);
+				resampler2.set_storage(g_option_resampler_storage);
+				bool current = (engine == resampler.get_engine() && resampler2.get_stage_count() == resampler.get_stage_count() &&
+								c.interpolation == g_option_resampler_interpolation && c.phase == g_option_resampler_phase &&
+								c.farrow_taps == g_option_resampler_farrow_taps);
+				analyze_params params2 = {
+					engine, multistage, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+					c.interpolation, c.phase, c.farrow_taps, g_option_resampler_storage, std::string(), ratio,
+				};
+				double snr = (current)? average_snr : measure_resampler<float>(params2, passband, ANALYZE_FREQUENCIES, false, nullptr);
+				double latency = ((double) resampler2.get_filter_delay() - 0.5) / (double) g_option_rate_in;
+				size_t bank_size = 0;
+				for(uint32_t stage = 0; stage < resampler2.get_stage_count(); ++stage) {
+					bank_size += get_stage_filter_size(resampler2, stage);
+				}
+				std::string interpolation_name = (engine == lowrider_resampler_engine_farrow)? make_string(c.farrow_taps, " taps") :
+												 (engine == lowrider_resampler_engine_slip)? "-" :
+												 (c.interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear";
+				std::ios_base::fmtflags flags(std::cout.flags());
+				std::cout << std::left << std::setw(9) << get_resampler_engine_name(engine) << std::right;
+				std::cout << std::setw(9) << resampler2.get_stage_count();
+				std::cout << "   " << std::left << std::setw(13) << interpolation_name << std::right;
+				std::cout << "   " << std::left << std::setw(8) << ((c.phase == lowrider_resampler_phase_minimum)? "minimum" : "linear") << std::right;
+				std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) bank_size / 1024.0);
+				std::cout << std::fixed << std::setw(19) << std::setprecision(2) << (10.0 * std::log10(snr));
+				std::cout << std::fixed << std::setw(23) << std::setprecision(3) << (latency * 1e3);
+				std::cout << std::endl;
+				std::cout.flags(flags);
+			}
+		}
+	}
+
+	// Worst-case error of the Farrow engine at several frequencies (relative to the lowest sample rate). This is calculated
+	// directly from the interpolator, so it is also shown when the Farrow engine is not possible for these sample rates.
+	std::cout << std::endl;
+	std::cout << "Farrow Taps   Latency (samples)   Error at 0.05 (dB)   Error at 0.20 (dB)   Error at passband (dB)" << std::endl;
+	for(uint32_t taps = lowrider_farrow::TAPS_MIN; taps <= 8; taps += 2) {
+		std::ios_base::fmtflags flags(std::cout.flags());
+		std::cout << std::setw(11) << taps;
+		std::cout << std::fixed << std::setw(20) << std::setprecision(1) << ((double) (taps / 2) - 0.5);
+		std::cout << std::fixed << std::setw(21) << std::setprecision(2) << lowrider_farrow::get_passband_error(taps, 0.05);
+		std::cout << std::fixed << std::setw(21) << std::setprecision(2) << lowrider_farrow::get_passband_error(taps, 0.20);
+		std::cout << std::fixed << std::setw(25) << std::setprecision(2) << lowrider_farrow::get_passband_error(taps, g_option_resampler_passband);
+		std::cout << std::endl;
+		std::cout.flags(flags);
+	}
+
+	// verify kernels
+	std::cout << std::endl;
+	std::cout << "Kernel   Relative error" << std::endl;
+	bool kernels_ok = true;
+	std::ios_base::fmtflags flags(std::cout.flags());
+	for(const lowrider_resampler_kernels *kernels : get_supported_resampler_kernels()) {
+		double error = verify_resampler_kernel(*kernels);
+		bool ok = (error < 1.0e-5);
+		std::cout << std::left << std::setw(9) << kernels->name << std::right;
+		std::cout << std::scientific << std::setw(14) << std::setprecision(3) << error;
+		std::cout << ((ok)? "   OK" : "   FAILED") << std::endl;
+		kernels_ok = kernels_ok && ok;
+	}
+	std::cout.flags(flags);
+	if(!kernels_ok) {
+		throw std::runtime_error("resampler kernel does not match the reference implementation");
+	}
+	if(bank_error > 1) {
+		throw std::runtime_error("filter bank does not match the reference implementation");
+	}
 
 }
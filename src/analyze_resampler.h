@@ -19,4 +19,28 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "resampler_types.h"
+
+#include <cstdint>
+
+#include <string>
+
+// Parameters of a resampler chain that is being measured. The measurements run on several threads, and every thread
+// creates its own resampler from these parameters.
+struct analyze_params {
+	lowrider_resampler_engine engine;
+	bool multistage;
+	float passband, stopband, beta;
+	lowrider_resampler_interpolation interpolation;
+	lowrider_resampler_phase phase;
+	uint32_t farrow_taps;
+	lowrider_resampler_storage storage;
+	std::string cache_dir;
+	float ratio;
+};
+
+// Measures the average SNR in the passband (in Hz) of a resampler chain, using the method selected by --analyze-method.
+// The number of test frequencies is only used by the tone method.
+double measure_resampler_snr(const analyze_params &params, double passband, uint32_t freqs);
+
 void analyze_resampler();
@@ -21,6 +21,7 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "aligned_memory.h"
 #include "miscmath.h"
+#include "resampler_kernels.h"
 #include "string_helper.h"
 
 #include <cassert>
@@ -33,6 +34,23 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <alsa/asoundlib.h>
 
+// Planar layout: sample i of channel c is located at data[c][i].
+template<typename T>
+struct PlanarLayout {
+	T * const *m_data;
+	PlanarLayout(T * const *data) : m_data(data) {}
+	T& operator()(uint32_t c, uint32_t i) const { return m_data[c][i]; }
+};
+
+// Interleaved layout: sample i of channel c is located at data[i * stride + c].
+template<typename T>
+struct InterleavedLayout {
+	T *m_data;
+	uint32_t m_stride;
+	InterleavedLayout(T *data, uint32_t stride) : m_data(data), m_stride(stride) {}
+	T& operator()(uint32_t c, uint32_t i) const { return m_data[(size_t) i * (size_t) m_stride + (size_t) c]; }
+};
+
 struct lowrider_backend_alsa::Private {
 
 	struct InputOutput {
@@ -41,6 +59,15 @@ struct lowrider_backend_alsa::Private {
 		snd_pcm_format_t m_sample_format;
 		unsigned int m_channels, m_sample_rate;
 		snd_pcm_uframes_t m_period_size, m_buffer_size;
+		bool m_mmap;
+		snd_pcm_uframes_t m_mmap_offset;
+		snd_pcm_status_t *m_status;
+		bool m_tstamp, m_audio_tstamp, m_period_wakeup;
+		uint64_t m_frames_written;
+		snd_pcm_sframes_t m_avail_known;
+		uint64_t m_syscalls, m_hwsyncs;
+		lowrider_convert_in_func m_convert_in;
+		lowrider_convert_out_func m_convert_out;
 		lowrider_aligned_memory<uint8_t> m_temp_data;
 		bool m_running;
 
@@ -51,11 +78,23 @@ struct lowrider_backend_alsa::Private {
 			m_sample_rate = 0;
 			m_period_size = 0;
 			m_buffer_size = 0;
+			m_mmap = false;
+			m_mmap_offset = 0;
+			m_status = nullptr;
+			m_tstamp = false;
+			m_audio_tstamp = false;
+			m_frames_written = 0;
+			m_period_wakeup = true;
+			m_avail_known = -1;
+			m_syscalls = 0;
+			m_hwsyncs = 0;
+			m_convert_in = nullptr;
+			m_convert_out = nullptr;
 			m_running = false;
 		}
 
 		void open(snd_pcm_stream_t direction, const std::string &name, lowrider_sample_format sample_format,
-				  uint32_t channels, uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait) {
+				  uint32_t channels, uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait, bool mmap) {
 			assert(m_pcm == nullptr);
 
 			snd_pcm_hw_params_t *hw_params = nullptr;
@@ -70,6 +109,9 @@ struct lowrider_backend_alsa::Private {
 				if(snd_pcm_sw_params_malloc(&sw_params) < 0) {
 					throw std::bad_alloc();
 				}
+				if(snd_pcm_status_malloc(&m_status) < 0) {
+					throw std::bad_alloc();
+				}
 
 				// open PCM device
 				if(snd_pcm_open(&m_pcm, name.c_str(), direction, SND_PCM_NONBLOCK) < 0) {
@@ -81,8 +123,10 @@ struct lowrider_backend_alsa::Private {
 					throw std::runtime_error(make_string("failed to get hardware parameters of ALSA PCM '", name, "'"));
 				}
 
-				// set access type
-				if(snd_pcm_hw_params_set_access(m_pcm, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED) < 0) {
+				// Set access type. The mmap interface avoids the copy through m_temp_data and the readi/writei system calls,
+				// but some plugins don't support it.
+				m_mmap = (mmap && snd_pcm_hw_params_test_access(m_pcm, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0);
+				if(snd_pcm_hw_params_set_access(m_pcm, hw_params, (m_mmap)? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED) < 0) {
 					throw std::runtime_error(make_string("failed to set access type of ALSA PCM '", name, "'"));
 				}
 
@@ -95,6 +139,8 @@ struct lowrider_backend_alsa::Private {
 							m_sample_format = SND_PCM_FORMAT_S32;
 						} else if(snd_pcm_hw_params_test_format(m_pcm, hw_params, SND_PCM_FORMAT_S24) == 0) {
 							m_sample_format = SND_PCM_FORMAT_S24;
+						} else if(snd_pcm_hw_params_test_format(m_pcm, hw_params, SND_PCM_FORMAT_S24_3LE) == 0) {
+							m_sample_format = SND_PCM_FORMAT_S24_3LE;
 						} else if(snd_pcm_hw_params_test_format(m_pcm, hw_params, SND_PCM_FORMAT_S16) == 0) {
 							m_sample_format = SND_PCM_FORMAT_S16;
 						} else {
@@ -106,6 +152,7 @@ struct lowrider_backend_alsa::Private {
 					case lowrider_sample_format_s32: m_sample_format = SND_PCM_FORMAT_S32; break;
 					case lowrider_sample_format_s24: m_sample_format = SND_PCM_FORMAT_S24; break;
 					case lowrider_sample_format_s16: m_sample_format = SND_PCM_FORMAT_S16; break;
+					case lowrider_sample_format_s24_3le: m_sample_format = SND_PCM_FORMAT_S24_3LE; break;
 				}
 				if(snd_pcm_hw_params_set_format(m_pcm, hw_params, m_sample_format) < 0) {
 					throw std::runtime_error(make_string("failed to set sample format of ALSA PCM '", name, "'"));
@@ -140,11 +187,24 @@ struct lowrider_backend_alsa::Private {
 					throw std::runtime_error(make_string("failed to set buffer size of ALSA PCM '", name, "'"));
 				}
 
+				// If nobody waits on the device, the period interrupts are useless, so they are disabled when possible. The
+				// hardware pointer is then only updated when it is synchronized explicitly.
+				m_period_wakeup = true;
+				if(!wait && snd_pcm_hw_params_can_disable_period_wakeup(hw_params)) {
+					if(snd_pcm_hw_params_set_period_wakeup(m_pcm, hw_params, 0) < 0) {
+						throw std::runtime_error(make_string("failed to disable period wakeups of ALSA PCM '", name, "'"));
+					}
+					m_period_wakeup = false;
+				}
+
 				// apply hardware parameters
 				if(snd_pcm_hw_params(m_pcm, hw_params) < 0) {
 					throw std::runtime_error(make_string("failed to apply hardware parameters of ALSA PCM '", name, "'"));
 				}
 
+				// link audio timestamps give the exact playback position, rather than the position of the hardware pointer
+				m_audio_tstamp = snd_pcm_hw_params_supports_audio_ts_type(hw_params, SND_PCM_AUDIO_TSTAMP_TYPE_LINK);
+
 				// get software parameters
 				if(snd_pcm_sw_params_current(m_pcm, sw_params) < 0) {
 					throw std::runtime_error(make_string("failed to get software parameters of ALSA PCM '", name, "'"));
@@ -186,6 +246,11 @@ struct lowrider_backend_alsa::Private {
 					throw std::runtime_error(make_string("failed to set silence size of ALSA PCM '", name, "'"));
 				}
 
+				// Enable timestamps of the hardware pointer updates, using the same clock as the loopback. Older kernels don't
+				// support this clock, in which case the buffer level can't be extrapolated.
+				m_tstamp = (snd_pcm_sw_params_set_tstamp_mode(m_pcm, sw_params, SND_PCM_TSTAMP_ENABLE) == 0 &&
+							snd_pcm_sw_params_set_tstamp_type(m_pcm, sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC_RAW) == 0);
+
 				// apply software parameters
 				if(snd_pcm_sw_params(m_pcm, sw_params) < 0) {
 					throw std::runtime_error(make_string("failed to apply software parameters of ALSA PCM '", name, "'"));
@@ -195,35 +260,30 @@ struct lowrider_backend_alsa::Private {
 				if(snd_pcm_prepare(m_pcm) < 0) {
 					throw std::runtime_error(make_string("failed to prepare ALSA PCM '", name, "'"));
 				}
-
-				// allocate temp data
-				switch(m_sample_format) {
-					case SND_PCM_FORMAT_FLOAT: {
-						m_temp_data.allocate(16, (m_channels * m_buffer_size * sizeof(float) + 15) / 16 * 16);
-						break;
-					}
-					case SND_PCM_FORMAT_S32: {
-						m_temp_data.allocate(16, (m_channels * m_buffer_size * sizeof(int32_t) + 15) / 16 * 16);
-						break;
-					}
-					case SND_PCM_FORMAT_S24: {
-						m_temp_data.allocate(16, (m_channels * m_buffer_size * sizeof(int32_t) + 15) / 16 * 16);
-						break;
-					}
-					case SND_PCM_FORMAT_S16: {
-						m_temp_data.allocate(16, (m_channels * m_buffer_size * sizeof(int16_t) + 15) / 16 * 16);
-						break;
-					}
-					default: assert(false);
+				m_frames_written = 0;
+				m_avail_known = -1;
+
+				// select the conversion kernels
+				const lowrider_resampler_kernels &kernels = get_resampler_kernels();
+				uint32_t kernel_channels = (m_channels <= lowrider_resampler_kernels::CONVERT_CHANNELS_MAX)? m_channels : 0;
+				m_convert_in = kernels.convert_in[get_sample_format()][kernel_channels];
+				m_convert_out = kernels.convert_out[get_sample_format()][kernel_channels];
+
+				// allocate temp data (only needed for the RW interface)
+				if(!m_mmap) {
+					m_temp_data.allocate(16, (m_channels * m_buffer_size * get_sample_format_bytes(get_sample_format()) + 15) / 16 * 16);
 				}
 
 				std::cerr << "Info: ALSA PCM '" << name << "'";
 				std::cerr << " direction=" << snd_pcm_stream_name(direction);
+				std::cerr << " access=" << ((m_mmap)? "mmap" : "rw");
 				std::cerr << " format=" << snd_pcm_format_name(m_sample_format);
 				std::cerr << " channels=" << m_channels;
 				std::cerr << " rate=" << m_sample_rate;
 				std::cerr << " period=" << m_period_size;
 				std::cerr << " buffer=" << m_buffer_size;
+				std::cerr << " tstamp=" << ((m_audio_tstamp)? "link" : (m_tstamp)? "system" : "none");
+				std::cerr << " wakeup=" << ((m_period_wakeup)? "period" : "none");
 				std::cerr << std::endl;
 
 				// free parameter structures
@@ -237,6 +297,10 @@ struct lowrider_backend_alsa::Private {
 					snd_pcm_close(m_pcm);
 					m_pcm = nullptr;
 				}
+				if(m_status != nullptr) {
+					snd_pcm_status_free(m_status);
+					m_status = nullptr;
+				}
 				if(sw_params != nullptr) {
 					snd_pcm_sw_params_free(sw_params);
 					sw_params = nullptr;
@@ -255,10 +319,15 @@ struct lowrider_backend_alsa::Private {
 				snd_pcm_close(m_pcm);
 				m_pcm = nullptr;
 			}
+			if(m_status != nullptr) {
+				snd_pcm_status_free(m_status);
+				m_status = nullptr;
+			}
 			m_running = false;
 		}
 
 		void input_start() {
+			++m_syscalls;
 			if(snd_pcm_start(m_pcm) < 0) {
 				throw std::runtime_error("failed to start ALSA input");
 			}
@@ -267,6 +336,7 @@ struct lowrider_backend_alsa::Private {
 		}
 
 		void output_start() {
+			++m_syscalls;
 			if(snd_pcm_start(m_pcm) < 0) {
 				throw std::runtime_error("failed to start ALSA output");
 			}
@@ -278,6 +348,7 @@ struct lowrider_backend_alsa::Private {
 			assert(m_pcm != nullptr);
 			m_running = false;
 			std::cerr << "Warning: overrun in ALSA input" << std::endl;
+			++m_syscalls;
 			if(snd_pcm_prepare(m_pcm) < 0) {
 				throw std::runtime_error("failed to recover ALSA input after overrun");
 			}
@@ -287,13 +358,17 @@ struct lowrider_backend_alsa::Private {
 			assert(m_pcm != nullptr);
 			m_running = false;
 			std::cerr << "Warning: underrun in ALSA output" << std::endl;
+			++m_syscalls;
 			if(snd_pcm_prepare(m_pcm) < 0) {
 				throw std::runtime_error("failed to recover ALSA output after underrun");
 			}
+			m_frames_written = 0;
+			m_avail_known = -1;
 		}
 
 		bool input_wait(uint32_t timeout) {
 			assert(m_pcm != nullptr);
+			++m_syscalls;
 			int wait = snd_pcm_wait(m_pcm, timeout);
 			if(wait < 0) {
 				if(wait == -EPIPE) {
@@ -306,7 +381,230 @@ struct lowrider_backend_alsa::Private {
 			return (wait != 0);
 		}
 
-		uint32_t input_read(float * const *data, uint32_t size) {
+		// The conversion functions convert 'size' interleaved samples from/to the hardware format at 'buffer'
+		// to/from positions [pos, pos + size) of 'data'.
+		template<class Layout>
+		void convert_input(const Layout *data, const void *buffer, uint32_t pos, uint32_t size) {
+			switch(m_sample_format) {
+				case SND_PCM_FORMAT_FLOAT: {
+					const float *temp = (const float*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							(*data)(c, pos + i) = *(temp++);
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S32: {
+					const int32_t *temp = (const int32_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							(*data)(c, pos + i) = (float) *(temp++) * (float) (1.0 / 2147483648.0);
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S24: {
+					const int32_t *temp = (const int32_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							(*data)(c, pos + i) = (float) *(temp++) * (float) (1.0 / 8388608.0);
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S16: {
+					const int16_t *temp = (const int16_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							(*data)(c, pos + i) = (float) *(temp++) * (float) (1.0 / 32768.0);
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S24_3LE: {
+					const uint8_t *temp = (const uint8_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							int32_t x = (int32_t) ((uint32_t) temp[0] << 8 | (uint32_t) temp[1] << 16 | (uint32_t) temp[2] << 24) >> 8;
+							(*data)(c, pos + i) = (float) x * (float) (1.0 / 8388608.0);
+							temp += 3;
+						}
+					}
+					break;
+				}
+				default: assert(false);
+			}
+		}
+
+		// Planar float data is converted by the vectorized kernels, the generic code above is only used for interleaved data.
+		void convert_input(const PlanarLayout<float> *data, const void *buffer, uint32_t pos, uint32_t size) {
+			m_convert_in(m_channels, buffer, data->m_data, pos, size);
+		}
+
+		// The fixed-point path uses the samples without conversion, so the sample format must match.
+		template<typename T>
+		void copy_input(const PlanarLayout<T> *data, const void *buffer, uint32_t pos, uint32_t size) {
+			const T *temp = (const T*) buffer;
+			for(uint32_t i = 0; i < size; ++i) {
+				for(uint32_t c = 0; c < m_channels; ++c) {
+					(*data)(c, pos + i) = *(temp++);
+				}
+			}
+		}
+		void convert_input(const PlanarLayout<int16_t> *data, const void *buffer, uint32_t pos, uint32_t size) {
+			assert(m_sample_format == SND_PCM_FORMAT_S16);
+			copy_input(data, buffer, pos, size);
+		}
+		void convert_input(const PlanarLayout<int32_t> *data, const void *buffer, uint32_t pos, uint32_t size) {
+			assert(m_sample_format == SND_PCM_FORMAT_S32);
+			copy_input(data, buffer, pos, size);
+		}
+
+		template<class Layout>
+		void convert_output(const Layout *data, void *buffer, uint32_t pos, uint32_t size) {
+			switch(m_sample_format) {
+				case SND_PCM_FORMAT_FLOAT: {
+					float *temp = (float*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							*(temp++) = (*data)(c, pos + i);
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S32: {
+					int32_t *temp = (int32_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							*(temp++) = (int32_t) rint32(clamp((*data)(c, pos + i) * 2147483648.0f, -2147483648.0f, 2147483520.0f));
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S24: {
+					int32_t *temp = (int32_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							*(temp++) = (int32_t) rint32(clamp((*data)(c, pos + i) * 8388608.0f, -8388608.0f, 8388607.0f));
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S16: {
+					int16_t *temp = (int16_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							*(temp++) = (int16_t) rint32(clamp((*data)(c, pos + i) * 32768.0f, -32768.0f, 32767.0f));
+						}
+					}
+					break;
+				}
+				case SND_PCM_FORMAT_S24_3LE: {
+					uint8_t *temp = (uint8_t*) buffer;
+					for(uint32_t i = 0; i < (uint32_t) size; ++i) {
+						for(uint32_t c = 0; c < m_channels; ++c) {
+							int32_t x = rint32(clamp((*data)(c, pos + i) * 8388608.0f, -8388608.0f, 8388607.0f));
+							temp[0] = (uint8_t) x;
+							temp[1] = (uint8_t) (x >> 8);
+							temp[2] = (uint8_t) (x >> 16);
+							temp += 3;
+						}
+					}
+					break;
+				}
+				default: assert(false);
+			}
+		}
+
+		// See convert_input.
+		void convert_output(const PlanarLayout<const float> *data, void *buffer, uint32_t pos, uint32_t size) {
+			m_convert_out(m_channels, data->m_data, pos, buffer, size);
+		}
+
+		// See copy_input.
+		template<typename T>
+		void copy_output(const PlanarLayout<const T> *data, void *buffer, uint32_t pos, uint32_t size) {
+			T *temp = (T*) buffer;
+			for(uint32_t i = 0; i < size; ++i) {
+				for(uint32_t c = 0; c < m_channels; ++c) {
+					*(temp++) = (*data)(c, pos + i);
+				}
+			}
+		}
+		void convert_output(const PlanarLayout<const int16_t> *data, void *buffer, uint32_t pos, uint32_t size) {
+			assert(m_sample_format == SND_PCM_FORMAT_S16);
+			copy_output(data, buffer, pos, size);
+		}
+		void convert_output(const PlanarLayout<const int32_t> *data, void *buffer, uint32_t pos, uint32_t size) {
+			assert(m_sample_format == SND_PCM_FORMAT_S32);
+			copy_output(data, buffer, pos, size);
+		}
+
+		// all supported formats use all-zero bits for silence
+		void fill_silence(void *buffer, uint32_t size) {
+			std::fill_n((uint8_t*) buffer, m_channels * size * get_sample_format_bytes(get_sample_format()), 0);
+		}
+
+		// Returns the number of samples that can be transferred through the mmap interface without blocking,
+		// or -1 after an xrun. This synchronizes the hardware pointer, since it isn't updated without period
+		// wakeups, unless the free space in the output buffer is already known.
+		snd_pcm_sframes_t mmap_avail(const char *what) {
+			if(m_avail_known >= 0)
+				return m_avail_known;
+			++m_syscalls;
+			++m_hwsyncs;
+			snd_pcm_sframes_t avail = snd_pcm_avail(m_pcm);
+			if(avail < 0) {
+				if(avail == -EPIPE) {
+					return -1;
+				} else {
+					throw std::runtime_error(make_string("failed to get available samples of ALSA ", what));
+				}
+			}
+			return avail;
+		}
+
+		// Maps the next contiguous part of the hardware ring buffer. Returns the address of the first sample
+		// and updates 'offset' and 'frames', or returns nullptr after an xrun.
+		uint8_t* mmap_begin(snd_pcm_uframes_t &offset, snd_pcm_uframes_t &frames, const char *what) {
+			const snd_pcm_channel_area_t *areas;
+			int res = snd_pcm_mmap_begin(m_pcm, &areas, &offset, &frames);
+			if(res < 0) {
+				if(res == -EPIPE) {
+					return nullptr;
+				} else {
+					throw std::runtime_error(make_string("failed to map ALSA ", what, " buffer"));
+				}
+			}
+			// with interleaved access, all channels share one area and the first channel starts at the frame boundary
+			assert((snd_pcm_sframes_t) areas[0].step == 8 * snd_pcm_frames_to_bytes(m_pcm, 1));
+			return (uint8_t*) areas[0].addr + areas[0].first / 8 + offset * (areas[0].step / 8);
+		}
+
+		// Updates the counters after writing samples to the output.
+		void output_written(uint32_t size) {
+			m_frames_written += size;
+			if(m_avail_known >= 0) {
+				m_avail_known -= std::min((snd_pcm_sframes_t) size, m_avail_known);
+			}
+		}
+
+		// Returns the number of samples that were committed, which can be less than 'frames', or -1 after an xrun.
+		snd_pcm_sframes_t mmap_commit(snd_pcm_uframes_t offset, snd_pcm_uframes_t frames, const char *what) {
+			snd_pcm_sframes_t res = snd_pcm_mmap_commit(m_pcm, offset, frames);
+			if(res < 0) {
+				if(res == -EPIPE) {
+					return -1;
+				} else {
+					throw std::runtime_error(make_string("failed to commit ALSA ", what, " buffer"));
+				}
+			}
+			return std::min(res, (snd_pcm_sframes_t) frames);
+		}
+
+		template<class Layout>
+		uint32_t input_read(const Layout *data, uint32_t size) {
 			assert(m_pcm != nullptr);
 
 			// limit read size
@@ -314,7 +612,42 @@ struct lowrider_backend_alsa::Private {
 				size = m_buffer_size;
 			}
 
+			// read through mmap, converting straight from the hardware buffer
+			if(m_mmap) {
+				snd_pcm_sframes_t avail = mmap_avail("input");
+				if(avail < 0) {
+					input_recover();
+					return 0;
+				}
+				if(size > (snd_pcm_uframes_t) avail) {
+					size = (uint32_t) avail;
+				}
+				uint32_t pos = 0;
+				while(pos < size) {
+					snd_pcm_uframes_t offset, frames = size - pos;
+					uint8_t *buffer = mmap_begin(offset, frames, "input");
+					if(buffer == nullptr) {
+						input_recover();
+						return 0;
+					}
+					if(data != nullptr) {
+						convert_input(data, buffer, pos, (uint32_t) frames);
+					}
+					snd_pcm_sframes_t committed = mmap_commit(offset, frames, "input");
+					if(committed < 0) {
+						input_recover();
+						return 0;
+					}
+					pos += (uint32_t) committed;
+					if((snd_pcm_uframes_t) committed != frames)
+						break;
+				}
+				return pos;
+			}
+
 			// read the samples
+			++m_syscalls;
+			++m_hwsyncs;
 			snd_pcm_sframes_t samples_read = snd_pcm_readi(m_pcm, m_temp_data.data(), size);
 			if(samples_read < 0) {
 				if(samples_read == -EPIPE) {
@@ -331,51 +664,14 @@ struct lowrider_backend_alsa::Private {
 
 			// convert the samples
 			if(data != nullptr) {
-				switch(m_sample_format) {
-					case SND_PCM_FORMAT_FLOAT: {
-						float *temp = (float*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) samples_read; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								data[c][i] = *(temp++);
-							}
-						}
-						break;
-					}
-					case SND_PCM_FORMAT_S32: {
-						int32_t *temp = (int32_t*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) samples_read; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								data[c][i] = (float) *(temp++) * (float) (1.0 / 2147483648.0);
-							}
-						}
-						break;
-					}
-					case SND_PCM_FORMAT_S24: {
-						int32_t *temp = (int32_t*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) samples_read; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								data[c][i] = (float) *(temp++) * (float) (1.0 / 8388608.0);
-							}
-						}
-						break;
-					}
-					case SND_PCM_FORMAT_S16: {
-						int16_t *temp = (int16_t*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) samples_read; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								data[c][i] = (float) *(temp++) * (float) (1.0 / 32768.0);
-							}
-						}
-						break;
-					}
-					default: assert(false);
-				}
+				convert_input(data, m_temp_data.data(), 0, (uint32_t) samples_read);
 			}
 
 			return (uint32_t) samples_read;
 		}
 
-		uint32_t output_write(const float * const *data, uint32_t size) {
+		template<class Layout>
+		uint32_t output_write(const Layout *data, uint32_t size) {
 			assert(m_pcm != nullptr);
 
 			// limit write size
@@ -383,67 +679,52 @@ struct lowrider_backend_alsa::Private {
 				size = m_buffer_size;
 			}
 
-			// convert the samples
-			if(data == nullptr) {
-				switch(m_sample_format) {
-					case SND_PCM_FORMAT_FLOAT: {
-						std::fill_n((float*) m_temp_data.data(), m_channels * size, 0.0f);
-						break;
-					}
-					case SND_PCM_FORMAT_S32:
-					case SND_PCM_FORMAT_S24: {
-						std::fill_n((int32_t*) m_temp_data.data(), m_channels * size, 0);
-						break;
-					}
-					case SND_PCM_FORMAT_S16: {
-						std::fill_n((int16_t*) m_temp_data.data(), m_channels * size, 0);
-						break;
-					}
-					default: assert(false);
+			// write through mmap, converting straight into the hardware buffer
+			if(m_mmap) {
+				snd_pcm_sframes_t avail = mmap_avail("output");
+				if(avail < 0) {
+					output_recover();
+					return 0;
 				}
-			} else {
-				switch(m_sample_format) {
-					case SND_PCM_FORMAT_FLOAT: {
-						float *temp = (float*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) size; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								*(temp++) = data[c][i];
-							}
-						}
-						break;
+				if(size > (snd_pcm_uframes_t) avail) {
+					size = (uint32_t) avail;
+				}
+				uint32_t pos = 0;
+				while(pos < size) {
+					snd_pcm_uframes_t offset, frames = size - pos;
+					uint8_t *buffer = mmap_begin(offset, frames, "output");
+					if(buffer == nullptr) {
+						output_recover();
+						return 0;
 					}
-					case SND_PCM_FORMAT_S32: {
-						int32_t *temp = (int32_t*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) size; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								*(temp++) = (int32_t) rint32(clamp(data[c][i] * 2147483648.0f, -2147483648.0f, 2147483647.0f));
-							}
-						}
-						break;
+					if(data == nullptr) {
+						fill_silence(buffer, (uint32_t) frames);
+					} else {
+						convert_output(data, buffer, pos, (uint32_t) frames);
 					}
-					case SND_PCM_FORMAT_S24: {
-						int32_t *temp = (int32_t*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) size; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								*(temp++) = (int32_t) rint32(clamp(data[c][i] * 8388608.0f, -8388608.0f, 8388607.0f));
-							}
-						}
-						break;
+					snd_pcm_sframes_t committed = mmap_commit(offset, frames, "output");
+					if(committed < 0) {
+						output_recover();
+						return 0;
 					}
-					case SND_PCM_FORMAT_S16: {
-						int16_t *temp = (int16_t*) m_temp_data.data();
-						for(uint32_t i = 0; i < (uint32_t) size; ++i) {
-							for(uint32_t c = 0; c < m_channels; ++c) {
-								*(temp++) = (int16_t) rint32(clamp(data[c][i] * 32768.0f, -32768.0f, 32767.0f));
-							}
-						}
+					pos += (uint32_t) committed;
+					if((snd_pcm_uframes_t) committed != frames)
 						break;
-					}
-					default: assert(false);
 				}
+				output_written(pos);
+				return pos;
+			}
+
+			// convert the samples
+			if(data == nullptr) {
+				fill_silence(m_temp_data.data(), size);
+			} else {
+				convert_output(data, m_temp_data.data(), 0, size);
 			}
 
 			// write the samples
+			++m_syscalls;
+			++m_hwsyncs;
 			snd_pcm_sframes_t samples_written = snd_pcm_writei(m_pcm, m_temp_data.data(), size);
 			if(samples_written < 0) {
 				if(samples_written == -EPIPE) {
@@ -456,12 +737,97 @@ struct lowrider_backend_alsa::Private {
 				}
 			}
 
+			output_written((uint32_t) samples_written);
 			return samples_written;
 
 		}
 
+		// Returns the buffer that the next samples should be written to, in the device sample format, and limits 'size'
+		// to the number of samples that can be written without blocking. Returns nullptr if no samples can be written.
+		void* output_begin(uint32_t &size) {
+			assert(m_pcm != nullptr);
+
+			// limit write size
+			if(size > m_buffer_size) {
+				size = m_buffer_size;
+			}
+
+			// map the next part of the hardware buffer
+			if(m_mmap) {
+				snd_pcm_sframes_t avail = mmap_avail("output");
+				if(avail < 0) {
+					output_recover();
+					size = 0;
+					return nullptr;
+				}
+				if(size > (snd_pcm_uframes_t) avail) {
+					size = (uint32_t) avail;
+				}
+				if(size == 0) {
+					return nullptr;
+				}
+				snd_pcm_uframes_t frames = size;
+				uint8_t *buffer = mmap_begin(m_mmap_offset, frames, "output");
+				if(buffer == nullptr) {
+					output_recover();
+					size = 0;
+					return nullptr;
+				}
+				size = (uint32_t) frames;
+				return buffer;
+			}
+
+			// The samples are written from the temporary buffer later. A partial write would lose samples, so the size is
+			// limited to the free space in the buffer.
+			uint32_t avail = (m_avail_known >= 0)? (uint32_t) m_avail_known : output_avail();
+			if(size > avail) {
+				size = avail;
+			}
+			if(size == 0) {
+				return nullptr;
+			}
+			return m_temp_data.data();
+		}
+
+		// Writes the first 'size' samples of the buffer returned by output_begin to the output.
+		// Returns the actual number of samples written.
+		uint32_t output_commit(uint32_t size) {
+			assert(m_pcm != nullptr);
+
+			if(m_mmap) {
+				snd_pcm_sframes_t committed = mmap_commit(m_mmap_offset, size, "output");
+				if(committed < 0) {
+					output_recover();
+					return 0;
+				}
+				output_written((uint32_t) committed);
+				return (uint32_t) committed;
+			}
+
+			if(size == 0) {
+				return 0;
+			}
+			++m_syscalls;
+			++m_hwsyncs;
+			snd_pcm_sframes_t samples_written = snd_pcm_writei(m_pcm, m_temp_data.data(), size);
+			if(samples_written < 0) {
+				if(samples_written == -EPIPE) {
+					output_recover();
+					return 0;
+				} else if(samples_written == -EAGAIN) {
+					return 0;
+				} else {
+					throw std::runtime_error("failed to write to ALSA output");
+				}
+			}
+			output_written((uint32_t) samples_written);
+			return (uint32_t) samples_written;
+		}
+
 		uint32_t input_avail() {
 			assert(m_pcm != nullptr);
+			++m_syscalls;
+			++m_hwsyncs;
 			snd_pcm_sframes_t avail = snd_pcm_avail(m_pcm);
 			if(avail < 0) {
 				if(avail == -EPIPE) {
@@ -476,6 +842,8 @@ struct lowrider_backend_alsa::Private {
 
 		uint32_t output_avail() {
 			assert(m_pcm != nullptr);
+			++m_syscalls;
+			++m_hwsyncs;
 			snd_pcm_sframes_t avail = snd_pcm_avail(m_pcm);
 			if(avail < 0) {
 				if(avail == -EPIPE) {
@@ -485,15 +853,66 @@ struct lowrider_backend_alsa::Private {
 					throw std::runtime_error("failed to get available samples of ALSA output");
 				}
 			}
+			m_avail_known = std::min((snd_pcm_uframes_t) avail, m_buffer_size);
 			return (uint32_t) avail;
 		}
 
+		double output_level(uint64_t time) {
+			assert(m_pcm != nullptr);
+
+			// get the status, this also synchronizes the hardware pointer
+			if(m_audio_tstamp) {
+				snd_pcm_audio_tstamp_config_t config = {};
+				config.type_requested = SND_PCM_AUDIO_TSTAMP_TYPE_LINK;
+				snd_pcm_status_set_audio_htstamp_config(m_status, &config);
+			}
+			++m_syscalls;
+			++m_hwsyncs;
+			if(snd_pcm_status(m_pcm, m_status) < 0) {
+				throw std::runtime_error("failed to get status of ALSA output");
+			}
+			snd_pcm_state_t state = snd_pcm_status_get_state(m_status);
+			if(state == SND_PCM_STATE_XRUN) {
+				output_recover();
+				return 0.0;
+			}
+			snd_pcm_uframes_t avail = std::min(snd_pcm_status_get_avail(m_status), m_buffer_size);
+			m_avail_known = avail;
+			double level = (double) (m_buffer_size - avail);
+			if(!m_tstamp || state != SND_PCM_STATE_RUNNING)
+				return level;
+
+			// get the time of the last hardware pointer update
+			snd_htimestamp_t htstamp;
+			snd_pcm_status_get_htstamp(m_status, &htstamp);
+			uint64_t htstamp_time = (uint64_t) htstamp.tv_sec * (uint64_t) 1000000000 + (uint64_t) htstamp.tv_nsec;
+			if(htstamp_time == 0)
+				return level;
+
+			// The link timestamp is the playback position (relative to the start) at the same time, which is more accurate
+			// than the hardware pointer.
+			if(m_audio_tstamp) {
+				snd_pcm_audio_tstamp_report_t report;
+				snd_pcm_status_get_audio_htstamp_report(m_status, &report);
+				if(report.valid && report.actual_type == SND_PCM_AUDIO_TSTAMP_TYPE_LINK) {
+					snd_htimestamp_t audio_htstamp;
+					snd_pcm_status_get_audio_htstamp(m_status, &audio_htstamp);
+					double played = ((double) audio_htstamp.tv_sec + 1.0e-9 * (double) audio_htstamp.tv_nsec) * (double) m_sample_rate;
+					level = (double) m_frames_written - played;
+				}
+			}
+
+			// the buffer drains at the sample rate between the timestamp and the requested time
+			return level - 1.0e-9 * (double) (int64_t) (time - htstamp_time) * (double) m_sample_rate;
+		}
+
 		lowrider_sample_format get_sample_format() {
 			switch(m_sample_format) {
 				case SND_PCM_FORMAT_FLOAT: return lowrider_sample_format_f32;
 				case SND_PCM_FORMAT_S32: return lowrider_sample_format_s32;
 				case SND_PCM_FORMAT_S24: return lowrider_sample_format_s24;
 				case SND_PCM_FORMAT_S16: return lowrider_sample_format_s16;
+				case SND_PCM_FORMAT_S24_3LE: return lowrider_sample_format_s24_3le;
 				default: assert(false);
 			}
 			return lowrider_sample_format_any;
@@ -516,8 +935,8 @@ lowrider_backend_alsa::~lowrider_backend_alsa() {
 }
 
 void lowrider_backend_alsa::input_open(const std::string &name, lowrider_sample_format sample_format, uint32_t channels,
-									   uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait) {
-	m_private->m_input.open(SND_PCM_STREAM_CAPTURE, name, sample_format, channels, sample_rate, period_size, buffer_size, wait);
+									   uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait, bool mmap) {
+	m_private->m_input.open(SND_PCM_STREAM_CAPTURE, name, sample_format, channels, sample_rate, period_size, buffer_size, wait, mmap);
 }
 
 void lowrider_backend_alsa::input_close() {
@@ -537,7 +956,26 @@ bool lowrider_backend_alsa::input_wait(uint32_t timeout) {
 }
 
 uint32_t lowrider_backend_alsa::input_read(float * const *data, uint32_t size) {
-	return m_private->m_input.input_read(data, size);
+	if(data == nullptr) {
+		return m_private->m_input.input_read((PlanarLayout<float>*) nullptr, size);
+	}
+	PlanarLayout<float> layout(data);
+	return m_private->m_input.input_read(&layout, size);
+}
+
+uint32_t lowrider_backend_alsa::input_read_interleaved(float *data, uint32_t stride, uint32_t size) {
+	InterleavedLayout<float> layout(data, stride);
+	return m_private->m_input.input_read(&layout, size);
+}
+
+uint32_t lowrider_backend_alsa::input_read_s16(int16_t * const *data, uint32_t size) {
+	PlanarLayout<int16_t> layout(data);
+	return m_private->m_input.input_read(&layout, size);
+}
+
+uint32_t lowrider_backend_alsa::input_read_s32(int32_t * const *data, uint32_t size) {
+	PlanarLayout<int32_t> layout(data);
+	return m_private->m_input.input_read(&layout, size);
 }
 
 lowrider_sample_format lowrider_backend_alsa::input_get_sample_format() {
@@ -570,8 +1008,8 @@ uint32_t lowrider_backend_alsa::input_get_buffer_free() {
 }
 
 void lowrider_backend_alsa::output_open(const std::string &name, lowrider_sample_format sample_format, uint32_t channels,
-										uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait) {
-	m_private->m_output.open(SND_PCM_STREAM_PLAYBACK, name, sample_format, channels, sample_rate, period_size, buffer_size, wait);
+										uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait, bool mmap) {
+	m_private->m_output.open(SND_PCM_STREAM_PLAYBACK, name, sample_format, channels, sample_rate, period_size, buffer_size, wait, mmap);
 }
 
 void lowrider_backend_alsa::output_close() {
@@ -587,7 +1025,34 @@ bool lowrider_backend_alsa::output_running() {
 }
 
 uint32_t lowrider_backend_alsa::output_write(const float * const *data, uint32_t size) {
-	return m_private->m_output.output_write(data, size);
+	if(data == nullptr) {
+		return m_private->m_output.output_write((PlanarLayout<const float>*) nullptr, size);
+	}
+	PlanarLayout<const float> layout(data);
+	return m_private->m_output.output_write(&layout, size);
+}
+
+uint32_t lowrider_backend_alsa::output_write_interleaved(const float *data, uint32_t stride, uint32_t size) {
+	InterleavedLayout<const float> layout(data, stride);
+	return m_private->m_output.output_write(&layout, size);
+}
+
+uint32_t lowrider_backend_alsa::output_write_s16(const int16_t * const *data, uint32_t size) {
+	PlanarLayout<const int16_t> layout(data);
+	return m_private->m_output.output_write(&layout, size);
+}
+
+uint32_t lowrider_backend_alsa::output_write_s32(const int32_t * const *data, uint32_t size) {
+	PlanarLayout<const int32_t> layout(data);
+	return m_private->m_output.output_write(&layout, size);
+}
+
+void* lowrider_backend_alsa::output_begin(uint32_t &size) {
+	return m_private->m_output.output_begin(size);
+}
+
+uint32_t lowrider_backend_alsa::output_commit(uint32_t size) {
+	return m_private->m_output.output_commit(size);
 }
 
 lowrider_sample_format lowrider_backend_alsa::output_get_sample_format() {
@@ -615,6 +1080,18 @@ uint32_t lowrider_backend_alsa::output_get_buffer_used() {
 	return m_private->m_output.m_buffer_size - avail;
 }
 
+double lowrider_backend_alsa::output_get_buffer_level(uint64_t time) {
+	return m_private->m_output.output_level(time);
+}
+
+uint64_t lowrider_backend_alsa::get_syscall_count() {
+	return m_private->m_input.m_syscalls + m_private->m_output.m_syscalls;
+}
+
+uint64_t lowrider_backend_alsa::get_hwsync_count() {
+	return m_private->m_input.m_hwsyncs + m_private->m_output.m_hwsyncs;
+}
+
 uint32_t lowrider_backend_alsa::output_get_buffer_free() {
 	return std::min(m_private->m_output.output_avail(), (uint32_t) m_private->m_output.m_buffer_size);
 }
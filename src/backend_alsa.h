@@ -36,7 +36,9 @@ public:
 	lowrider_backend_alsa();
 	~lowrider_backend_alsa();
 
-	void input_open(const std::string &name, lowrider_sample_format sample_format, uint32_t channels, uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait);
+	// If 'mmap' is true, the device is accessed through the mmap interface when the device supports it, which avoids
+	// an intermediate copy. Otherwise (or if mmap is not supported) the read/write interface is used.
+	void input_open(const std::string &name, lowrider_sample_format sample_format, uint32_t channels, uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait, bool mmap);
 	void input_close();
 	void input_start();
 	bool input_running();
@@ -49,6 +51,14 @@ public:
 	// Returns the actual number of samples read.
 	uint32_t input_read(float * const *data, uint32_t size);
 
+	// Same as input_read, but the data is interleaved, i.e. sample i of channel c is stored at data[i * stride + c].
+	// Padding channels are not modified.
+	uint32_t input_read_interleaved(float *data, uint32_t stride, uint32_t size);
+
+	// Same as input_read, but the samples are not converted. The sample format must be S16 or S32 respectively.
+	uint32_t input_read_s16(int16_t * const *data, uint32_t size);
+	uint32_t input_read_s32(int32_t * const *data, uint32_t size);
+
 	lowrider_sample_format input_get_sample_format();
 	uint32_t input_get_channels();
 	uint32_t input_get_sample_rate();
@@ -57,7 +67,7 @@ public:
 	uint32_t input_get_buffer_used();
 	uint32_t input_get_buffer_free();
 
-	void output_open(const std::string &name, lowrider_sample_format sample_format, uint32_t channels, uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait);
+	void output_open(const std::string &name, lowrider_sample_format sample_format, uint32_t channels, uint32_t sample_rate, uint32_t period_size, uint32_t buffer_size, bool wait, bool mmap);
 	void output_close();
 	void output_start();
 	bool output_running();
@@ -66,12 +76,42 @@ public:
 	// Returns the actual number of samples written.
 	uint32_t output_write(const float * const *data, uint32_t size);
 
+	// Same as output_write, but the data is interleaved, i.e. sample i of channel c is read from data[i * stride + c].
+	uint32_t output_write_interleaved(const float *data, uint32_t stride, uint32_t size);
+
+	// Same as output_write, but the samples are not converted. The sample format must be S16 or S32 respectively.
+	uint32_t output_write_s16(const int16_t * const *data, uint32_t size);
+	uint32_t output_write_s32(const int32_t * const *data, uint32_t size);
+
+	// Zero-copy alternative to output_write. output_begin returns a buffer for at most 'size' interleaved samples in
+	// the device sample format (the hardware buffer if mmap is used) and limits 'size' to what can be written without
+	// blocking, or returns nullptr if nothing can be written. If a buffer was returned, output_commit must be called
+	// with the number of samples that were actually stored in it before any other output function is used.
+	// output_commit returns the actual number of samples written.
+	void* output_begin(uint32_t &size);
+	uint32_t output_commit(uint32_t size);
+
 	lowrider_sample_format output_get_sample_format();
 	uint32_t output_get_channels();
 	uint32_t output_get_sample_rate();
 	uint32_t output_get_period_size();
 	uint32_t output_get_buffer_size();
+	// These query the hardware pointer. The free space that is found is remembered, and output_write and output_begin use
+	// it (minus the samples that were written since then) instead of querying the hardware pointer again, so a loop that
+	// calls one of these before writing only needs one query per iteration. This is safe because the free space can only
+	// grow until the next write.
 	uint32_t output_get_buffer_used();
 	uint32_t output_get_buffer_free();
 
+	// Returns the number of samples in the output buffer at the given time (CLOCK_MONOTONIC_RAW in nanoseconds), which can
+	// be slightly in the past or the future. The level is extrapolated from the time at which the hardware pointer was last
+	// updated, so it doesn't depend on the granularity of the hardware pointer (e.g. USB packets) or on the time at which
+	// this function is called. If the device supports link audio timestamps, the exact playback position is used.
+	double output_get_buffer_level(uint64_t time);
+
+	// Returns the number of ALSA calls that entered the kernel, and how many of those synchronized the hardware pointer,
+	// for both devices since the backend was created. Calls that only access the mmapped status and control data aren't counted.
+	uint64_t get_syscall_count();
+	uint64_t get_hwsync_count();
+
 };
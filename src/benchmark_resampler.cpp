@@ -0,0 +1,473 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark_resampler.h"
+
+#include "fft_filter.h"
+#include "filter_bank_cache.h"
+#include "options.h"
+#include "resampler.h"
+#include "resampler_chain.h"
+#include "resampler_kernels.h"
+#include "sample_format.h"
+#include "timer.h"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Period used to simulate offline conversions.
+static constexpr uint32_t OFFLINE_PERIOD = 65536;
+
+// Measures the time needed to construct a resampler (i.e. to generate, load or look up the filter bank). Returns the best
+// time out of several runs, in nanoseconds. With skip_embedded and an empty cache_dir, the filter bank is always generated.
+static uint64_t benchmark_construction(float ratio, float passband, float stopband, float beta, lowrider_resampler_interpolation interpolation,
+									   lowrider_resampler_phase phase, const std::string &cache_dir, bool skip_embedded,
+									   uint32_t &filter_length, uint32_t &filter_rows, size_t &filter_bank_size) {
+	uint64_t best_time = UINT64_MAX, total_time = 0;
+	for(uint32_t run = 0; run < 20 && (run < 3 || total_time < 200000000); ++run) {
+		uint64_t t1 = get_time_nano();
+		lowrider_resampler resampler(ratio, passband, stopband, beta, g_option_resampler_gain, interpolation, phase, cache_dir, skip_embedded);
+		uint64_t t2 = get_time_nano();
+		best_time = std::min(best_time, t2 - t1);
+		total_time += t2 - t1;
+		filter_length = resampler.get_filter_length();
+		filter_rows = resampler.get_filter_rows();
+		filter_bank_size = resampler.get_filter_bank_size();
+	}
+	return best_time;
+}
+
+// Measures the time needed to resample one second of noise (or at least 4 periods) in blocks of one period, while changing
+// the ratio slightly for every block like loopback.cpp does. Returns the best time per output frame out of several runs,
+// in nanoseconds.
+double benchmark_throughput(lowrider_resampler_engine engine, bool multistage, uint32_t channels, uint32_t period, float passband, float stopband,
+							float beta, lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, uint32_t farrow_taps,
+							lowrider_resampler_storage storage, const std::string &cache_dir) {
+	lowrider_resampler_chain resampler(g_option_rate_in, g_option_rate_out, engine, multistage, period, passband, stopband,
+									   beta, g_option_resampler_gain, interpolation, phase, farrow_taps, cache_dir);
+	resampler.set_storage(storage);
+	float nominal_ratio = (float) g_option_rate_in / (float) g_option_rate_out;
+	bool interleaved = (channels >= lowrider_resampler::INTERLEAVED_CHANNELS_MIN);
+	uint32_t stride = (interleaved)? (channels + lowrider_resampler::INTERLEAVED_ALIGN - 1) / lowrider_resampler::INTERLEAVED_ALIGN * lowrider_resampler::INTERLEAVED_ALIGN : channels;
+
+	// generate input
+	uint32_t samples_in = std::max(g_option_rate_in, 4 * period) + resampler.get_filter_length();
+	uint32_t samples_out = resampler.calculate_size_out(samples_in) + period * 2;
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<float> data_in((size_t) stride * samples_in), data_out((size_t) stride * samples_out);
+	for(float &v : data_in) {
+		v = dist(rng);
+	}
+	std::vector<const float*> ptr_in(channels);
+	std::vector<float*> ptr_out(channels);
+
+	uint64_t best_time = UINT64_MAX;
+	uint32_t best_size_out = 1;
+	for(uint32_t run = 0; run < 5; ++run) {
+		resampler.reset();
+		uint32_t pos_in = 0, pos_out = 0, block = 0;
+		uint64_t t1 = get_time_nano();
+		while(pos_in + resampler.get_filter_length() + period <= samples_in) {
+			resampler.set_ratio(nominal_ratio * (1.0f + 1.0e-4f * (float) (block++ % 16)));
+			uint32_t size_in = resampler.get_filter_length() + period;
+			uint32_t size_out = std::min(resampler.calculate_size_out(size_in), samples_out - pos_out);
+			std::pair<uint32_t, uint32_t> p;
+			if(interleaved) {
+				p = resampler.resample_interleaved(stride, data_in.data() + (size_t) pos_in * stride, size_in, data_out.data() + (size_t) pos_out * stride, size_out);
+			} else {
+				for(uint32_t c = 0; c < channels; ++c) {
+					ptr_in[c] = data_in.data() + (size_t) c * samples_in + pos_in;
+					ptr_out[c] = data_out.data() + (size_t) c * samples_out + pos_out;
+				}
+				p = resampler.resample(channels, ptr_in.data(), size_in, ptr_out.data(), size_out);
+			}
+			pos_in += p.first;
+			pos_out += p.second;
+			if(p.first == 0 && p.second == 0)
+				break;
+		}
+		uint64_t t2 = get_time_nano();
+		if(t2 - t1 < best_time) {
+			best_time = t2 - t1;
+			best_size_out = std::max(1u, pos_out);
+		}
+	}
+	return (double) best_time / (double) best_size_out;
+}
+
+// Measures the time needed to convert one second of interleaved samples in a device format to planar floats and back, in
+// blocks of one period, like the ALSA backend does. Returns the best times per sample out of several runs (input and
+// output), in nanoseconds.
+static std::pair<double, double> benchmark_conversion(const lowrider_resampler_kernels &kernels, lowrider_sample_format format, uint32_t channels) {
+	uint32_t kernel_channels = (channels <= lowrider_resampler_kernels::CONVERT_CHANNELS_MAX)? channels : 0;
+	lowrider_convert_in_func convert_in = kernels.convert_in[format][kernel_channels];
+	lowrider_convert_out_func convert_out = kernels.convert_out[format][kernel_channels];
+	uint32_t period = g_option_period_in, samples = std::max(g_option_rate_in, 4 * period) / period * period;
+
+	// generate data
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<float> planar((size_t) channels * samples);
+	for(float &v : planar) {
+		v = dist(rng);
+	}
+	std::vector<uint8_t> device((size_t) channels * samples * get_sample_format_bytes(format));
+	std::vector<float*> ptr(channels);
+	for(uint32_t c = 0; c < channels; ++c) {
+		ptr[c] = planar.data() + (size_t) c * samples;
+	}
+	size_t block_bytes = (size_t) channels * period * get_sample_format_bytes(format);
+
+	uint64_t best_time_in = UINT64_MAX, best_time_out = UINT64_MAX;
+	for(uint32_t run = 0; run < 5; ++run) {
+		uint64_t t1 = get_time_nano();
+		for(uint32_t pos = 0; pos < samples; pos += period) {
+			convert_out(channels, ptr.data(), pos, device.data() + (size_t) (pos / period) * block_bytes, period);
+		}
+		uint64_t t2 = get_time_nano();
+		for(uint32_t pos = 0; pos < samples; pos += period) {
+			convert_in(channels, device.data() + (size_t) (pos / period) * block_bytes, ptr.data(), pos, period);
+		}
+		uint64_t t3 = get_time_nano();
+		best_time_out = std::min(best_time_out, t2 - t1);
+		best_time_in = std::min(best_time_in, t3 - t2);
+	}
+	double total = (double) samples * (double) channels;
+	return std::make_pair((double) best_time_in / total, (double) best_time_out / total);
+}
+
+// Same as benchmark_throughput, but for the fixed-point path of the polyphase engine with planar int16 or int32 data.
+template<typename T>
+static double benchmark_throughput_fixed_point(lowrider_resampler_fixed_point type, uint32_t channels, lowrider_resampler_interpolation interpolation,
+											   lowrider_resampler_phase phase, const std::string &cache_dir) {
+	lowrider_resampler_chain resampler(g_option_rate_in, g_option_rate_out, lowrider_resampler_engine_polyphase, false, g_option_period_in, g_option_resampler_passband,
+									   g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain, interpolation, phase,
+									   g_option_resampler_farrow_taps, cache_dir);
+	resampler.prepare_fixed_point(type);
+	float nominal_ratio = (float) g_option_rate_in / (float) g_option_rate_out;
+
+	// generate input
+	uint32_t samples_in = g_option_rate_in + resampler.get_filter_length();
+	uint32_t samples_out = resampler.calculate_size_out(samples_in) + g_option_period_in * 2;
+	std::mt19937 rng(12345);
+	std::uniform_int_distribution<T> dist(std::numeric_limits<T>::min() / 2, std::numeric_limits<T>::max() / 2);
+	std::vector<T> data_in((size_t) channels * samples_in), data_out((size_t) channels * samples_out);
+	for(T &v : data_in) {
+		v = dist(rng);
+	}
+	std::vector<const T*> ptr_in(channels);
+	std::vector<T*> ptr_out(channels);
+
+	uint64_t best_time = UINT64_MAX;
+	uint32_t best_size_out = 1;
+	for(uint32_t run = 0; run < 5; ++run) {
+		resampler.reset();
+		uint32_t pos_in = 0, pos_out = 0, block = 0;
+		uint64_t t1 = get_time_nano();
+		while(pos_in + resampler.get_filter_length() + g_option_period_in <= samples_in) {
+			resampler.set_ratio(nominal_ratio * (1.0f + 1.0e-4f * (float) (block++ % 16)));
+			uint32_t size_in = resampler.get_filter_length() + g_option_period_in;
+			uint32_t size_out = std::min(resampler.calculate_size_out(size_in), samples_out - pos_out);
+			for(uint32_t c = 0; c < channels; ++c) {
+				ptr_in[c] = data_in.data() + (size_t) c * samples_in + pos_in;
+				ptr_out[c] = data_out.data() + (size_t) c * samples_out + pos_out;
+			}
+			std::pair<uint32_t, uint32_t> p = resampler.resample(channels, ptr_in.data(), size_in, ptr_out.data(), size_out);
+			pos_in += p.first;
+			pos_out += p.second;
+			if(p.first == 0 && p.second == 0)
+				break;
+		}
+		uint64_t t2 = get_time_nano();
+		if(t2 - t1 < best_time) {
+			best_time = t2 - t1;
+			best_size_out = std::max(1u, pos_out);
+		}
+	}
+	return (double) best_time / (double) best_size_out;
+}
+
+void benchmark_resampler() {
+
+	float ratio = (float) g_option_rate_in / (float) g_option_rate_out;
+
+	std::cout << "Input Rate:      " << std::fixed << std::setw(14) << std::setprecision(2) << g_option_rate_in << " Hz" << std::endl;
+	std::cout << "Output Rate:     " << std::fixed << std::setw(14) << std::setprecision(2) << g_option_rate_out << " Hz" << std::endl;
+	std::cout << "Threads:         " << std::setw(14) << std::max(1u, std::thread::hardware_concurrency()) << std::endl;
+	std::cout << "Phase:           " << std::setw(14) << ((g_option_resampler_phase == lowrider_resampler_phase_minimum)? "minimum" : "linear") << std::endl;
+
+	// filter bank generation time
+	struct band {
+		float passband, stopband;
+	};
+	const band bands[] = {
+		{0.40f, 0.54f},
+		{0.42f, 0.50f},
+		{0.45f, 0.50f},
+	};
+	std::cout << std::endl;
+	std::cout << "Passband   Stopband   Beta   Interpolation   Filter Length   Filter Rows   Filter Bank (KiB)   Time (ms)   Time per Coef (ns)" << std::endl;
+	for(const band &b : bands) {
+		for(float beta : {4.0f, 6.0f, 8.0f, 10.0f, 12.0f, 14.0f, 16.0f}) {
+			for(lowrider_resampler_interpolation interpolation : {lowrider_resampler_interpolation_linear, lowrider_resampler_interpolation_cubic}) {
+				uint32_t filter_length, filter_rows;
+				size_t filter_bank_size;
+				uint64_t time = benchmark_construction(ratio, b.passband, b.stopband, beta, interpolation, g_option_resampler_phase, std::string(), true,
+														filter_length, filter_rows, filter_bank_size);
+				std::ios_base::fmtflags flags(std::cout.flags());
+				std::cout << std::fixed << std::setw(8) << std::setprecision(2) << b.passband;
+				std::cout << std::fixed << std::setw(11) << std::setprecision(2) << b.stopband;
+				std::cout << std::fixed << std::setw(7) << std::setprecision(1) << beta;
+				std::cout << "   " << std::left << std::setw(13) << ((interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear") << std::right;
+				std::cout << std::setw(16) << filter_length;
+				std::cout << std::setw(14) << filter_rows;
+				std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) filter_bank_size / 1024.0);
+				std::cout << std::fixed << std::setw(12) << std::setprecision(3) << ((double) time * 1.0e-6);
+				std::cout << std::fixed << std::setw(21) << std::setprecision(2) << ((double) time / (double) (filter_bank_size / sizeof(float)));
+				std::cout << std::endl;
+				std::cout.flags(flags);
+			}
+		}
+	}
+
+	// resampling throughput
+	std::cout << std::endl;
+	std::cout << "Engine      Multistage   Interpolation   Channels   Time per Frame (ns)   Time per Sample (ns)" << std::endl;
+	bool multistage_possible = (lowrider_resampler_chain::get_halfband_decimate_stages(g_option_rate_in, g_option_rate_out) != 0 ||
+								lowrider_resampler_chain::get_halfband_interpolate_stages(g_option_rate_in, g_option_rate_out) != 0);
+	for(lowrider_resampler_engine engine : {lowrider_resampler_engine_polyphase, lowrider_resampler_engine_rational, lowrider_resampler_engine_fft,
+											lowrider_resampler_engine_farrow, lowrider_resampler_engine_slip}) {
+		for(bool multistage : {false, true}) {
+			if(multistage && !multistage_possible)
+				continue;
+			if(lowrider_resampler_chain::resolve_engine(g_option_rate_in, g_option_rate_out, engine, multistage, g_option_period_in, g_option_resampler_passband,
+														g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_phase) != engine)
+				continue;
+			for(lowrider_resampler_interpolation interpolation : {lowrider_resampler_interpolation_linear, lowrider_resampler_interpolation_cubic}) {
+				for(uint32_t channels : {2u, 16u}) {
+					double time = benchmark_throughput(engine, multistage, channels, g_option_period_in, g_option_resampler_passband, g_option_resampler_stopband,
+													   g_option_resampler_beta, interpolation, g_option_resampler_phase, g_option_resampler_farrow_taps, g_option_resampler_storage, std::string());
+					std::ios_base::fmtflags flags(std::cout.flags());
+					std::cout << std::left << std::setw(9) << get_resampler_engine_name(engine) << std::right;
+					std::cout << "   " << std::left << std::setw(10) << ((multistage)? "yes" : "no") << std::right;
+					std::cout << "   " << std::left << std::setw(13) << ((interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear") << std::right;
+					std::cout << std::setw(11) << channels;
+					std::cout << std::fixed << std::setw(22) << std::setprecision(2) << time;
+					std::cout << std::fixed << std::setw(23) << std::setprecision(2) << (time / (double) channels);
+					std::cout << std::endl;
+					std::cout.flags(flags);
+				}
+			}
+		}
+	}
+
+	// fixed-point throughput, compared with the floating point path
+	std::cout << std::endl;
+	std::cout << "Format   Interpolation   Channels   Time per Frame (ns)   Time per Sample (ns)" << std::endl;
+	for(lowrider_sample_format format : {lowrider_sample_format_f32, lowrider_sample_format_s16, lowrider_sample_format_s32}) {
+		for(lowrider_resampler_interpolation interpolation : {lowrider_resampler_interpolation_linear, lowrider_resampler_interpolation_cubic}) {
+			for(uint32_t channels : {1u, 2u, 8u}) {
+				double time = 0.0;
+				switch(format) {
+					case lowrider_sample_format_s16: {
+						time = benchmark_throughput_fixed_point<int16_t>(lowrider_resampler_fixed_point_s16, channels, interpolation, g_option_resampler_phase, std::string());
+						break;
+					}
+					case lowrider_sample_format_s32: {
+						time = benchmark_throughput_fixed_point<int32_t>(lowrider_resampler_fixed_point_s32, channels, interpolation, g_option_resampler_phase, std::string());
+						break;
+					}
+					default: {
+						time = benchmark_throughput(lowrider_resampler_engine_polyphase, false, channels, g_option_period_in, g_option_resampler_passband,
+													g_option_resampler_stopband, g_option_resampler_beta, interpolation, g_option_resampler_phase,
+													g_option_resampler_farrow_taps, g_option_resampler_storage, std::string());
+						break;
+					}
+				}
+				std::ios_base::fmtflags flags(std::cout.flags());
+				std::cout << std::left << std::setw(6) << ((format == lowrider_sample_format_s16)? "s16" : (format == lowrider_sample_format_s32)? "s32" : "f32") << std::right;
+				std::cout << "   " << std::left << std::setw(13) << ((interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear") << std::right;
+				std::cout << std::setw(11) << channels;
+				std::cout << std::fixed << std::setw(22) << std::setprecision(2) << time;
+				std::cout << std::fixed << std::setw(23) << std::setprecision(2) << (time / (double) channels);
+				std::cout << std::endl;
+				std::cout.flags(flags);
+			}
+		}
+	}
+
+	// Throughput with 16-bit filter bank storage. This mostly matters for large filter banks (high beta with linear
+	// interpolation) that don't fit in the cache.
+	std::cout << std::endl;
+	std::cout << "Storage   Beta   Interpolation   Channels   Filter Bank (KiB)   Time per Frame (ns)   Time per Sample (ns)" << std::endl;
+	for(float beta : {8.0f, 12.0f, 16.0f}) {
+		for(lowrider_resampler_interpolation interpolation : {lowrider_resampler_interpolation_linear, lowrider_resampler_interpolation_cubic}) {
+			lowrider_resampler resampler(ratio, g_option_resampler_passband, g_option_resampler_stopband, beta, g_option_resampler_gain,
+										 interpolation, g_option_resampler_phase, std::string(), false);
+			for(lowrider_resampler_storage storage : {lowrider_resampler_storage_f32, lowrider_resampler_storage_f16, lowrider_resampler_storage_bf16}) {
+				resampler.set_storage(storage);
+				uint32_t channels = 2;
+				double time = benchmark_throughput(lowrider_resampler_engine_polyphase, false, channels, g_option_period_in, g_option_resampler_passband,
+												   g_option_resampler_stopband, beta, interpolation, g_option_resampler_phase, g_option_resampler_farrow_taps, storage, std::string());
+				std::ios_base::fmtflags flags(std::cout.flags());
+				std::cout << std::left << std::setw(7) << get_resampler_storage_name(storage) << std::right;
+				std::cout << std::fixed << std::setw(7) << std::setprecision(1) << beta;
+				std::cout << "   " << std::left << std::setw(13) << ((interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear") << std::right;
+				std::cout << std::setw(11) << channels;
+				std::cout << std::fixed << std::setw(20) << std::setprecision(2) << ((double) resampler.get_filter_bank_storage_size() / 1024.0);
+				std::cout << std::fixed << std::setw(22) << std::setprecision(2) << time;
+				std::cout << std::fixed << std::setw(23) << std::setprecision(2) << (time / (double) channels);
+				std::cout << std::endl;
+				std::cout.flags(flags);
+			}
+		}
+	}
+
+	// Throughput of the FFT engine compared with the polyphase engine for increasingly long filters, in large blocks (like
+	// an offline conversion). The block size is the same for both engines. Both engines are measured several times
+	// (alternately) and the best time is used, so a single lucky run doesn't decide the result. The crossover point is the
+	// shortest measured filter length above which the FFT engine is faster at every measured point, which is what
+	// FFT_FILTER_LENGTH_MIN should be based on.
+	std::cout << std::endl;
+	std::cout << "Passband   Stopband   Beta   Filter Length   FFT Size   Polyphase (ns/frame)   FFT (ns/frame)   Speedup" << std::endl;
+	uint32_t fft_slower_max = 0, fft_faster_min = UINT32_MAX;
+	std::vector<uint32_t> fft_faster_lengths;
+	for(const band &b : {band{0.42f, 0.50f}, band{0.45f, 0.50f}, band{0.48f, 0.50f}, band{0.49f, 0.50f}}) {
+		for(float beta : {8.0f, 12.0f, 16.0f, 20.0f}) {
+			uint32_t filter_length = lowrider_resampler::calculate_filter_length(ratio, b.passband, b.stopband, beta);
+			uint32_t block_size = lowrider_fft_filter::calculate_block_size(ratio, b.passband, b.stopband, beta);
+			uint32_t period = std::max(OFFLINE_PERIOD, block_size);
+			uint32_t fft_size = block_size + lowrider_fft_filter::calculate_filter_length(ratio, b.passband, b.stopband, beta) - 1;
+			uint32_t channels = 2;
+			double time_polyphase = std::numeric_limits<double>::max(), time_fft = std::numeric_limits<double>::max();
+			for(uint32_t run = 0; run < 3; ++run) {
+				time_polyphase = std::min(time_polyphase, benchmark_throughput(lowrider_resampler_engine_polyphase, false, channels, period, b.passband, b.stopband, beta,
+																			   g_option_resampler_interpolation, lowrider_resampler_phase_linear, g_option_resampler_farrow_taps,
+																			   lowrider_resampler_storage_f32, std::string()));
+				time_fft = std::min(time_fft, benchmark_throughput(lowrider_resampler_engine_fft, false, channels, period, b.passband, b.stopband, beta,
+																   g_option_resampler_interpolation, lowrider_resampler_phase_linear, g_option_resampler_farrow_taps,
+																   lowrider_resampler_storage_f32, std::string()));
+			}
+			if(time_fft < time_polyphase) {
+				fft_faster_lengths.push_back(filter_length);
+			} else {
+				fft_slower_max = std::max(fft_slower_max, filter_length);
+			}
+			std::ios_base::fmtflags flags(std::cout.flags());
+			std::cout << std::fixed << std::setw(8) << std::setprecision(2) << b.passband;
+			std::cout << std::fixed << std::setw(11) << std::setprecision(2) << b.stopband;
+			std::cout << std::fixed << std::setw(7) << std::setprecision(1) << beta;
+			std::cout << std::setw(16) << filter_length;
+			std::cout << std::setw(11) << fft_size;
+			std::cout << std::fixed << std::setw(23) << std::setprecision(2) << time_polyphase;
+			std::cout << std::fixed << std::setw(17) << std::setprecision(2) << time_fft;
+			std::cout << std::fixed << std::setw(9) << std::setprecision(2) << (time_polyphase / time_fft) << "x";
+			std::cout << std::endl;
+			std::cout.flags(flags);
+		}
+	}
+	for(uint32_t filter_length : fft_faster_lengths) {
+		if(filter_length > fft_slower_max)
+			fft_faster_min = std::min(fft_faster_min, filter_length);
+	}
+	std::cout << std::endl;
+	if(fft_faster_min == UINT32_MAX) {
+		std::cout << "Crossover:       " << std::setw(14) << "-" << " (the FFT engine was not consistently faster)" << std::endl;
+	} else {
+		std::cout << "Crossover:       " << std::setw(14) << fft_faster_min << " taps" << std::endl;
+	}
+	std::cout << "Auto threshold:  " << std::setw(14) << lowrider_resampler_chain::FFT_FILTER_LENGTH_MIN << " taps" << std::endl;
+
+	// Throughput of the sample format conversions used by the ALSA backend, for the scalar reference implementation and
+	// the vectorized kernels.
+	std::cout << std::endl;
+	std::cout << "Format    Channels   Kernel   Input (ns/sample)   Output (ns/sample)" << std::endl;
+	for(lowrider_sample_format format : {lowrider_sample_format_f32, lowrider_sample_format_s32, lowrider_sample_format_s24,
+										 lowrider_sample_format_s24_3le, lowrider_sample_format_s16}) {
+		for(uint32_t channels : {2u, 8u, 32u}) {
+			for(const lowrider_resampler_kernels *kernels : {&g_resampler_kernels_scalar, &get_resampler_kernels()}) {
+				std::pair<double, double> time = benchmark_conversion(*kernels, format, channels);
+				const char *format_name = (format == lowrider_sample_format_f32)? "f32" : (format == lowrider_sample_format_s32)? "s32" :
+										  (format == lowrider_sample_format_s24)? "s24" : (format == lowrider_sample_format_s16)? "s16" : "s24_3le";
+				std::ios_base::fmtflags flags(std::cout.flags());
+				std::cout << std::left << std::setw(7) << format_name << std::right;
+				std::cout << std::setw(11) << channels;
+				std::cout << "   " << std::left << std::setw(6) << kernels->name << std::right;
+				std::cout << std::fixed << std::setw(20) << std::setprecision(3) << time.first;
+				std::cout << std::fixed << std::setw(21) << std::setprecision(3) << time.second;
+				std::cout << std::endl;
+				std::cout.flags(flags);
+			}
+		}
+	}
+
+	// construction time with the current parameters
+	// This uses the same ratio as loopback.cpp. The first cached construction stores the filter bank in the cache (if it
+	// wasn't already there), the others load it. The cached time is only shown if the cache is enabled, and the embedded
+	// time only if there is a matching embedded filter bank.
+	{
+		uint32_t filter_length, filter_rows;
+		size_t filter_bank_size;
+		std::string cache_dir = (g_option_resampler_cache)? get_filter_bank_cache_dir() : std::string();
+		uint64_t time_generated = benchmark_construction(ratio, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+														 g_option_resampler_interpolation, g_option_resampler_phase, std::string(), true,
+														 filter_length, filter_rows, filter_bank_size);
+		lowrider_resampler resampler(ratio, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain,
+									 g_option_resampler_interpolation, g_option_resampler_phase, std::string(), false);
+		bool embedded = (resampler.get_filter_bank_source() == lowrider_filter_bank_source_embedded);
+		uint64_t time_cached = 0, time_embedded = 0;
+		if(!cache_dir.empty()) {
+			time_cached = benchmark_construction(ratio, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+												 g_option_resampler_interpolation, g_option_resampler_phase, cache_dir, true,
+												 filter_length, filter_rows, filter_bank_size);
+		}
+		if(embedded) {
+			time_embedded = benchmark_construction(ratio, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+												   g_option_resampler_interpolation, g_option_resampler_phase, std::string(), false,
+												   filter_length, filter_rows, filter_bank_size);
+		}
+		std::ios_base::fmtflags flags(std::cout.flags());
+		std::cout << std::endl;
+		std::cout << "Construction time with the current resampler parameters:" << std::endl;
+		std::cout << "Generated (us)   Cached (us)   Embedded (us)" << std::endl;
+		std::cout << std::fixed << std::setw(14) << std::setprecision(3) << ((double) time_generated * 1.0e-3);
+		if(!cache_dir.empty()) {
+			std::cout << std::fixed << std::setw(14) << std::setprecision(3) << ((double) time_cached * 1.0e-3);
+		} else {
+			std::cout << std::setw(14) << "-";
+		}
+		if(embedded) {
+			std::cout << std::fixed << std::setw(16) << std::setprecision(3) << ((double) time_embedded * 1.0e-3);
+		} else {
+			std::cout << std::setw(16) << "-";
+		}
+		std::cout << std::endl;
+		std::cout.flags(flags);
+	}
+
+}
@@ -0,0 +1,33 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "resampler_types.h"
+
+#include <cstdint>
+
+#include <string>
+
+// Measures the throughput of a resampler chain with the given parameters, in nanoseconds per output frame.
+double benchmark_throughput(lowrider_resampler_engine engine, bool multistage, uint32_t channels, uint32_t period, float passband, float stopband,
+							float beta, lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, uint32_t farrow_taps,
+							lowrider_resampler_storage storage, const std::string &cache_dir);
+
+void benchmark_resampler();
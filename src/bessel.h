@@ -1 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <cmath>
+
 double bessel_i0(double x);
+
+// Calculates y[i] = bessel_i0(x[i]) for i < n.
+void bessel_i0(const double *x, double *y, size_t n);
+
+// Kaiser window, x ranges from -1 to 1.
+inline double kaiser(double x, double beta) {
+	return bessel_i0(beta * std::sqrt(std::max(0.0, 1.0 - x * x))) / bessel_i0(beta);
+}
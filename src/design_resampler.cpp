@@ -0,0 +1,238 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "design_resampler.h"
+
+#include "analyze_resampler.h"
+#include "benchmark_resampler.h"
+#include "farrow.h"
+#include "filter_bank_cache.h"
+#include "options.h"
+#include "resampler.h"
+#include "resampler_chain.h"
+#include "resampler_kernels.h"
+#include "string_helper.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Number of test frequencies used to measure the SNR of each candidate. This is coarser than analyze_resampler, because
+// there are a lot of candidates and the SNR only has to be accurate enough to rank them.
+static constexpr uint32_t DESIGN_FREQUENCIES = 64;
+
+// Parameter grid searched by design_resampler. Passbands that are narrower than --resampler-passband are skipped, since
+// the SNR is always measured up to --resampler-passband.
+static constexpr float DESIGN_PASSBANDS[] = {0.40f, 0.42f, 0.44f, 0.45f, 0.46f};
+static constexpr float DESIGN_STOPBANDS[] = {0.50f, 0.54f};
+static constexpr float DESIGN_BETAS[] = {4.0f, 6.0f, 8.0f, 10.0f, 12.0f, 14.0f, 16.0f};
+
+struct design_candidate {
+	lowrider_resampler_engine engine;
+	bool multistage;
+	float passband, stopband, beta;
+	lowrider_resampler_interpolation interpolation;
+	lowrider_resampler_phase phase;
+	uint32_t farrow_taps;
+	uint32_t stages;
+	double snr, latency, time;
+};
+
+// Returns true if candidate 'a' is at least as good as 'b' in every respect and better in at least one.
+static bool dominates(const design_candidate &a, const design_candidate &b) {
+	if(a.snr < b.snr || a.latency > b.latency || a.time > b.time)
+		return false;
+	return (a.snr > b.snr || a.latency < b.latency || a.time < b.time);
+}
+
+// Returns true if the engine uses the passband, stopband, beta, interpolation and phase parameters.
+static bool engine_uses_filter(lowrider_resampler_engine engine) {
+	return (engine != lowrider_resampler_engine_farrow && engine != lowrider_resampler_engine_slip);
+}
+
+static std::string get_option_string(const design_candidate &c) {
+	std::string result = make_string("--resampler-engine=", get_resampler_engine_name(c.engine), " --resampler-multistage=", (c.multistage)? "true" : "false");
+	if(engine_uses_filter(c.engine)) {
+		result += make_string(" --resampler-passband=", c.passband, " --resampler-stopband=", c.stopband, " --resampler-beta=", c.beta,
+							  " --resampler-interpolation=", (c.interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear",
+							  " --resampler-phase=", (c.phase == lowrider_resampler_phase_minimum)? "minimum" : "linear");
+	} else if(c.engine == lowrider_resampler_engine_farrow) {
+		result += make_string(" --resampler-farrow-taps=", c.farrow_taps);
+	}
+	return result;
+}
+
+static void print_candidate(const design_candidate &c) {
+	std::string interpolation_name = (c.engine == lowrider_resampler_engine_farrow)? make_string(c.farrow_taps, " taps") :
+									 (c.engine == lowrider_resampler_engine_slip)? "-" :
+									 (c.interpolation == lowrider_resampler_interpolation_cubic)? "cubic" : "linear";
+	std::ios_base::fmtflags flags(std::cout.flags());
+	std::cout << std::left << std::setw(9) << get_resampler_engine_name(c.engine) << std::right;
+	std::cout << std::setw(9) << c.stages;
+	if(engine_uses_filter(c.engine)) {
+		std::cout << std::fixed << std::setw(11) << std::setprecision(2) << c.passband;
+		std::cout << std::fixed << std::setw(11) << std::setprecision(2) << c.stopband;
+		std::cout << std::fixed << std::setw(7) << std::setprecision(1) << c.beta;
+	} else {
+		std::cout << std::setw(11) << "-" << std::setw(11) << "-" << std::setw(7) << "-";
+	}
+	std::cout << "   " << std::left << std::setw(13) << interpolation_name << std::right;
+	std::cout << "   " << std::left << std::setw(8) << ((c.phase == lowrider_resampler_phase_minimum)? "minimum" : "linear") << std::right;
+	std::cout << std::fixed << std::setw(11) << std::setprecision(2) << (10.0 * std::log10(c.snr));
+	std::cout << std::fixed << std::setw(15) << std::setprecision(3) << (c.latency * 1e3);
+	std::cout << std::fixed << std::setw(24) << std::setprecision(2) << c.time;
+	std::cout << std::endl;
+	std::cout.flags(flags);
+}
+
+void design_resampler() {
+
+	float ratio = (float) g_option_rate_in / (float) g_option_rate_out * 0.999f;
+	float passband = g_option_resampler_passband * (float) std::min(g_option_rate_in, g_option_rate_out);
+	uint32_t channels = g_option_channels_in;
+	std::string cache_dir = (g_option_resampler_cache)? get_filter_bank_cache_dir() : std::string();
+
+	std::cout << "Input Rate:      " << std::fixed << std::setw(14) << std::setprecision(2) << g_option_rate_in << " Hz" << std::endl;
+	std::cout << "Output Rate:     " << std::fixed << std::setw(14) << std::setprecision(2) << g_option_rate_out << " Hz" << std::endl;
+	std::cout << "Passband:        " << std::fixed << std::setw(14) << std::setprecision(2) << passband << " Hz" << std::endl;
+	std::cout << "Channels:        " << std::setw(14) << channels << std::endl;
+	std::cout << "Period:          " << std::setw(14) << g_option_period_in << std::endl;
+	std::cout << "Storage:         " << std::setw(14) << get_resampler_storage_name(g_option_resampler_storage) << std::endl;
+	std::cout << "Kernel:          " << std::setw(14) << get_resampler_kernels().name << std::endl;
+	if(g_option_max_latency > 0.0f) {
+		std::cout << "Max latency:     " << std::fixed << std::setw(14) << std::setprecision(3) << g_option_max_latency << " ms" << std::endl;
+	} else {
+		std::cout << "Max latency:     " << std::setw(14) << "-" << std::endl;
+	}
+	if(g_option_max_cpu > 0.0f) {
+		std::cout << "Max CPU:         " << std::fixed << std::setw(14) << std::setprecision(2) << g_option_max_cpu << " ns/sample" << std::endl;
+	} else {
+		std::cout << "Max CPU:         " << std::setw(14) << "-" << std::endl;
+	}
+
+	// generate the candidates
+	std::vector<design_candidate> candidates;
+	bool multistage_possible = (lowrider_resampler_chain::get_halfband_decimate_stages(g_option_rate_in, g_option_rate_out) != 0 ||
+								lowrider_resampler_chain::get_halfband_interpolate_stages(g_option_rate_in, g_option_rate_out) != 0);
+	for(lowrider_resampler_engine engine : {lowrider_resampler_engine_polyphase, lowrider_resampler_engine_rational, lowrider_resampler_engine_fft,
+											lowrider_resampler_engine_farrow, lowrider_resampler_engine_slip}) {
+		if(g_option_resampler_engine != lowrider_resampler_engine_auto && engine != g_option_resampler_engine)
+			continue;
+		for(bool multistage : {false, true}) {
+			if(multistage && !multistage_possible)
+				continue;
+			if(engine == lowrider_resampler_engine_farrow) {
+				for(uint32_t taps = lowrider_farrow::TAPS_MIN; taps <= lowrider_farrow::TAPS_MAX; taps += 2) {
+					candidates.push_back({engine, multistage, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+										  g_option_resampler_interpolation, lowrider_resampler_phase_linear, taps, 0, 0.0, 0.0, 0.0});
+				}
+			} else if(engine == lowrider_resampler_engine_slip) {
+				candidates.push_back({engine, multistage, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+									  g_option_resampler_interpolation, lowrider_resampler_phase_linear, g_option_resampler_farrow_taps, 0, 0.0, 0.0, 0.0});
+			} else {
+				for(float candidate_passband : DESIGN_PASSBANDS) {
+					if(candidate_passband < g_option_resampler_passband)
+						continue;
+					for(float stopband : DESIGN_STOPBANDS) {
+						for(float beta : DESIGN_BETAS) {
+							for(lowrider_resampler_interpolation interpolation : {lowrider_resampler_interpolation_linear, lowrider_resampler_interpolation_cubic}) {
+								for(lowrider_resampler_phase phase : {lowrider_resampler_phase_linear, lowrider_resampler_phase_minimum}) {
+									candidates.push_back({engine, multistage, candidate_passband, stopband, beta, interpolation, phase,
+														  g_option_resampler_farrow_taps, 0, 0.0, 0.0, 0.0});
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Evaluate the candidates. The cheap measurements come first, so candidates that don't fit in the budget are
+	// rejected before the SNR is measured.
+	std::vector<design_candidate> accepted;
+	uint32_t rejected = 0;
+	for(design_candidate &c : candidates) {
+		if(lowrider_resampler_chain::resolve_engine(g_option_rate_in, g_option_rate_out, c.engine, c.multistage, g_option_period_in, c.passband,
+													c.stopband, c.beta, c.phase) != c.engine)
+			continue;
+		lowrider_resampler_chain resampler(g_option_rate_in, g_option_rate_out, c.engine, c.multistage, g_option_period_in, c.passband, c.stopband,
+										   c.beta, g_option_resampler_gain, c.interpolation, c.phase, c.farrow_taps, cache_dir);
+		resampler.set_ratio(ratio);
+		resampler.set_storage(g_option_resampler_storage);
+		c.stages = resampler.get_stage_count();
+		c.latency = ((double) resampler.get_filter_delay() - 0.5) / (double) g_option_rate_in;
+		if(g_option_max_latency > 0.0f && c.latency * 1e3 > (double) g_option_max_latency) {
+			++rejected;
+			continue;
+		}
+		c.time = benchmark_throughput(c.engine, c.multistage, channels, g_option_period_in, c.passband, c.stopband, c.beta, c.interpolation, c.phase,
+									  c.farrow_taps, g_option_resampler_storage, cache_dir) / (double) channels;
+		if(g_option_max_cpu > 0.0f && c.time > (double) g_option_max_cpu) {
+			++rejected;
+			continue;
+		}
+		analyze_params params = {
+			c.engine, c.multistage, c.passband, c.stopband, c.beta, c.interpolation, c.phase, c.farrow_taps, g_option_resampler_storage, cache_dir, ratio,
+		};
+		c.snr = measure_resampler_snr(params, passband, DESIGN_FREQUENCIES);
+		accepted.push_back(c);
+	}
+	std::cout << "Candidates:      " << std::setw(14) << (accepted.size() + rejected) << std::endl;
+	std::cout << "Within budget:   " << std::setw(14) << accepted.size() << std::endl;
+	if(accepted.empty()) {
+		throw std::runtime_error("no resampler settings fit within the latency and CPU budget");
+	}
+
+	// keep only the Pareto-optimal candidates, sorted by SNR
+	std::vector<design_candidate> optimal;
+	for(const design_candidate &c : accepted) {
+		bool dominated = false;
+		for(const design_candidate &d : accepted) {
+			if(dominates(d, c)) {
+				dominated = true;
+				break;
+			}
+		}
+		if(!dominated) {
+			optimal.push_back(c);
+		}
+	}
+	std::stable_sort(optimal.begin(), optimal.end(), [](const design_candidate &a, const design_candidate &b) {
+		return a.snr > b.snr;
+	});
+
+	std::cout << std::endl;
+	std::cout << "Engine      Stages   Passband   Stopband   Beta   Interpolation   Phase      SNR (dB)   Latency (ms)   Time per Sample (ns)" << std::endl;
+	for(const design_candidate &c : optimal) {
+		print_candidate(c);
+	}
+
+	// the candidate with the highest SNR is always Pareto-optimal
+	std::cout << std::endl;
+	std::cout << "Recommended options:" << std::endl;
+	std::cout << get_option_string(optimal.front()) << std::endl;
+
+}
@@ -0,0 +1,22 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+void design_resampler();
@@ -0,0 +1,201 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "farrow.h"
+
+#include "miscmath.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+#include <complex>
+
+// Calculates the polynomial coefficients of the Lagrange weights for the input samples at positions 1 - taps / 2 to
+// taps / 2 relative to the output position offset 0. Weight j is sum_p coef[p * taps + j] * offset^p.
+static std::vector<double> calculate_lagrange_coefficients(uint32_t taps) {
+	std::vector<double> coef((size_t) taps * taps, 0.0);
+	std::vector<double> poly(taps);
+	for(uint32_t j = 0; j < taps; ++j) {
+
+		// multiply the factors (offset - d_k) / (d_j - d_k) for all k != j
+		double dj = (double) j - (double) (taps / 2 - 1);
+		std::fill(poly.begin(), poly.end(), 0.0);
+		poly[0] = 1.0;
+		uint32_t degree = 0;
+		for(uint32_t k = 0; k < taps; ++k) {
+			if(k == j)
+				continue;
+			double dk = (double) k - (double) (taps / 2 - 1);
+			double scale = 1.0 / (dj - dk);
+			++degree;
+			for(uint32_t p = degree; p > 0; --p) {
+				poly[p] = (poly[p - 1] - dk * poly[p]) * scale;
+			}
+			poly[0] = -dk * poly[0] * scale;
+		}
+
+		for(uint32_t p = 0; p < taps; ++p) {
+			coef[(size_t) p * taps + j] = poly[p];
+		}
+	}
+	return coef;
+}
+
+lowrider_farrow::lowrider_farrow(float ratio, uint32_t taps, float gain) {
+	assert(std::isfinite(ratio) && ratio > 0.0f);
+	assert(taps >= TAPS_MIN && taps <= TAPS_MAX && taps % 2 == 0);
+
+	m_ratio = rint64((float) RATIO_ONE * ratio);
+	m_offset = 0;
+	m_taps = taps;
+
+	std::vector<double> coef = calculate_lagrange_coefficients(taps);
+	m_coef.resize(coef.size());
+	for(size_t i = 0; i < coef.size(); ++i) {
+		m_coef[i] = (float) (coef[i] * (double) gain);
+	}
+	m_weights.resize(taps);
+
+}
+
+inline void lowrider_farrow::calculate_weights() {
+	float frac = (float) m_offset * (1.0f / (float) RATIO_ONE);
+	const float *top = m_coef.data() + (size_t) (m_taps - 1) * m_taps;
+	std::copy_n(top, m_taps, m_weights.data());
+	for(uint32_t p = m_taps - 1; p > 0; --p) {
+		const float *c = m_coef.data() + (size_t) (p - 1) * m_taps;
+		for(uint32_t j = 0; j < m_taps; ++j) {
+			m_weights[j] = m_weights[j] * frac + c[j];
+		}
+	}
+}
+
+inline uint32_t lowrider_farrow::advance() {
+	uint64_t new_offset = (uint64_t) m_offset + m_ratio;
+	m_offset = (uint32_t) new_offset;
+	return (uint32_t) (new_offset >> 32);
+}
+
+void lowrider_farrow::reset() {
+	m_offset = 0;
+}
+
+std::pair<uint32_t, uint32_t> lowrider_farrow::resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+														float * const *data_out, uint32_t size_out) {
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + m_taps <= size_in && pos_out < size_out) {
+		calculate_weights();
+		for(uint32_t c = 0; c < channels; ++c) {
+			const float *in = data_in[c] + pos_in;
+			float sum = 0.0f;
+			for(uint32_t j = 0; j < m_taps; ++j) {
+				sum += m_weights[j] * in[j];
+			}
+			data_out[c][pos_out] = sum;
+		}
+		pos_in += advance();
+		++pos_out;
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_farrow::resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+																	float *data_out, uint32_t size_out) {
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + m_taps <= size_in && pos_out < size_out) {
+		calculate_weights();
+		const float *in = data_in + (size_t) pos_in * stride;
+		float *out = data_out + (size_t) pos_out * stride;
+		std::fill_n(out, stride, 0.0f);
+		for(uint32_t j = 0; j < m_taps; ++j) {
+			float w = m_weights[j];
+			const float *row = in + (size_t) j * stride;
+			for(uint32_t c = 0; c < stride; ++c) {
+				out[c] += w * row[c];
+			}
+		}
+		pos_in += advance();
+		++pos_out;
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+uint32_t lowrider_farrow::calculate_size_in(uint32_t size_out) {
+	return (uint32_t) (((uint64_t) m_offset + m_ratio * size_out) / RATIO_ONE) + (m_taps - 1);
+}
+
+uint32_t lowrider_farrow::calculate_size_out(uint32_t size_in) {
+	return (size_in < m_taps)? 0 : ((uint64_t) (size_in - (m_taps - 1)) * RATIO_ONE - (uint64_t) m_offset - 1) / m_ratio + 1;
+}
+
+float lowrider_farrow::get_latency_in() {
+	return (float) (m_taps / 2 - 1) + (float) m_offset / (float) RATIO_ONE;
+}
+
+float lowrider_farrow::get_latency_out() {
+	return get_latency_in() * (float) RATIO_ONE / (float) m_ratio;
+}
+
+double lowrider_farrow::get_ratio() {
+	return (double) m_ratio / (double) RATIO_ONE;
+}
+
+void lowrider_farrow::set_ratio(double ratio) {
+	m_ratio = rint64((double) RATIO_ONE * ratio);
+}
+
+uint32_t lowrider_farrow::get_filter_length() {
+	return m_taps;
+}
+
+float lowrider_farrow::get_filter_delay() {
+	// the interpolation point is between taps / 2 - 1 and taps / 2
+	return (float) (m_taps / 2);
+}
+
+uint32_t lowrider_farrow::get_taps() {
+	return m_taps;
+}
+
+double lowrider_farrow::get_passband_error(uint32_t taps, double freq) {
+	assert(taps >= TAPS_MIN && taps <= TAPS_MAX && taps % 2 == 0);
+	std::vector<double> coef = calculate_lagrange_coefficients(taps);
+	std::vector<double> weights(taps);
+	double worst = 0.0;
+	for(uint32_t i = 0; i <= 64; ++i) {
+		double frac = (double) i / 64.0;
+		for(uint32_t j = 0; j < taps; ++j) {
+			double w = 0.0;
+			for(uint32_t p = taps; p > 0; --p) {
+				w = w * frac + coef[(size_t) (p - 1) * taps + j];
+			}
+			weights[j] = w;
+		}
+
+		// compare the response with an ideal delay
+		std::complex<double> response(0.0, 0.0);
+		for(uint32_t j = 0; j < taps; ++j) {
+			double delay = (double) j - (double) (taps / 2 - 1) - frac;
+			response += weights[j] * std::polar(1.0, -2.0 * M_PI * freq * delay);
+		}
+		worst = std::max(worst, std::abs(response - 1.0));
+	}
+	return 20.0 * std::log10(std::max(worst, 1.0e-20));
+}
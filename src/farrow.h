@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+/*
+This is a variable-rate resampler based on a Farrow structure: a short fractional-delay filter whose taps are polynomials
+of the fractional offset, so no filter bank is needed. The taps are the Lagrange interpolation weights for the 'taps'
+input samples around the output position, expanded into polynomial coefficients when the resampler is created. For every
+output sample the taps are evaluated with Horner's method and then applied to all channels.
+
+A Lagrange interpolator is exact at DC and very accurate at low frequencies, but it doesn't have a real stopband, so it
+is only suitable for ratios very close to 1 (i.e. when only clock drift has to be corrected). There is no anti-aliasing
+filter, and the error grows quickly towards the Nyquist frequency. The advantage is the latency, which is only
+taps / 2 - 1 + offset input samples (1 to 4 samples for 4 to 8 taps), compared to half the filter length for
+lowrider_resampler. Use get_passband_error() or --analyze-resampler to check whether the accuracy is sufficient.
+
+The user must keep 'taps' samples of input data for the next invocation. The next output sample is interpolated at
+position taps / 2 - 1 + offset (relative to the first input sample that is still needed), which is what get_latency_in()
+returns. get_filter_delay() returns taps / 2, so the latency is get_filter_delay() - 1 + offset.
+*/
+
+class lowrider_farrow {
+
+private:
+	uint64_t m_ratio;
+	uint32_t m_offset;
+	uint32_t m_taps;
+
+	// Polynomial coefficients of the taps: tap j is sum_p m_coef[p * m_taps + j] * offset^p.
+	std::vector<float> m_coef;
+
+	// taps for the current output sample
+	std::vector<float> m_weights;
+
+private:
+	// Calculates the taps for the current offset.
+	void calculate_weights();
+
+	// Advances to the next output sample and returns the number of input samples that should be skipped.
+	uint32_t advance();
+
+public:
+	static constexpr uint32_t TAPS_MIN = 2;
+	static constexpr uint32_t TAPS_MAX = 16;
+	static constexpr uint64_t RATIO_ONE = (uint64_t) 1 << 32;
+
+public:
+	// Creates the resampler. The number of taps must be even and between TAPS_MIN and TAPS_MAX.
+	lowrider_farrow(float ratio, uint32_t taps, float gain);
+
+	// See lowrider_resampler.
+	void reset();
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+										   float * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+													   float *data_out, uint32_t size_out);
+	uint32_t calculate_size_in(uint32_t size_out);
+	uint32_t calculate_size_out(uint32_t size_in);
+	float get_latency_in();
+	float get_latency_out();
+	double get_ratio();
+	void set_ratio(double ratio);
+	uint32_t get_filter_length();
+	float get_filter_delay();
+
+	// Returns the number of taps.
+	uint32_t get_taps();
+
+	// Returns the worst-case error of the interpolator (over all offsets) for a sine wave at the given frequency, relative
+	// to the sample rate, in dB relative to the amplitude of the sine wave.
+	static double get_passband_error(uint32_t taps, double freq);
+
+};
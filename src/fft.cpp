@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fft.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <utility>
+
+lowrider_fft::lowrider_fft(size_t size) {
+	assert(size != 0 && (size & (size - 1)) == 0);
+	m_size = size;
+
+	// calculate the twiddle factors for the largest stage, the smaller stages use a subset of them
+	m_twiddles.resize(size / 2);
+	for(size_t k = 0; k < size / 2; ++k) {
+		double phase = -2.0 * M_PI * (double) k / (double) size;
+		m_twiddles[k] = std::complex<double>(std::cos(phase), std::sin(phase));
+	}
+
+	// calculate the bit-reversed permutation
+	m_bit_reverse.resize(size);
+	size_t bits = 0;
+	while(((size_t) 1 << bits) < size) {
+		++bits;
+	}
+	for(size_t i = 0; i < size; ++i) {
+		size_t r = 0;
+		for(size_t b = 0; b < bits; ++b) {
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		m_bit_reverse[i] = r;
+	}
+
+}
+
+void lowrider_fft::transform(std::complex<double> *data, bool inverse) {
+	for(size_t i = 0; i < m_size; ++i) {
+		size_t r = m_bit_reverse[i];
+		if(i < r) {
+			std::swap(data[i], data[r]);
+		}
+	}
+	for(size_t half = 1; half < m_size; half *= 2) {
+		size_t step = m_size / (half * 2);
+		for(size_t block = 0; block < m_size; block += half * 2) {
+			for(size_t k = 0; k < half; ++k) {
+				// The complex multiplication is written out because std::complex checks for NaN and infinity, which is
+				// very slow. This doesn't change the result for finite values.
+				std::complex<double> w = m_twiddles[k * step];
+				double wr = w.real(), wi = (inverse)? -w.imag() : w.imag();
+				std::complex<double> a = data[block + k], x = data[block + k + half];
+				std::complex<double> b(x.real() * wr - x.imag() * wi, x.real() * wi + x.imag() * wr);
+				data[block + k] = a + b;
+				data[block + k + half] = a - b;
+			}
+		}
+	}
+}
+
+void lowrider_fft::forward(std::complex<double> *data) {
+	transform(data, false);
+}
+
+void lowrider_fft::inverse(std::complex<double> *data) {
+	transform(data, true);
+}
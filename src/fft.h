@@ -0,0 +1,58 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include <complex>
+#include <vector>
+
+/*
+A simple radix-2 complex FFT in double precision. It is mostly used to design filters, so it is optimized for accuracy
+rather than speed: the twiddle factors are calculated directly rather than with a recurrence. It is also used by
+lowrider_fft_filter, where double precision keeps the rounding errors far below those of the float kernels. The transform
+is not normalized, so an inverse transform after a forward transform multiplies the data by the size.
+*/
+
+class lowrider_fft {
+
+private:
+	size_t m_size;
+	std::vector<std::complex<double>> m_twiddles;
+	std::vector<size_t> m_bit_reverse;
+
+private:
+	void transform(std::complex<double> *data, bool inverse);
+
+public:
+	// Prepares an FFT of the given size, which must be a power of two.
+	lowrider_fft(size_t size);
+
+	// Calculates the forward transform in-place, i.e. X[k] = sum(x[n] * exp(-2 * pi * i * k * n / size)).
+	void forward(std::complex<double> *data);
+
+	// Calculates the inverse transform in-place, i.e. x[n] = sum(X[k] * exp(2 * pi * i * k * n / size)).
+	void inverse(std::complex<double> *data);
+
+	inline size_t size() {
+		return m_size;
+	}
+
+};
@@ -0,0 +1,193 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fft_filter.h"
+
+#include "bessel.h"
+#include "miscmath.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+
+static uint32_t calculate_half_length(float ratio, float passband, float stopband, float beta) {
+	// this is the same as the filter length of lowrider_resampler, but rounded to an odd length rather than a multiple of 4
+	float sinc_lobes = std::max(2.0f, beta / ((float) M_PI * 0.5f * (stopband - passband)));
+	float sinc_freq = (passband + stopband) / std::max(1.0f, ratio);
+	return (uint32_t) std::ceil(clamp(sinc_lobes / sinc_freq * 0.5f, 1.0f, (float) lowrider_fft_filter::HALF_LENGTH_MAX));
+}
+
+static uint32_t calculate_fft_size(uint32_t filter_length) {
+	uint32_t size = lowrider_fft_filter::FFT_SIZE_MIN;
+	while(size < filter_length * lowrider_fft_filter::FFT_SIZE_FACTOR) {
+		size *= 2;
+	}
+	return size;
+}
+
+lowrider_fft_filter::lowrider_fft_filter(float ratio, float passband, float stopband, float beta, float gain)
+	: m_fft(calculate_fft_size(calculate_filter_length(ratio, passband, stopband, beta))) {
+	assert(std::isfinite(ratio) && ratio > 0.0f);
+	assert(std::isfinite(passband) && std::isfinite(stopband) && passband > 0.0f && stopband > passband);
+	assert(std::isfinite(beta) && beta > 0.0f);
+
+	m_half_length = calculate_half_length(ratio, passband, stopband, beta);
+	m_filter_length = 2 * m_half_length + 1;
+	m_fft_size = (uint32_t) m_fft.size();
+	m_block_size = m_fft_size - m_filter_length + 1;
+
+	// calculate the taps and normalize them so the DC gain is exactly equal to the gain
+	float sinc_freq = (passband + stopband) / std::max(1.0f, ratio);
+	std::vector<double> coef(m_filter_length);
+	double window_scale = 1.0 / (double) (m_half_length + 1), sum = 0.0;
+	for(uint32_t i = 0; i < m_filter_length; ++i) {
+		double x = (double) i - (double) m_half_length;
+		coef[i] = kaiser(x * window_scale, (double) beta) * sinc(x * (double) sinc_freq);
+		sum += coef[i];
+	}
+
+	// calculate the frequency response, including the normalization of the transforms
+	m_response.assign(m_fft_size, std::complex<double>(0.0, 0.0));
+	for(uint32_t i = 0; i < m_filter_length; ++i) {
+		m_response[i] = coef[i] * (double) gain / sum;
+	}
+	m_fft.forward(m_response.data());
+	for(std::complex<double> &v : m_response) {
+		v = std::conj(v) / (double) m_fft_size;
+	}
+
+	m_block.resize(m_fft_size);
+
+}
+
+void lowrider_fft_filter::filter_block(const float *in1, const float *in2, size_t step_in, float *out1, float *out2, size_t step_out, uint32_t count) {
+	assert(count != 0 && count <= m_block_size);
+
+	// load the input, the samples after the last window are not needed
+	uint32_t size_in = count + m_filter_length - 1;
+	if(in2 != nullptr) {
+		for(uint32_t i = 0; i < size_in; ++i) {
+			m_block[i] = std::complex<double>(in1[i * step_in], in2[i * step_in]);
+		}
+	} else {
+		for(uint32_t i = 0; i < size_in; ++i) {
+			m_block[i] = std::complex<double>(in1[i * step_in], 0.0);
+		}
+	}
+	std::fill(m_block.begin() + size_in, m_block.end(), std::complex<double>(0.0, 0.0));
+
+	// apply the filter
+	m_fft.forward(m_block.data());
+	for(uint32_t k = 0; k < m_fft_size; ++k) {
+		std::complex<double> a = m_block[k], b = m_response[k];
+		m_block[k] = std::complex<double>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+	}
+	m_fft.inverse(m_block.data());
+
+	// store the output, the first outputs are the only ones that don't wrap around
+	for(uint32_t i = 0; i < count; ++i) {
+		out1[i * step_out] = (float) m_block[i].real();
+	}
+	if(out2 != nullptr) {
+		for(uint32_t i = 0; i < count; ++i) {
+			out2[i * step_out] = (float) m_block[i].imag();
+		}
+	}
+
+}
+
+void lowrider_fft_filter::reset() {
+	// nothing to do, the filter has no state
+}
+
+std::pair<uint32_t, uint32_t> lowrider_fft_filter::resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+															float * const *data_out, uint32_t size_out) {
+	uint32_t count = std::min(size_out, calculate_size_out(size_in));
+	for(uint32_t c = 0; c < channels; c += 2) {
+		bool pair = (c + 1 < channels);
+		for(uint32_t pos = 0; pos < count; pos += m_block_size) {
+			uint32_t n = std::min(m_block_size, count - pos);
+			filter_block(data_in[c] + pos, (pair)? data_in[c + 1] + pos : nullptr, 1,
+						 data_out[c] + pos, (pair)? data_out[c + 1] + pos : nullptr, 1, n);
+		}
+	}
+	return std::make_pair(count, count);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_fft_filter::resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+																		float *data_out, uint32_t size_out) {
+	uint32_t count = std::min(size_out, calculate_size_out(size_in));
+	for(uint32_t c = 0; c < stride; c += 2) {
+		bool pair = (c + 1 < stride);
+		for(uint32_t pos = 0; pos < count; pos += m_block_size) {
+			uint32_t n = std::min(m_block_size, count - pos);
+			const float *in = data_in + (size_t) pos * stride + c;
+			float *out = data_out + (size_t) pos * stride + c;
+			filter_block(in, (pair)? in + 1 : nullptr, stride, out, (pair)? out + 1 : nullptr, stride, n);
+		}
+	}
+	return std::make_pair(count, count);
+}
+
+uint32_t lowrider_fft_filter::calculate_size_in(uint32_t size_out) {
+	return size_out + m_filter_length - 1;
+}
+
+uint32_t lowrider_fft_filter::calculate_size_out(uint32_t size_in) {
+	return (size_in < m_filter_length)? 0 : size_in - m_filter_length + 1;
+}
+
+float lowrider_fft_filter::get_latency_in() {
+	return (float) m_half_length;
+}
+
+float lowrider_fft_filter::get_latency_out() {
+	return (float) m_half_length;
+}
+
+double lowrider_fft_filter::get_ratio() {
+	return 1.0;
+}
+
+uint32_t lowrider_fft_filter::get_filter_length() {
+	return m_filter_length;
+}
+
+float lowrider_fft_filter::get_filter_delay() {
+	// the constant latency plus 0.5, like lowrider_halfband
+	return (float) m_half_length + 0.5f;
+}
+
+uint32_t lowrider_fft_filter::get_fft_size() {
+	return m_fft_size;
+}
+
+uint32_t lowrider_fft_filter::get_block_size() {
+	return m_block_size;
+}
+
+uint32_t lowrider_fft_filter::calculate_filter_length(float ratio, float passband, float stopband, float beta) {
+	return 2 * calculate_half_length(ratio, passband, stopband, beta) + 1;
+}
+
+uint32_t lowrider_fft_filter::calculate_block_size(float ratio, float passband, float stopband, float beta) {
+	uint32_t filter_length = calculate_filter_length(ratio, passband, stopband, beta);
+	return calculate_fft_size(filter_length) - filter_length + 1;
+}
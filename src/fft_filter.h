@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "fft.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <complex>
+#include <utility>
+#include <vector>
+
+/*
+This is a fixed lowpass filter (ratio 1) that is applied in the frequency domain with the overlap-save method. It is used
+by the FFT engine of lowrider_resampler_chain to do the bulk of the filtering for very long filters, in front of a much
+shorter variable-rate resampler.
+
+The filter is the same Kaiser-windowed sinc filter that lowrider_resampler would use for the given ratio and filter
+parameters, sampled at the input rate, so it has the same passband, stopband and attenuation. It always has a linear
+phase. The taps are applied as a correlation:
+	y[m] = sum_j coef[j] * x[m + j]
+Each block of FFT_SIZE input samples produces FFT_SIZE - filter_length + 1 output samples, the other outputs are
+corrupted by the circular convolution and are discarded. Two channels are processed with a single complex transform
+(one in the real part, one in the imaginary part), which is exact because the filter is real.
+
+The cost per output sample is roughly proportional to log2(fft_size) rather than to the filter length, so this is only
+faster than the direct form for long filters, and only if the data is processed in large blocks: every invocation
+processes at least one full block, even if only a few output samples are requested. The FFT size is chosen such that
+roughly 3/4 of every block is useful output.
+
+The user must keep one filter length of input data for the next invocation. The filter has an odd length and a linear
+phase, so the latency is constant: get_latency_in() and get_latency_out() return (filter_length - 1) / 2 samples, and
+get_filter_delay() returns that plus 0.5.
+*/
+
+class lowrider_fft_filter {
+
+private:
+	uint32_t m_half_length, m_filter_length;
+	uint32_t m_fft_size, m_block_size;
+	lowrider_fft m_fft;
+
+	// conjugate of the frequency response of the filter, divided by the FFT size
+	std::vector<std::complex<double>> m_response;
+
+	// data of the current block
+	std::vector<std::complex<double>> m_block;
+
+private:
+	// Filters up to m_block_size output samples of one or two channels. The input and output samples of a channel are
+	// 'step' elements apart. The second channel is optional.
+	void filter_block(const float *in1, const float *in2, size_t step_in, float *out1, float *out2, size_t step_out, uint32_t count);
+
+public:
+	// The FFT size is at least this many times the filter length.
+	static constexpr uint32_t FFT_SIZE_FACTOR = 4;
+
+	static constexpr uint32_t FFT_SIZE_MIN = 256;
+	static constexpr uint32_t HALF_LENGTH_MAX = 32768;
+
+public:
+	// Creates the filter. The parameters are the same as for lowrider_resampler, the ratio is only used to calculate the
+	// cutoff frequency.
+	lowrider_fft_filter(float ratio, float passband, float stopband, float beta, float gain);
+
+	// See lowrider_resampler.
+	void reset();
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+										   float * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+													   float *data_out, uint32_t size_out);
+	uint32_t calculate_size_in(uint32_t size_out);
+	uint32_t calculate_size_out(uint32_t size_in);
+	float get_latency_in();
+	float get_latency_out();
+	double get_ratio();
+	uint32_t get_filter_length();
+	float get_filter_delay();
+
+	// Returns the FFT size and the number of output samples per block.
+	uint32_t get_fft_size();
+	uint32_t get_block_size();
+
+	// Returns the filter length or the number of output samples per block for the given parameters without creating the
+	// filter.
+	static uint32_t calculate_filter_length(float ratio, float passband, float stopband, float beta);
+	static uint32_t calculate_block_size(float ratio, float passband, float stopband, float beta);
+
+};
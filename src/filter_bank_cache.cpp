@@ -0,0 +1,231 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filter_bank_cache.h"
+
+#include "string_helper.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <iomanip>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Increase this when the file format or the filter bank generation algorithm changes.
+static constexpr uint32_t FILTER_BANK_FILE_VERSION = 2;
+
+static const char FILTER_BANK_FILE_MAGIC[8] = {'L', 'R', 'F', 'B', 'A', 'N', 'K', '\0'};
+
+struct lowrider_filter_bank_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	lowrider_filter_bank_key key;
+	uint64_t data_size;
+	uint64_t checksum;
+};
+
+// The header size is a multiple of 64 bytes, so the data is aligned to a cache line.
+static_assert(sizeof(lowrider_filter_bank_header) == 64, "unexpected header size");
+
+// 64-bit FNV-1a hash, used for the file name.
+static uint64_t hash_bytes(const void *data, size_t size) {
+	const uint8_t *bytes = (const uint8_t*) data;
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// Same as FNV-1a, but processes 32-bit words instead of bytes, which is about 4 times faster.
+static uint64_t checksum_words(const float *data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(size_t i = 0; i < size; ++i) {
+		uint32_t word;
+		memcpy(&word, data + i, sizeof(uint32_t));
+		hash = (hash ^ word) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static std::string get_filter_bank_file(const std::string &cache_dir, const lowrider_filter_bank_key &key) {
+	uint32_t version = FILTER_BANK_FILE_VERSION;
+	uint64_t hash = hash_bytes(&version, sizeof(version)) ^ hash_bytes(&key, sizeof(key));
+	std::ostringstream ss;
+	ss << cache_dir << "/filter-bank-" << std::hex << std::setfill('0') << std::setw(16) << hash << ".bin";
+	return ss.str();
+}
+
+static bool write_all(int fd, const void *data, size_t size) {
+	const char *ptr = (const char*) data;
+	while(size != 0) {
+		ssize_t res = write(fd, ptr, size);
+		if(res == -1) {
+			if(errno == EINTR)
+				continue;
+			return false;
+		}
+		ptr += res;
+		size -= (size_t) res;
+	}
+	return true;
+}
+
+static bool make_directories(const std::string &path) {
+	for(size_t p = path.find('/', 1); ; p = path.find('/', p + 1)) {
+		std::string dir = path.substr(0, p);
+		if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+			return false;
+		}
+		if(p == std::string::npos)
+			return true;
+	}
+}
+
+lowrider_filter_bank_file::lowrider_filter_bank_file() {
+	m_map = MAP_FAILED;
+	m_map_size = 0;
+	m_data = nullptr;
+}
+
+lowrider_filter_bank_file::~lowrider_filter_bank_file() {
+	if(m_map != MAP_FAILED) {
+		munmap(m_map, m_map_size);
+	}
+}
+
+bool lowrider_filter_bank_file::load(const std::string &cache_dir, const lowrider_filter_bank_key &key, size_t size) {
+	if(cache_dir.empty())
+		return false;
+	std::string file = get_filter_bank_file(cache_dir, key);
+
+	// open the file
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd == -1)
+		return false;
+	struct stat st;
+	size_t map_size = sizeof(lowrider_filter_bank_header) + size * sizeof(float);
+	bool valid = (fstat(fd, &st) == 0 && (size_t) st.st_size == map_size);
+	void *map = (valid)? mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if(map == MAP_FAILED) {
+		std::cerr << "Warning: ignoring invalid filter bank cache file '" << file << "'" << std::endl;
+		return false;
+	}
+
+	// verify the header and the data
+	const lowrider_filter_bank_header *header = (const lowrider_filter_bank_header*) map;
+	const float *data = (const float*) ((const char*) map + sizeof(lowrider_filter_bank_header));
+	if(memcmp(header->magic, FILTER_BANK_FILE_MAGIC, sizeof(FILTER_BANK_FILE_MAGIC)) != 0 ||
+			header->version != FILTER_BANK_FILE_VERSION || header->header_size != sizeof(lowrider_filter_bank_header) ||
+			memcmp(&header->key, &key, sizeof(lowrider_filter_bank_key)) != 0 || header->data_size != size * sizeof(float) ||
+			header->checksum != checksum_words(data, size)) {
+		munmap(map, map_size);
+		std::cerr << "Warning: ignoring corrupt filter bank cache file '" << file << "'" << std::endl;
+		return false;
+	}
+
+	if(m_map != MAP_FAILED) {
+		munmap(m_map, m_map_size);
+	}
+	m_map = map;
+	m_map_size = map_size;
+	m_data = data;
+	return true;
+}
+
+const char* get_filter_bank_source_name(lowrider_filter_bank_source source) {
+	switch(source) {
+		case lowrider_filter_bank_source_generated: return "generated";
+		case lowrider_filter_bank_source_cache: return "cache";
+		case lowrider_filter_bank_source_embedded: return "embedded";
+	}
+	return "unknown";
+}
+
+const float* find_embedded_filter_bank(const lowrider_filter_bank_key &key, size_t size) {
+#if LOWRIDER_EMBEDDED_FILTER_BANKS
+	for(size_t i = 0; i < g_embedded_filter_bank_count; ++i) {
+		const lowrider_embedded_filter_bank &bank = g_embedded_filter_banks[i];
+		if(memcmp(&bank.key, &key, sizeof(lowrider_filter_bank_key)) == 0 && bank.size == size) {
+			return bank.data;
+		}
+	}
+#else
+	(void) key;
+	(void) size;
+#endif
+	return nullptr;
+}
+
+std::string get_filter_bank_cache_dir() {
+	const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+	if(xdg_cache_home != nullptr && xdg_cache_home[0] == '/') {
+		return make_string(xdg_cache_home, "/lowrider");
+	}
+	const char *home = getenv("HOME");
+	if(home != nullptr && home[0] == '/') {
+		return make_string(home, "/.cache/lowrider");
+	}
+	return std::string();
+}
+
+bool store_filter_bank(const std::string &cache_dir, const lowrider_filter_bank_key &key, const float *data, size_t size) {
+	if(cache_dir.empty())
+		return false;
+	std::string file = get_filter_bank_file(cache_dir, key);
+
+	// create the header
+	lowrider_filter_bank_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FILTER_BANK_FILE_MAGIC, sizeof(FILTER_BANK_FILE_MAGIC));
+	header.version = FILTER_BANK_FILE_VERSION;
+	header.header_size = sizeof(lowrider_filter_bank_header);
+	header.key = key;
+	header.data_size = size * sizeof(float);
+	header.checksum = checksum_words(data, size);
+
+	// write to a temporary file, then rename it
+	if(!make_directories(cache_dir)) {
+		std::cerr << "Warning: failed to create filter bank cache directory '" << cache_dir << "': " << strerror(errno) << std::endl;
+		return false;
+	}
+	std::string temp_file = file + ".XXXXXX";
+	int fd = mkostemp(&temp_file[0], O_CLOEXEC);
+	if(fd == -1) {
+		std::cerr << "Warning: failed to create filter bank cache file '" << temp_file << "': " << strerror(errno) << std::endl;
+		return false;
+	}
+	bool success = (fchmod(fd, 0644) == 0 && write_all(fd, &header, sizeof(header)) && write_all(fd, data, size * sizeof(float)));
+	success = (close(fd) == 0) && success;
+	success = success && (rename(temp_file.c_str(), file.c_str()) == 0);
+	if(!success) {
+		std::cerr << "Warning: failed to write filter bank cache file '" << file << "': " << strerror(errno) << std::endl;
+		unlink(temp_file.c_str());
+		return false;
+	}
+	return true;
+}
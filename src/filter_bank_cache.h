@@ -0,0 +1,99 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+// Parameters that uniquely determine the contents of a filter bank. This is used as the key for the filter bank cache
+// and for the embedded filter banks.
+struct lowrider_filter_bank_key {
+	uint32_t filter_length, filter_rows, bank_rows, row_extra, phase;
+	float sinc_freq, beta, gain;
+};
+
+enum lowrider_filter_bank_source {
+	lowrider_filter_bank_source_generated,
+	lowrider_filter_bank_source_cache,
+	lowrider_filter_bank_source_embedded,
+};
+
+// Filter banks for the built-in presets are generated at build time and embedded in the binary (see
+// generate_filter_banks.cpp). They are only available when LOWRIDER_EMBEDDED_FILTER_BANKS is enabled.
+struct lowrider_embedded_filter_bank {
+	lowrider_filter_bank_key key;
+	const float *data;
+	size_t size;
+};
+
+#if LOWRIDER_EMBEDDED_FILTER_BANKS
+extern const lowrider_embedded_filter_bank g_embedded_filter_banks[];
+extern const size_t g_embedded_filter_bank_count;
+#endif
+
+// Returns a human-readable name for the filter bank source.
+const char* get_filter_bank_source_name(lowrider_filter_bank_source source);
+
+// Returns the embedded filter bank of 'size' floats that matches the key, or nullptr if there is none.
+const float* find_embedded_filter_bank(const lowrider_filter_bank_key &key, size_t size);
+
+/*
+Filter banks are cached on disk, so they don't have to be regenerated every time lowrider starts. Each filter bank is stored
+in a separate file, the name of the file is a hash of the key. The file starts with a header containing the key and a
+checksum of the data, which are both verified before the filter bank is used. Invalid files are ignored and overwritten.
+
+Cached filter banks are mapped into memory read-only, so all lowrider processes using the same filter bank share the same
+physical memory.
+*/
+
+class lowrider_filter_bank_file {
+
+private:
+	void *m_map;
+	size_t m_map_size;
+	const float *m_data;
+
+public:
+	lowrider_filter_bank_file();
+	~lowrider_filter_bank_file();
+
+	lowrider_filter_bank_file(const lowrider_filter_bank_file&) = delete;
+	lowrider_filter_bank_file& operator=(const lowrider_filter_bank_file&) = delete;
+
+	// Tries to load a filter bank of 'size' floats from the cache directory. Returns false if the cache directory is
+	// empty (i.e. caching is disabled), or if the file does not exist or is invalid.
+	bool load(const std::string &cache_dir, const lowrider_filter_bank_key &key, size_t size);
+
+	// Returns a pointer to the filter bank, or nullptr if no filter bank was loaded.
+	const float* data() {
+		return m_data;
+	}
+
+};
+
+// Returns the default cache directory, i.e. $XDG_CACHE_HOME/lowrider or $HOME/.cache/lowrider.
+// Returns an empty string if neither variable is set.
+std::string get_filter_bank_cache_dir();
+
+// Stores a filter bank of 'size' floats in the cache directory (which is created if needed). The file is replaced
+// atomically, so other processes never see partially written files. Returns false if the file could not be written.
+bool store_filter_bank(const std::string &cache_dir, const lowrider_filter_bank_key &key, const float *data, size_t size);
@@ -0,0 +1,158 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+This program generates the filter banks for the built-in resampler presets at build time, so they can be embedded in the
+lowrider binary. It writes a C++ source file to the path given on the command line. The presets below should match the
+defaults in options.cpp and the presets documented in resampler.h.
+*/
+
+#include "filter_bank_cache.h"
+#include "resampler.h"
+#include "resampler_chain.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+struct preset {
+	float passband, stopband, beta;
+};
+
+static const preset PRESETS[] = {
+	{0.45f, 0.50f, 10.0f}, // high quality
+	{0.42f, 0.50f, 8.0f},  // medium quality (default)
+	{0.40f, 0.54f, 7.0f},  // low quality
+};
+
+struct rate_pair {
+	uint32_t rate_in, rate_out;
+};
+
+// All ratios below 1 share the same filter bank, they are only listed for completeness.
+static const rate_pair RATES[] = {
+	{48000, 48000},
+	{44100, 48000},
+	{48000, 44100},
+	{48000, 96000},
+	{96000, 48000},
+};
+
+static const lowrider_resampler_interpolation INTERPOLATIONS[] = {
+	lowrider_resampler_interpolation_linear,
+	lowrider_resampler_interpolation_cubic,
+};
+
+// Only the polyphase engine is embedded. The rational engine is experimental and slower, so its banks are not worth the
+// extra binary size (they are still cached on disk).
+static const lowrider_resampler_engine ENGINES[] = {
+	lowrider_resampler_engine_polyphase,
+};
+
+// Banks are embedded with and without half-band stages, since these lead to different ratios for the resampler stages.
+static const bool MULTISTAGES[] = {
+	true,
+	false,
+};
+
+int main(int argc, char *argv[]) {
+
+	if(argc != 2) {
+		std::cerr << "Usage: " << argv[0] << " OUTPUT" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream file(argv[1]);
+	file << "// Generated by generate_filter_banks.cpp, do not edit." << std::endl;
+	file << std::endl;
+	file << "#include \"filter_bank_cache.h\"" << std::endl;
+	file << std::showpoint << std::setprecision(9); // enough to represent every float exactly
+
+	std::vector<lowrider_filter_bank_key> keys;
+	std::vector<size_t> sizes;
+	for(const preset &p : PRESETS) {
+		for(const rate_pair &r : RATES) {
+			for(lowrider_resampler_interpolation interpolation : INTERPOLATIONS) {
+				for(lowrider_resampler_engine engine : ENGINES) {
+					for(bool multistage : MULTISTAGES) {
+
+						// this must match the way the resampler is constructed in loopback.cpp (the block size only matters for
+						// the auto engine)
+						lowrider_resampler_chain chain(r.rate_in, r.rate_out, engine, multistage, 0, p.passband, p.stopband, p.beta, 1.0f,
+													   interpolation, lowrider_resampler_phase_linear, 4, std::string());
+						for(uint32_t stage = 0; stage < chain.get_stage_count(); ++stage) {
+							lowrider_resampler *resampler = chain.get_stage_resampler(stage);
+							if(resampler == nullptr)
+								continue;
+
+							// skip duplicates
+							lowrider_filter_bank_key key = resampler->get_filter_bank_key();
+							bool duplicate = false;
+							for(const lowrider_filter_bank_key &other : keys) {
+								duplicate = duplicate || memcmp(&key, &other, sizeof(lowrider_filter_bank_key)) == 0;
+							}
+							if(duplicate)
+								continue;
+
+							// write the data
+							size_t size = resampler->get_filter_bank_size() / sizeof(float);
+							const float *data = resampler->get_filter_bank();
+							file << std::endl;
+							file << "alignas(64) static const float g_filter_bank_" << keys.size() << "[" << size << "] = {";
+							for(size_t i = 0; i < size; ++i) {
+								file << ((i % 8 == 0)? "\n\t" : " ") << data[i] << "f,";
+							}
+							file << std::endl << "};" << std::endl;
+							keys.push_back(key);
+							sizes.push_back(size);
+
+						}
+
+					}
+				}
+			}
+		}
+	}
+
+	// write the table
+	file << std::endl;
+	file << "extern const lowrider_embedded_filter_bank g_embedded_filter_banks[] = {" << std::endl;
+	for(size_t i = 0; i < keys.size(); ++i) {
+		const lowrider_filter_bank_key &key = keys[i];
+		file << "\t{{" << key.filter_length << ", " << key.filter_rows << ", " << key.bank_rows << ", " << key.row_extra << ", " << key.phase << ", "
+			 << key.sinc_freq << "f, " << key.beta << "f, " << key.gain << "f}, g_filter_bank_" << i << ", " << sizes[i] << "}," << std::endl;
+	}
+	file << "};" << std::endl;
+	file << std::endl;
+	file << "extern const size_t g_embedded_filter_bank_count = " << keys.size() << ";" << std::endl;
+
+	file.close();
+	if(file.fail()) {
+		std::cerr << "Error: failed to write '" << argv[1] << "'" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+}
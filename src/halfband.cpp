@@ -0,0 +1,240 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "halfband.h"
+
+#include "bessel.h"
+#include "miscmath.h"
+#include "resampler.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+
+lowrider_halfband::lowrider_halfband(lowrider_halfband_mode mode, float passband, float beta) {
+	assert(std::isfinite(passband) && passband > 0.0f && passband <= PASSBAND_MAX);
+	assert(std::isfinite(beta) && beta > 0.0f);
+
+	m_mode = mode;
+	m_phase = 0;
+	m_kernels = &get_resampler_kernels();
+
+	// The filter length is calculated in the same way as for lowrider_resampler, with stopband = 0.5 - passband. The
+	// nonzero taps are located at odd distances from the center, up to 2 * m_taps - 1. The number of taps is rounded up
+	// to a multiple of 2 because the kernels need a multiple of 4 coefficients.
+	float stopband = 0.5f - passband;
+	float sinc_lobes = std::max(2.0f, beta / ((float) M_PI * 0.5f * (stopband - passband)));
+	m_taps = (uint32_t) std::ceil(sinc_lobes * 0.125f) * 2;
+	m_filter_length = (mode == lowrider_halfband_mode_decimate)? 4 * m_taps - 1 : 2 * m_taps;
+
+	// calculate the taps and normalize them so the DC gain is exactly 1 (the center tap is 0.5)
+	std::vector<double> coef(m_taps);
+	double sum = 0.0;
+	for(uint32_t j = 0; j < m_taps; ++j) {
+		double x = (double) (2 * j + 1);
+		coef[j] = 0.5 * sinc(0.5 * x) * kaiser(x / (double) (2 * m_taps), (double) beta);
+		sum += 2.0 * coef[j];
+	}
+	double scale = (mode == lowrider_halfband_mode_decimate)? 0.5 / sum : 1.0 / sum;
+	m_center = (mode == lowrider_halfband_mode_decimate)? 0.5f : 1.0f;
+
+	// The nonzero taps are stored as one contiguous filter of length 2 * m_taps, which can be applied directly to the
+	// even input samples (decimation) or to the input (interpolation).
+	m_coef.resize(2 * m_taps);
+	for(uint32_t j = 0; j < m_taps; ++j) {
+		m_coef[m_taps - 1 - j] = (float) (coef[j] * scale);
+		m_coef[m_taps + j] = (float) (coef[j] * scale);
+	}
+	m_coef_temp.allocate(lowrider_resampler::INTERLEAVED_ALIGN,
+						 (2 * m_taps + lowrider_resampler::INTERLEAVED_ALIGN - 1) / lowrider_resampler::INTERLEAVED_ALIGN * lowrider_resampler::INTERLEAVED_ALIGN);
+
+}
+
+void lowrider_halfband::reset() {
+	m_phase = 0;
+}
+
+std::pair<uint32_t, uint32_t> lowrider_halfband::resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+														  float * const *data_out, uint32_t size_out) {
+	uint32_t count = std::min(size_out, calculate_size_out(size_in));
+	if(count == 0)
+		return std::make_pair(0u, 0u);
+	switch(m_mode) {
+		case lowrider_halfband_mode_decimate: {
+			uint32_t size_even = count + 2 * m_taps - 1;
+			m_temp.resize(size_even);
+			for(uint32_t c = 0; c < channels; ++c) {
+
+				// copy the even samples to a separate buffer, so the filter can be applied to contiguous data
+				const float *in = data_in[c];
+				for(uint32_t i = 0; i < size_even; ++i) {
+					m_temp[i] = in[2 * i];
+				}
+
+				// apply the filter, then add the center tap
+				float *out = data_out[c];
+				m_kernels->convolve(2 * m_taps, m_coef.data(), m_temp.data(), out, count);
+				const float *center = in + (2 * m_taps - 1);
+				for(uint32_t m = 0; m < count; ++m) {
+					out[m] += m_center * center[2 * m];
+				}
+
+			}
+			return std::make_pair(2 * count, count);
+		}
+		case lowrider_halfband_mode_interpolate: {
+			// The even outputs are copies of the input, the odd outputs are calculated with the filter. If the first
+			// output is odd, the copies are shifted by one input sample.
+			uint32_t count_even = (count + 1 - m_phase) / 2, count_odd = (count + m_phase) / 2;
+			m_temp.resize(count_odd);
+			for(uint32_t c = 0; c < channels; ++c) {
+				const float *in = data_in[c];
+				float *out = data_out[c];
+				m_kernels->convolve(2 * m_taps, m_coef.data(), in, m_temp.data(), count_odd);
+				for(uint32_t n = 0; n < count_even; ++n) {
+					out[2 * n + m_phase] = in[n + m_phase + m_taps - 1];
+				}
+				for(uint32_t n = 0; n < count_odd; ++n) {
+					out[2 * n + 1 - m_phase] = m_temp[n];
+				}
+			}
+			uint32_t pos_in = (m_phase + count) / 2;
+			m_phase = (m_phase + count) % 2;
+			return std::make_pair(pos_in, count);
+		}
+	}
+	return std::make_pair(0u, 0u);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_halfband::resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+																	  float *data_out, uint32_t size_out) {
+	assert(stride % lowrider_resampler::INTERLEAVED_ALIGN == 0);
+	lowrider_firfilter_interleaved_func firfilter = m_kernels->firfilter_interleaved[lowrider_resampler_storage_f32][lowrider_resampler_interpolation_none];
+	uint32_t count = std::min(size_out, calculate_size_out(size_in));
+	if(count == 0)
+		return std::make_pair(0u, 0u);
+	switch(m_mode) {
+		case lowrider_halfband_mode_decimate: {
+
+			// copy the even frames to a separate buffer, so the filter can be applied to contiguous data
+			uint32_t size_even = count + 2 * m_taps - 1;
+			m_temp.resize((size_t) stride * size_even);
+			for(uint32_t i = 0; i < size_even; ++i) {
+				std::copy_n(data_in + (size_t) (2 * i) * stride, stride, m_temp.data() + (size_t) i * stride);
+			}
+
+			// apply the filter, then add the center tap
+			for(uint32_t m = 0; m < count; ++m) {
+				float *out = data_out + (size_t) m * stride;
+				const float *center = data_in + (size_t) (2 * m + 2 * m_taps - 1) * stride;
+				firfilter(stride, 2 * m_taps, m_coef.data(), nullptr, false, m_coef_temp.data(), m_temp.data() + (size_t) m * stride, out);
+				for(uint32_t c = 0; c < stride; ++c) {
+					out[c] += m_center * center[c];
+				}
+			}
+			return std::make_pair(2 * count, count);
+
+		}
+		case lowrider_halfband_mode_interpolate: {
+
+			// the even outputs are copies of the input, the odd outputs are calculated with the filter
+			uint32_t pos = 0;
+			for(uint32_t m = 0; m < count; ++m) {
+				float *out = data_out + (size_t) m * stride;
+				if(m_phase == 0) {
+					std::copy_n(data_in + (size_t) (pos + m_taps - 1) * stride, stride, out);
+					m_phase = 1;
+				} else {
+					firfilter(stride, 2 * m_taps, m_coef.data(), nullptr, false, m_coef_temp.data(), data_in + (size_t) pos * stride, out);
+					m_phase = 0;
+					++pos;
+				}
+			}
+			return std::make_pair(pos, count);
+
+		}
+	}
+	return std::make_pair(0u, 0u);
+}
+
+uint32_t lowrider_halfband::calculate_size_in(uint32_t size_out) {
+	switch(m_mode) {
+		case lowrider_halfband_mode_decimate: {
+			return (size_out == 0)? m_filter_length - 1 : 2 * size_out + m_filter_length - 2;
+		}
+		case lowrider_halfband_mode_interpolate: {
+			return (size_out == 0)? m_filter_length - 1 : (m_phase + size_out + 1) / 2 + m_filter_length - 1;
+		}
+	}
+	return 0;
+}
+
+uint32_t lowrider_halfband::calculate_size_out(uint32_t size_in) {
+	if(size_in < m_filter_length)
+		return 0;
+	uint32_t windows = size_in - m_filter_length + 1;
+	switch(m_mode) {
+		case lowrider_halfband_mode_decimate: {
+			return (windows + 1) / 2;
+		}
+		case lowrider_halfband_mode_interpolate: {
+			return 2 * windows - m_phase;
+		}
+	}
+	return 0;
+}
+
+float lowrider_halfband::get_latency_in() {
+	switch(m_mode) {
+		case lowrider_halfband_mode_decimate: {
+			return (float) (2 * m_taps - 1);
+		}
+		case lowrider_halfband_mode_interpolate: {
+			return (float) (m_taps - 1) + 0.5f * (float) m_phase;
+		}
+	}
+	return 0.0f;
+}
+
+float lowrider_halfband::get_latency_out() {
+	return (float) ((double) get_latency_in() / get_ratio());
+}
+
+double lowrider_halfband::get_ratio() {
+	return (m_mode == lowrider_halfband_mode_decimate)? 2.0 : 0.5;
+}
+
+uint32_t lowrider_halfband::get_filter_length() {
+	return m_filter_length;
+}
+
+float lowrider_halfband::get_filter_delay() {
+	// This is the average latency plus 0.5, to match the definition used by lowrider_resampler (where the latency is
+	// filter_delay - 1 + offset, and the offset is uniformly distributed between 0 and 1).
+	return (m_mode == lowrider_halfband_mode_decimate)? (float) (2 * m_taps) - 0.5f : (float) m_taps - 0.25f;
+}
+
+lowrider_halfband_mode lowrider_halfband::get_mode() {
+	return m_mode;
+}
+
+uint32_t lowrider_halfband::get_taps() {
+	return m_taps;
+}
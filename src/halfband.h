@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "aligned_memory.h"
+#include "resampler_kernels.h"
+
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+enum lowrider_halfband_mode {
+	lowrider_halfband_mode_decimate,
+	lowrider_halfband_mode_interpolate,
+};
+
+/*
+This is a fixed half-band filter that either decimates or interpolates by a factor of 2. It is used by
+lowrider_resampler_chain to bring large ratios closer to 1 before (or after) the variable-rate resampler, because the filter
+length of the variable-rate resampler grows with the ratio when downsampling, and the cost per output sample grows with
+the output rate when upsampling.
+
+A half-band filter has its 6dB point at exactly a quarter of the high sample rate, and every other tap (except the center
+tap) is zero, so only the nonzero taps need to be calculated:
+	decimation:    y[m] = 0.5 * x[2m] + sum_j coef[j] * (x[2m - (2j + 1)] + x[2m + (2j + 1)])
+	interpolation: y[2n] = x[n], y[2n + 1] = sum_j 2 * coef[j] * (x[n - j] + x[n + 1 + j])
+The nonzero taps are applied with the SIMD kernels of the resampler. For decimation, the even input samples are first
+copied to a separate buffer so the taps can be applied to contiguous data.
+The passband is specified relative to the high sample rate and must be below 0.25, the stopband starts at
+0.5 - passband. The filter is windowed with a Kaiser window, just like the variable-rate resampler.
+
+The user must keep one filter length of input data for the next invocation. get_latency_in() returns the position of the
+next output sample relative to the first input sample that is still needed: 2 * taps - 1 for decimation, and
+taps - 1 or taps - 0.5 (alternating) for interpolation. get_filter_delay() returns the average of this plus 0.5, so the
+average latency is get_filter_delay() - 0.5, the same as for lowrider_resampler with a uniformly distributed offset.
+*/
+
+class lowrider_halfband {
+
+private:
+	lowrider_halfband_mode m_mode;
+	uint32_t m_taps, m_filter_length;
+	uint32_t m_phase;
+	float m_center;
+	std::vector<float> m_coef;
+	lowrider_aligned_memory<float> m_coef_temp;
+	const lowrider_resampler_kernels *m_kernels;
+
+	// even input samples (decimation) or odd output samples (interpolation)
+	std::vector<float> m_temp;
+
+public:
+	static constexpr float PASSBAND_MAX = 0.24f;
+
+public:
+	// Creates the filter. The passband is relative to the high sample rate.
+	lowrider_halfband(lowrider_halfband_mode mode, float passband, float beta);
+
+	// See lowrider_resampler.
+	void reset();
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+										   float * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+													   float *data_out, uint32_t size_out);
+	uint32_t calculate_size_in(uint32_t size_out);
+	uint32_t calculate_size_out(uint32_t size_in);
+	float get_latency_in();
+	float get_latency_out();
+	double get_ratio();
+	uint32_t get_filter_length();
+	float get_filter_delay();
+
+	// Returns the mode.
+	lowrider_halfband_mode get_mode();
+
+	// Returns the number of nonzero taps on each side of the center tap.
+	uint32_t get_taps();
+
+};
@@ -21,26 +21,29 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "aligned_memory.h"
 #include "backend_alsa.h"
+#include "filter_bank_cache.h"
 #include "miscmath.h"
+#include "mirrored_buffer.h"
 #include "options.h"
 #include "resampler.h"
+#include "resampler_chain.h"
+#include "resampler_rebuilder.h"
 #include "signals.h"
 #include "timer.h"
 
 #include <cassert>
 #include <cmath>
 #include <cstdint>
-#include <ctime>
 
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
-#include <sys/time.h>
-
 // timeout for wait calls
 static constexpr uint32_t WAIT_TIMEOUT = 100;
 
@@ -49,16 +52,21 @@ static constexpr float LOOP_FILTER_I = 0.25f;
 static constexpr float LOOP_FILTER_F1 = 6.0f;
 static constexpr float LOOP_FILTER_F2 = 10.0f;
 
-static uint64_t get_time_nano() {
-	timespec ts;
-	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-	return (uint64_t) ts.tv_sec * (uint64_t) 1000000000 + (uint64_t) ts.tv_nsec;
-}
+// Sample rate switch parameters. The input sample rate is measured over windows of RATE_SWITCH_WINDOW nanoseconds, and
+// the resampler is replaced when RATE_SWITCH_CONFIRM consecutive windows match the same standard sample rate (within
+// RATE_SWITCH_TOLERANCE). The buffers are sized for rates up to RATE_SWITCH_RANGE times higher or lower than the
+// initial input sample rate. The old and new resampler are crossfaded over RATE_SWITCH_CROSSFADE seconds.
+static constexpr uint64_t RATE_SWITCH_WINDOW = 250000000;
+static constexpr uint32_t RATE_SWITCH_CONFIRM = 2;
+static constexpr float RATE_SWITCH_TOLERANCE = 0.03f;
+static constexpr uint32_t RATE_SWITCH_RANGE = 2;
+static constexpr float RATE_SWITCH_CROSSFADE = 0.01f;
+static constexpr uint32_t STANDARD_SAMPLE_RATES[] = {8000, 11025, 16000, 22050, 32000, 44100, 48000, 64000, 88200, 96000, 176400, 192000};
 
 static void open_devices(lowrider_backend_alsa &backend_alsa) {
 
 	backend_alsa.input_open(g_option_device_in, g_option_format_in, g_option_channels_in, g_option_rate_in,
-							g_option_period_in, g_option_buffer_in, (g_option_wakeup_mode == lowrider_wakeup_mode_wait));
+							g_option_period_in, g_option_buffer_in, (g_option_wakeup_mode == lowrider_wakeup_mode_wait), g_option_mmap);
 	g_option_format_in = backend_alsa.input_get_sample_format();
 	g_option_channels_in = backend_alsa.input_get_channels();
 	g_option_rate_in = backend_alsa.input_get_sample_rate();
@@ -66,8 +74,8 @@ static void open_devices(lowrider_backend_alsa &backend_alsa) {
 	g_option_buffer_in = backend_alsa.input_get_buffer_size();
 
 	backend_alsa.output_open(g_option_device_out, g_option_format_out, g_option_channels_out, g_option_rate_out,
-							 g_option_period_out, g_option_buffer_out, false);
-	g_option_format_out = backend_alsa.input_get_sample_format();
+							 g_option_period_out, g_option_buffer_out, false, g_option_mmap);
+	g_option_format_out = backend_alsa.output_get_sample_format();
 	g_option_channels_out = backend_alsa.output_get_channels();
 	g_option_rate_out = backend_alsa.output_get_sample_rate();
 	g_option_period_out = backend_alsa.output_get_period_size();
@@ -136,6 +144,7 @@ void test_hardware() {
 		int64_t output_offset_m1 = 0, output_offset_m2 = 0, output_offset_m3 = 0;
 
 		uint64_t start_time = last_time;
+		uint64_t start_syscalls = backend_alsa.get_syscall_count(), start_hwsyncs = backend_alsa.get_hwsync_count();
 		uint32_t loops = (uint32_t) ((uint64_t) 5000000000 / (uint64_t) wakeup_period);
 		for(uint32_t loop = 0; loop < loops; ++loop) {
 
@@ -222,6 +231,12 @@ void test_hardware() {
 		double output_m3 = (double) output_offset_m3 / (double) loops;
 		double output_jitter = std::sqrt(output_m3 - 4.0 * sqr(output_m1) - 12.0 * sqr(output_m2) + 12.0 * output_m1 * output_m2);
 
+		// the timer wait is a system call as well
+		uint64_t syscalls = backend_alsa.get_syscall_count() - start_syscalls, hwsyncs = backend_alsa.get_hwsync_count() - start_hwsyncs;
+		if(g_option_wakeup_mode == lowrider_wakeup_mode_timer) {
+			syscalls += loops;
+		}
+
 		// print statistics
 		std::ios_base::fmtflags flags(std::cout.flags());
 		std::cout << std::fixed << std::setprecision(2);
@@ -241,6 +256,8 @@ void test_hardware() {
 		std::cout << " std_out=" << std_out;
 		std::cout << " jitter_in=" << input_jitter;
 		std::cout << " jitter_out=" << output_jitter;
+		std::cout << " syscalls=" << (double) syscalls / (double) loops;
+		std::cout << " hwsyncs=" << (double) hwsyncs / (double) loops;
 		std::cout << std::endl;
 		std::cout.flags(flags);
 
@@ -248,6 +265,326 @@ void test_hardware() {
 
 }
 
+// Sample buffers for the loopback. The data is either float (planar or interleaved), or int16 or int32 (always planar)
+// when the fixed-point path of the resampler is used. The input is stored in mirrored ring buffers (one for each channel,
+// or a single one for interleaved data), so the resampler always sees a contiguous window of input data without copying
+// the history. The input and resampler positions are free-running frame counters, the position in the ring buffer is
+// the counter modulo the capacity. During a sample rate switch, the old resampler writes to the crossfade buffer (which
+// has the same layout as the output buffer) and the input position of the new resampler is stored in fade_pos.
+template<typename T>
+struct loopback_buffers {
+	bool interleaved;
+	uint32_t interleaved_stride, history, output_data_size;
+	std::vector<lowrider_mirrored_buffer> input_rings;
+	uint64_t input_capacity, input_pos, resampler_pos, fade_pos;
+	lowrider_aligned_memory<T> output_memory, fade_memory;
+	std::vector<T*> input_data, output_data, fade_data;
+	std::vector<const T*> input_resampler;
+	T *input_frames, *output_frames, *fade_frames;
+};
+
+// Allocates the buffers. The input rings hold 'history' samples of history (at least one filter length), the output
+// buffer is large enough for input sample rates down to rate_in_min. The crossfade buffer is only allocated if 'fade'
+// is true. Returns the parameters for lowrider_resampler_chain::reserve that match these buffers. The loop filter can
+// change the ratio by up to a factor of two, so the reserved size is twice the output size.
+template<typename T>
+static void allocate_buffers(loopback_buffers<T> &b, uint32_t history, uint32_t rate_in_min, bool fade,
+							 uint32_t &reserve_size, bool &reserve_interleaved, uint32_t &reserve_stride) {
+
+	// high channel counts use interleaved data so the resampler can process one channel per SIMD lane
+	b.interleaved = (std::is_same<T, float>::value && g_option_channels_in >= lowrider_resampler::INTERLEAVED_CHANNELS_MIN);
+	b.interleaved_stride = (g_option_channels_in + lowrider_resampler::INTERLEAVED_ALIGN - 1) / lowrider_resampler::INTERLEAVED_ALIGN * lowrider_resampler::INTERLEAVED_ALIGN;
+	b.history = history;
+
+	// The ring buffers must hold the history plus one input buffer. The rings are created by the kernel,
+	// so they already contain zeros for the initial history.
+	size_t frame_size = (b.interleaved)? b.interleaved_stride * sizeof(T) : sizeof(T);
+	b.input_rings.resize((b.interleaved)? 1 : g_option_channels_in);
+	for(lowrider_mirrored_buffer &ring : b.input_rings) {
+		ring.allocate((history + g_option_buffer_in) * frame_size, frame_size);
+	}
+	b.input_capacity = b.input_rings[0].size() / frame_size;
+	b.input_pos = history;
+	b.resampler_pos = 0;
+	b.fade_pos = 0;
+
+	// allocate memory
+	b.output_data_size = (uint32_t) ((uint64_t) g_option_buffer_in * (uint64_t) (3 * g_option_rate_out) / (uint64_t) (2 * rate_in_min)) + 4;
+	uint32_t output_data_stride = (b.output_data_size + 3) / 4 * 4;
+	if(b.interleaved) {
+		b.output_memory.allocate(lowrider_resampler::INTERLEAVED_ALIGN, b.interleaved_stride * b.output_data_size);
+		if(fade) {
+			b.fade_memory.allocate(lowrider_resampler::INTERLEAVED_ALIGN, b.interleaved_stride * b.output_data_size);
+		}
+	} else {
+		b.output_memory.allocate(4, g_option_channels_out * output_data_stride);
+		if(fade) {
+			b.fade_memory.allocate(4, g_option_channels_out * output_data_stride);
+		}
+	}
+
+	// initialize data pointers
+	b.input_data.resize(g_option_channels_in);
+	b.input_resampler.resize(g_option_channels_in);
+	b.output_data.resize(g_option_channels_out);
+	b.fade_data.resize(g_option_channels_out);
+	b.output_frames = b.output_memory.data();
+	b.fade_frames = b.fade_memory.data();
+	if(!b.interleaved) {
+		for(uint32_t i = 0; i < g_option_channels_out; ++i) {
+			b.output_data[i] = b.output_memory.data() + output_data_stride * i;
+			b.fade_data[i] = (fade)? b.fade_memory.data() + output_data_stride * i : nullptr;
+		}
+	}
+
+	reserve_size = 2 * b.output_data_size;
+	reserve_interleaved = b.interleaved;
+	reserve_stride = (b.interleaved)? b.interleaved_stride : g_option_channels_in;
+
+}
+
+// Returns a pointer to the given input position in a ring buffer.
+template<typename T>
+static T* get_ring_pointer(loopback_buffers<T> &b, size_t ring, uint64_t pos) {
+	size_t frame_size = (b.interleaved)? b.interleaved_stride : 1;
+	return (T*) b.input_rings[ring].data() + (size_t) (pos % b.input_capacity) * frame_size;
+}
+
+// Reads as much data as possible from the input, after the data that is already in the input buffer.
+static uint32_t read_buffers(lowrider_backend_alsa &backend_alsa, loopback_buffers<float> &b) {
+	if(b.interleaved) {
+		return backend_alsa.input_read_interleaved(get_ring_pointer(b, 0, b.input_pos), b.interleaved_stride, g_option_buffer_in);
+	}
+	for(uint32_t i = 0; i < g_option_channels_in; ++i) {
+		b.input_data[i] = get_ring_pointer(b, i, b.input_pos);
+	}
+	return backend_alsa.input_read(b.input_data.data(), g_option_buffer_in);
+}
+static uint32_t read_buffers(lowrider_backend_alsa &backend_alsa, loopback_buffers<int16_t> &b) {
+	for(uint32_t i = 0; i < g_option_channels_in; ++i) {
+		b.input_data[i] = get_ring_pointer(b, i, b.input_pos);
+	}
+	return backend_alsa.input_read_s16(b.input_data.data(), g_option_buffer_in);
+}
+static uint32_t read_buffers(lowrider_backend_alsa &backend_alsa, loopback_buffers<int32_t> &b) {
+	for(uint32_t i = 0; i < g_option_channels_in; ++i) {
+		b.input_data[i] = get_ring_pointer(b, i, b.input_pos);
+	}
+	return backend_alsa.input_read_s32(b.input_data.data(), g_option_buffer_in);
+}
+
+// Writes the output buffer to the output.
+static uint32_t write_buffers(lowrider_backend_alsa &backend_alsa, loopback_buffers<float> &b, uint32_t size) {
+	return (b.interleaved)?
+		   backend_alsa.output_write_interleaved(b.output_frames, b.interleaved_stride, size) :
+		   backend_alsa.output_write(b.output_data.data(), size);
+}
+static uint32_t write_buffers(lowrider_backend_alsa &backend_alsa, loopback_buffers<int16_t> &b, uint32_t size) {
+	return backend_alsa.output_write_s16(b.output_data.data(), size);
+}
+static uint32_t write_buffers(lowrider_backend_alsa &backend_alsa, loopback_buffers<int32_t> &b, uint32_t size) {
+	return backend_alsa.output_write_s32(b.output_data.data(), size);
+}
+
+// Resampler state of the loopback. During a sample rate switch, 'next' is the new resampler, which is crossfaded in over
+// 'fade_length' output samples. The rebuilder is only used if sample rate switching is enabled.
+struct loopback_resamplers {
+	std::unique_ptr<lowrider_resampler_chain> current, next;
+	uint32_t fade_done, fade_length;
+	std::unique_ptr<lowrider_resampler_rebuilder> rebuilder;
+};
+
+// Resamples the input data from the given position up to the input position. The output is written to the output buffer,
+// or to the crossfade buffer if 'fade' is true.
+template<typename T>
+static std::pair<uint32_t, uint32_t> resample_buffers(lowrider_resampler_chain &resampler, loopback_buffers<T> &b, uint64_t pos,
+													  bool fade, uint32_t size_out) {
+	for(uint32_t i = 0; i < g_option_channels_in; ++i) {
+		b.input_resampler[i] = get_ring_pointer(b, i, pos);
+	}
+	return resampler.resample(g_option_channels_in,
+							  b.input_resampler.data(), (uint32_t) (b.input_pos - pos),
+							  (fade)? b.fade_data.data() : b.output_data.data(), size_out);
+}
+static std::pair<uint32_t, uint32_t> resample_buffers(lowrider_resampler_chain &resampler, loopback_buffers<float> &b, uint64_t pos,
+													  bool fade, uint32_t size_out) {
+	if(b.interleaved) {
+		return resampler.resample_interleaved(b.interleaved_stride,
+											  get_ring_pointer(b, 0, pos), (uint32_t) (b.input_pos - pos),
+											  (fade)? b.fade_frames : b.output_frames, size_out);
+	}
+	return resample_buffers<float>(resampler, b, pos, fade, size_out);
+}
+
+// Resamples the input data from the resampler position straight into the output device buffer. The samples are converted
+// to the device sample format by the resampler kernel, so the output buffer and the conversion pass are skipped. Returns
+// false if this is not possible, in which case nothing was done and the normal path must be used.
+template<typename T>
+static bool resample_to_device(lowrider_backend_alsa&, lowrider_resampler_chain&, loopback_buffers<T>&, std::pair<uint32_t, uint32_t>&) {
+	return false;
+}
+static bool resample_to_device(lowrider_backend_alsa &backend_alsa, lowrider_resampler_chain &resampler, loopback_buffers<float> &b,
+							   std::pair<uint32_t, uint32_t> &p) {
+	if(b.interleaved || !resampler.supports_device_output())
+		return false;
+	lowrider_sample_format format = backend_alsa.output_get_sample_format();
+	uint32_t size_in = (uint32_t) (b.input_pos - b.resampler_pos);
+	p = std::make_pair(0u, 0u);
+	while(p.second < b.output_data_size) {
+
+		// the mmap buffer may wrap around, so this can take two iterations
+		uint32_t size = b.output_data_size - p.second;
+		void *buffer = backend_alsa.output_begin(size);
+		if(buffer == nullptr) {
+			if(resampler.calculate_size_out(size_in - p.first) != 0) {
+				std::cerr << "Warning: could not write all samples" << std::endl;
+			}
+			break;
+		}
+		for(uint32_t i = 0; i < g_option_channels_in; ++i) {
+			b.input_resampler[i] = get_ring_pointer(b, i, b.resampler_pos + p.first);
+		}
+		std::pair<uint32_t, uint32_t> q = resampler.resample_device(g_option_channels_in, b.input_resampler.data(), size_in - p.first,
+																	 format, buffer, size);
+		if(backend_alsa.output_commit(q.second) != q.second) {
+			std::cerr << "Warning: could not write all samples" << std::endl;
+		}
+		p.first += q.first;
+		p.second += q.second;
+		if(q.second < size)
+			break;
+
+	}
+	return true;
+}
+
+// Mixes two samples with weight w for the second sample.
+static float crossfade_sample(float a, float b, float w) {
+	return a + (b - a) * w;
+}
+template<typename T>
+static T crossfade_sample(T a, T b, float w) {
+	return (T) std::lrint((double) a + ((double) b - (double) a) * (double) w);
+}
+
+// Crossfades from the output of the old resampler ('size_old' samples in the crossfade buffer) to the output of the new
+// resampler ('size' samples in the output buffer). If the old resampler produced fewer samples, the remaining samples are
+// faded in from silence. 'fade_done' is the number of samples of the crossfade that were already processed.
+template<typename T>
+static void crossfade_buffers(loopback_buffers<T> &b, uint32_t size_old, uint32_t size, uint32_t fade_done, uint32_t fade_length) {
+	for(uint32_t j = 0; j < size; ++j) {
+		float w = std::min(1.0f, (float) (fade_done + j + 1) / (float) fade_length);
+		for(uint32_t i = 0; i < g_option_channels_out; ++i) {
+			T &out = (b.interleaved)? b.output_frames[j * b.interleaved_stride + i] : b.output_data[i][j];
+			T old = (j >= size_old)? (T) 0 : (b.interleaved)? b.fade_frames[j * b.interleaved_stride + i] : b.fade_data[i][j];
+			out = crossfade_sample(old, out, w);
+		}
+	}
+}
+
+// Reads from the input, resamples the data and writes it to the output. Returns the number of input samples and stores
+// the number of output samples in output_samples. If the rebuilder has a new resampler ready, this starts the crossfade
+// to the new resampler, and when the crossfade is complete the old resampler is handed back to the rebuilder.
+template<typename T>
+static uint32_t process_buffers(lowrider_backend_alsa &backend_alsa, loopback_resamplers &r, loopback_buffers<T> &b,
+								float ratio, uint32_t &output_samples) {
+
+	// read from input
+	uint32_t input_samples = read_buffers(backend_alsa, b);
+	output_samples = 0;
+	if(input_samples == 0)
+		return 0;
+	b.input_pos += input_samples;
+
+	// Start the new resampler at the input position where its output lines up with the output of the old resampler. If the
+	// new resampler has a much higher latency, there may not be enough history and the crossfade starts slightly too late.
+	if(r.rebuilder && !r.next) {
+		lowrider_resampler_chain *next = r.rebuilder->take();
+		if(next != nullptr) {
+			r.next.reset(next);
+			r.next->set_ratio(ratio);
+			r.current->set_ratio(ratio);
+			int64_t pos = (int64_t) b.resampler_pos + (int64_t) std::lrint(r.current->get_latency_in() - r.next->get_latency_in());
+			b.fade_pos = (uint64_t) clamp(pos, (int64_t) (b.input_pos - b.history), (int64_t) b.input_pos);
+			r.fade_done = 0;
+		}
+	}
+
+	// Resample. Without a crossfade, the output is written directly to the output device if possible.
+	bool output_done = false;
+	if(!r.next) {
+		if(b.resampler_pos < b.input_pos) {
+			r.current->set_ratio(ratio);
+			std::pair<uint32_t, uint32_t> p;
+			output_done = resample_to_device(backend_alsa, *r.current, b, p);
+			if(!output_done) {
+				p = resample_buffers(*r.current, b, b.resampler_pos, false, b.output_data_size);
+			}
+			output_samples = p.second;
+			b.resampler_pos += p.first;
+		}
+	} else {
+
+		// The new resampler determines the amount of output data, the old resampler produces at most the same amount.
+		r.current->set_ratio(ratio);
+		r.next->set_ratio(ratio);
+		std::pair<uint32_t, uint32_t> p_next = resample_buffers(*r.next, b, b.fade_pos, false, b.output_data_size);
+		std::pair<uint32_t, uint32_t> p_current = resample_buffers(*r.current, b, b.resampler_pos, true, p_next.second);
+		output_samples = p_next.second;
+		b.fade_pos += p_next.first;
+		b.resampler_pos += p_current.first;
+		crossfade_buffers(b, p_current.second, output_samples, r.fade_done, r.fade_length);
+		r.fade_done += output_samples;
+
+		// switch to the new resampler
+		if(r.fade_done >= r.fade_length) {
+			r.rebuilder->retire(r.current.release());
+			r.current = std::move(r.next);
+			b.resampler_pos = b.fade_pos;
+		}
+
+	}
+
+	// Only a limited amount of history is kept, so the resampler must keep up with the input.
+	if(b.resampler_pos + b.history < b.input_pos || (r.next && b.fade_pos + b.history < b.input_pos)) {
+		std::cerr << "Warning: could not resample all samples" << std::endl;
+		b.resampler_pos = std::max(b.resampler_pos, b.input_pos - b.history);
+		b.fade_pos = std::max(b.fade_pos, b.input_pos - b.history);
+	}
+
+	// write to output
+	if(!output_done) {
+		uint32_t output_written = write_buffers(backend_alsa, b, output_samples);
+		if(output_written != output_samples) {
+			std::cerr << "Warning: could not write all samples" << std::endl;
+		}
+	}
+
+	return input_samples;
+}
+
+// Returns the amount of input data that is queued in the resampler, expressed in output samples. This includes the
+// fractional position of the resampler. The filter history that is always kept is subtracted, so this is close to zero
+// right after resampling and it increases smoothly as input data arrives.
+template<typename T>
+static double get_resampler_queue(lowrider_resampler_chain &resampler, const loopback_buffers<T> &b) {
+	double queued = (double) (b.input_pos - b.resampler_pos) - (double) resampler.get_latency_in()
+					- ((double) resampler.get_filter_length() - (double) resampler.get_filter_delay());
+	return queued / resampler.get_ratio();
+}
+
+// Returns the standard sample rate that matches the measured sample rate, or zero if there is no match within the
+// tolerance or the rate is outside the range supported by the buffers.
+static uint32_t find_standard_sample_rate(double rate) {
+	for(uint32_t standard_rate : STANDARD_SAMPLE_RATES) {
+		if(standard_rate * RATE_SWITCH_RANGE < g_option_rate_in || standard_rate > g_option_rate_in * RATE_SWITCH_RANGE)
+			continue;
+		if(std::fabs(rate / (double) standard_rate - 1.0) < RATE_SWITCH_TOLERANCE)
+			return standard_rate;
+	}
+	return 0;
+}
+
 void run_loopback() {
 
 	lowrider_backend_alsa backend_alsa;
@@ -290,31 +627,80 @@ void run_loopback() {
 	float current_filt1 = 0.0f, current_filt2 = 0.0f;
 
 	// create resampler
-	lowrider_resampler resampler(nominal_ratio, g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain);
-
-	// allocate memory
-	uint32_t filter_length = resampler.get_filter_length();
-	uint32_t input_data_size = filter_length + g_option_buffer_in;
-	uint32_t output_data_size = (uint32_t) ((uint64_t) g_option_buffer_in * (uint64_t) (3 * g_option_rate_out) / (uint64_t) (2 * g_option_rate_in)) + 4;
-	uint32_t input_data_stride = (input_data_size + 3) / 4 * 4;
-	uint32_t output_data_stride = (output_data_size + 3) / 4 * 4;
-	lowrider_aligned_memory<float> input_memory(4, g_option_channels_in * input_data_stride);
-	lowrider_aligned_memory<float> output_memory(4, g_option_channels_out * output_data_stride);
+	if(g_option_resampler_engine != lowrider_resampler_engine_auto &&
+	   lowrider_resampler_chain::resolve_engine(g_option_rate_in, g_option_rate_out, g_option_resampler_engine, g_option_resampler_multistage, g_option_period_in,
+												g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta,
+												g_option_resampler_phase) != g_option_resampler_engine) {
+		std::cerr << "Warning: " << get_resampler_engine_name(g_option_resampler_engine)
+				  << " resampler engine is not possible for these sample rates, using polyphase engine" << std::endl;
+	}
+	loopback_resamplers resamplers;
+	resamplers.current.reset(new lowrider_resampler_chain(
+		g_option_rate_in, g_option_rate_out, g_option_resampler_engine, g_option_resampler_multistage, g_option_period_in,
+		g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain,
+		g_option_resampler_interpolation, g_option_resampler_phase, g_option_resampler_farrow_taps,
+		(g_option_resampler_cache)? get_filter_bank_cache_dir() : std::string()));
+	lowrider_resampler_chain &resampler = *resamplers.current;
+	resamplers.fade_done = 0;
+	resamplers.fade_length = 0;
+	resampler.set_storage(g_option_resampler_storage);
+	for(uint32_t stage = 0; stage < resampler.get_stage_count(); ++stage) {
+		lowrider_fft_filter *fft_filter = resampler.get_stage_fft_filter(stage);
+		if(fft_filter != nullptr && g_option_period_in < fft_filter->get_block_size()) {
+			std::cerr << "Warning: the FFT resampler engine is inefficient for input periods shorter than " << fft_filter->get_block_size() << " samples" << std::endl;
+		}
+	}
 
-	// initialize data pointers
-	std::vector<float*> input_data(g_option_channels_in), output_data(g_option_channels_out);
-	for(uint32_t i = 0; i < g_option_channels_in; ++i) {
-		input_data[i] = input_memory.data() + input_data_stride * i + filter_length;
+	// The fixed-point path can be used if both devices use S16 or S32 and the resampler has a single stage. Otherwise
+	// all samples are converted to float.
+	lowrider_sample_format processing_format = lowrider_sample_format_f32;
+	if(g_option_resampler_fixed_point) {
+		if(g_option_format_in == g_option_format_out && resampler.supports_fixed_point() &&
+		   (g_option_format_in == lowrider_sample_format_s16 || g_option_format_in == lowrider_sample_format_s32)) {
+			processing_format = g_option_format_in;
+			resampler.prepare_fixed_point((processing_format == lowrider_sample_format_s16)? lowrider_resampler_fixed_point_s16 : lowrider_resampler_fixed_point_s32);
+			std::cerr << "Info: using fixed-point resampler" << std::endl;
+		} else {
+			std::cerr << "Warning: fixed-point resampler requires S16 or S32 for both devices and a single resampler stage, using floating point" << std::endl;
+		}
 	}
-	for(uint32_t i = 0; i < g_option_channels_out; ++i) {
-		output_data[i] = output_memory.data() + output_data_stride * i + filter_length;
+	if(processing_format == lowrider_sample_format_f32 && g_option_channels_in < lowrider_resampler::INTERLEAVED_CHANNELS_MIN &&
+	   resampler.supports_device_output()) {
+		std::cerr << "Info: resampler writes directly to the output device" << std::endl;
 	}
 
-	// initialize resampler buffer
-	std::vector<float*> input_resampler(g_option_channels_in);
-	uint32_t resampler_pos = 0;
-	for(uint32_t i = 0; i < g_option_channels_in; ++i) {
-		std::fill_n(input_data[i] - filter_length, filter_length, 0.0f);
+	// The filter length (in input samples) is roughly proportional to the input sample rate when downsampling, so the
+	// buffers are made large enough for the highest input sample rate that can be selected by a sample rate switch.
+	uint32_t history = resampler.get_filter_length(), rate_in_min = g_option_rate_in;
+	if(g_option_rate_switch) {
+		history *= RATE_SWITCH_RANGE;
+		rate_in_min = std::max(1u, g_option_rate_in / RATE_SWITCH_RANGE);
+		resamplers.fade_length = std::max(1u, (uint32_t) std::lrint(RATE_SWITCH_CROSSFADE * (float) g_option_rate_out));
+	}
+
+	// allocate memory
+	loopback_buffers<float> buffers_f32;
+	loopback_buffers<int16_t> buffers_s16;
+	loopback_buffers<int32_t> buffers_s32;
+	uint32_t reserve_size, reserve_stride;
+	bool reserve_interleaved;
+	switch(processing_format) {
+		case lowrider_sample_format_s16: allocate_buffers(buffers_s16, history, rate_in_min, g_option_rate_switch, reserve_size, reserve_interleaved, reserve_stride); break;
+		case lowrider_sample_format_s32: allocate_buffers(buffers_s32, history, rate_in_min, g_option_rate_switch, reserve_size, reserve_interleaved, reserve_stride); break;
+		default: allocate_buffers(buffers_f32, history, rate_in_min, g_option_rate_switch, reserve_size, reserve_interleaved, reserve_stride); break;
+	}
+	resampler.reserve(reserve_size, reserve_interleaved, reserve_stride);
+
+	// the new resamplers are created on a worker thread, including the buffers between their stages
+	if(g_option_rate_switch) {
+		resamplers.rebuilder.reset(new lowrider_resampler_rebuilder(
+			g_option_rate_out, g_option_resampler_engine, g_option_resampler_multistage, g_option_period_in,
+			g_option_resampler_passband, g_option_resampler_stopband, g_option_resampler_beta, g_option_resampler_gain,
+			g_option_resampler_interpolation, g_option_resampler_phase, g_option_resampler_farrow_taps, g_option_resampler_storage,
+			(processing_format != lowrider_sample_format_f32),
+			(processing_format == lowrider_sample_format_s16)? lowrider_resampler_fixed_point_s16 : lowrider_resampler_fixed_point_s32,
+			history, reserve_size, reserve_interleaved, reserve_stride,
+			(g_option_resampler_cache)? get_filter_bank_cache_dir() : std::string()));
 	}
 
 	// fill output buffer
@@ -378,6 +764,9 @@ void run_loopback() {
 	uint64_t start_time = get_time_nano();
 	bool faststart = true;
 	uint32_t faststart_steps = 0;
+	uint32_t current_rate_in = g_option_rate_in;
+	uint64_t rate_window_start = 0, rate_window_samples = 0;
+	uint32_t rate_candidate = 0, rate_candidate_windows = 0;
 	while(!g_sigint_flag) {
 
 		// wait for wakeup
@@ -391,6 +780,7 @@ void run_loopback() {
 				break;
 			}
 		}
+		uint64_t wakeup_time = get_time_nano();
 
 		// make sure that the input and output are still running
 		if(!backend_alsa.input_running()) {
@@ -400,43 +790,64 @@ void run_loopback() {
 			throw std::runtime_error("output stopped unexpectedly");
 		}
 
-		// read from input
-		uint32_t input_samples = backend_alsa.input_read(input_data.data(), g_option_buffer_in);
-		uint32_t output_samples = 0;
-		if(input_samples != 0) {
-
-			// resample
-			if(resampler_pos < filter_length + input_samples) {
-				for(uint32_t i = 0; i < g_option_channels_in; ++i) {
-					input_resampler[i] = input_data[i] - filter_length + resampler_pos;
-				}
-				resampler.set_ratio(nominal_ratio / (1.0f + clamp(current_filt2, -0.5f, 0.5f)));
-				auto p = resampler.resample(g_option_channels_in,
-											input_resampler.data(), filter_length + input_samples - resampler_pos,
-											output_data.data(), output_data_size);
-				output_samples = p.second;
-				resampler_pos += p.first;
-			}
-			for(uint32_t i = 0; i < g_option_channels_in; ++i) {
-				std::copy(input_data[i] - filter_length + input_samples, input_data[i] + input_samples, input_data[i] - filter_length);
-			}
-			if(input_samples > resampler_pos) {
-				std::cerr << "Warning: could not resample all samples" << std::endl;
-				resampler_pos = 0;
-			} else {
-				resampler_pos -= input_samples;
-			}
+		// Query the output status once, before writing. This gives the buffer level at the wakeup time (see below) and the
+		// free space that the output functions will use without querying the hardware pointer again.
+		double buffer_level = backend_alsa.output_get_buffer_level(wakeup_time);
+
+		// read from input, resample and write to output
+		float ratio = nominal_ratio / (1.0f + clamp(current_filt2, -0.5f, 0.5f));
+		uint32_t input_samples, output_samples = 0;
+		switch(processing_format) {
+			case lowrider_sample_format_s16: input_samples = process_buffers(backend_alsa, resamplers, buffers_s16, ratio, output_samples); break;
+			case lowrider_sample_format_s32: input_samples = process_buffers(backend_alsa, resamplers, buffers_s32, ratio, output_samples); break;
+			default: input_samples = process_buffers(backend_alsa, resamplers, buffers_f32, ratio, output_samples); break;
+		}
 
-			// write to output
-			if(backend_alsa.output_write(output_data.data(), output_samples) != output_samples) {
-				std::cerr << "Warning: could not write all samples" << std::endl;
+		// Measure the input sample rate between reads, so the time between the wakeup and the first read doesn't matter.
+		// When the input sample rate changes, the old resampler is immediately switched to the new nominal ratio and the
+		// loop filter is restarted. The new resampler is crossfaded in as soon as the rebuilder has created it.
+		if(resamplers.rebuilder && input_samples != 0) {
+			uint64_t current_time = get_time_nano();
+			if(rate_window_start == 0) {
+				rate_window_start = current_time;
+			} else {
+				rate_window_samples += input_samples;
+				if(current_time - rate_window_start >= RATE_SWITCH_WINDOW) {
+					double measured_rate = (double) rate_window_samples * 1.0e9 / (double) (current_time - rate_window_start);
+					uint32_t rate = find_standard_sample_rate(measured_rate);
+					rate_window_start = current_time;
+					rate_window_samples = 0;
+					if(rate != 0 && rate != current_rate_in) {
+						rate_candidate_windows = (rate == rate_candidate)? rate_candidate_windows + 1 : 1;
+						rate_candidate = rate;
+						if(rate_candidate_windows >= RATE_SWITCH_CONFIRM && resamplers.rebuilder->request(rate)) {
+							std::cerr << "Info: input sample rate changed to " << rate << " Hz" << std::endl;
+							current_rate_in = rate;
+							nominal_ratio = (float) rate / (float) g_option_rate_out;
+							current_drift = 0.0f;
+							current_filt1 = 0.0f;
+							current_filt2 = 0.0f;
+							faststart = true;
+							faststart_steps = 0;
+							rate_candidate_windows = 0;
+						}
+					} else {
+						rate_candidate_windows = 0;
+					}
+				}
 			}
-
 		}
 
-		// update loop filter
-		uint32_t buffer_used = backend_alsa.output_get_buffer_used();
-		float error = (float) ((int32_t) g_option_target_level - (int32_t) buffer_used) / (float) g_option_rate_out;
+		// Update the loop filter. The output buffer level is extrapolated to the wakeup time and the input data that is still
+		// queued in the resampler is added, so the loop filter sees a smooth level rather than the granularity of the
+		// hardware pointer, the input blocks and the wakeup jitter.
+		buffer_level += (double) output_samples;
+		switch(processing_format) {
+			case lowrider_sample_format_s16: buffer_level += get_resampler_queue(*resamplers.current, buffers_s16); break;
+			case lowrider_sample_format_s32: buffer_level += get_resampler_queue(*resamplers.current, buffers_s32); break;
+			default: buffer_level += get_resampler_queue(*resamplers.current, buffers_f32); break;
+		}
+		float error = (float) (((double) g_option_target_level - buffer_level) / (double) g_option_rate_out);
 		float scaled_p = loop_p, scaled_f1 = loop_f1, scaled_f2 = loop_f2;
 		if(faststart) {
 			float scale = max_loop_bandwidth / (g_option_loop_bandwidth * (1.0f + (float) faststart_steps / LOOP_FILTER_F2));
@@ -457,10 +868,10 @@ void run_loopback() {
 		// print trace data
 		if(g_option_trace_loopback) {
 			std::ios_base::fmtflags flags(std::cout.flags());
-			std::cout << std::setw(12) << (get_time_nano() - start_time);
+			std::cout << std::setw(12) << (wakeup_time - start_time);
 			std::cout << std::setw(9) << input_samples;
 			std::cout << std::setw(9) << output_samples;
-			std::cout << std::setw(9) << buffer_used;
+			std::cout << std::fixed << std::setw(9) << std::setprecision(1) << buffer_level;
 			std::cout << std::scientific << std::setw(15) << std::setprecision(5) << current_drift;
 			std::cout << std::scientific << std::setw(15) << std::setprecision(5) << current_filt2;
 			std::cout << std::endl;
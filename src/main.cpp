@@ -18,6 +18,8 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "analyze_resampler.h"
+#include "benchmark_resampler.h"
+#include "design_resampler.h"
 #include "loopback.h"
 #include "options.h"
 #include "priority.h"
@@ -49,6 +51,10 @@ int main(int argc, char *argv[]) {
 			print_version();
 		} else if(g_option_analyze_resampler) {
 			analyze_resampler();
+		} else if(g_option_benchmark_resampler) {
+			benchmark_resampler();
+		} else if(g_option_design_resampler) {
+			design_resampler();
 		} else if(g_option_test_hardware) {
 			test_hardware();
 		} else {
@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mirrored_buffer.h"
+
+#include "string_helper.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+lowrider_mirrored_buffer::lowrider_mirrored_buffer() noexcept {
+	m_data = nullptr;
+	m_size = 0;
+}
+
+lowrider_mirrored_buffer::~lowrider_mirrored_buffer() noexcept {
+	free();
+}
+
+lowrider_mirrored_buffer::lowrider_mirrored_buffer(lowrider_mirrored_buffer &&other) noexcept {
+	m_data = other.m_data;
+	m_size = other.m_size;
+	other.m_data = nullptr;
+	other.m_size = 0;
+}
+
+lowrider_mirrored_buffer& lowrider_mirrored_buffer::operator=(lowrider_mirrored_buffer &&other) noexcept {
+	free();
+	m_data = other.m_data;
+	m_size = other.m_size;
+	other.m_data = nullptr;
+	other.m_size = 0;
+	return *this;
+}
+
+void lowrider_mirrored_buffer::allocate(size_t size, size_t granularity) {
+	free();
+
+	// round up to a multiple of the least common multiple of the granularity and the page size
+	size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+	size_t a = page_size, b = granularity;
+	while(b != 0) {
+		size_t t = a % b;
+		a = b;
+		b = t;
+	}
+	size_t unit = page_size / a * granularity;
+	size_t buffer_size = (std::max<size_t>(size, 1) + unit - 1) / unit * unit;
+
+	// create the memory
+	int fd = memfd_create("lowrider", MFD_CLOEXEC);
+	if(fd == -1) {
+		throw std::runtime_error(make_string("failed to create mirrored buffer: ", strerror(errno)));
+	}
+	if(ftruncate(fd, (off_t) buffer_size) != 0) {
+		int error = errno;
+		close(fd);
+		throw std::runtime_error(make_string("failed to resize mirrored buffer: ", strerror(error)));
+	}
+
+	// Reserve twice the size, then replace both halves with the same memory. The reservation makes sure that nothing
+	// else can be mapped in between.
+	void *map = mmap(nullptr, 2 * buffer_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(map == MAP_FAILED) {
+		int error = errno;
+		close(fd);
+		throw std::runtime_error(make_string("failed to reserve mirrored buffer: ", strerror(error)));
+	}
+	for(size_t i = 0; i < 2; ++i) {
+		void *half = (char*) map + i * buffer_size;
+		if(mmap(half, buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != half) {
+			int error = errno;
+			munmap(map, 2 * buffer_size);
+			close(fd);
+			throw std::runtime_error(make_string("failed to map mirrored buffer: ", strerror(error)));
+		}
+	}
+
+	// the mappings keep the memory alive
+	close(fd);
+	m_data = map;
+	m_size = buffer_size;
+
+}
+
+void lowrider_mirrored_buffer::free() noexcept {
+	if(m_data != nullptr) {
+		munmap(m_data, 2 * m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
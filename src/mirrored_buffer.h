@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+/*
+A ring buffer whose memory is mapped twice into consecutive virtual memory, so the byte at offset i + size() is the same
+as the byte at offset i. Any range of at most size() bytes that starts in the first half is therefore contiguous, even if
+it wraps around the end of the ring buffer. This lets the user read and write the ring buffer with plain pointers,
+without copying data to the start of the buffer.
+
+The memory is a memfd, which is mapped twice with MAP_SHARED. The size is always a multiple of the page size. New
+buffers are filled with zeros.
+*/
+
+class lowrider_mirrored_buffer {
+
+private:
+	void *m_data;
+	size_t m_size;
+
+public:
+	lowrider_mirrored_buffer() noexcept;
+	~lowrider_mirrored_buffer() noexcept;
+
+	lowrider_mirrored_buffer(const lowrider_mirrored_buffer&) = delete;
+	lowrider_mirrored_buffer(lowrider_mirrored_buffer &&other) noexcept;
+
+	lowrider_mirrored_buffer& operator=(const lowrider_mirrored_buffer&) = delete;
+	lowrider_mirrored_buffer& operator=(lowrider_mirrored_buffer &&other) noexcept;
+
+	// Allocates a new buffer of at least 'size' bytes. The actual size is a multiple of both 'granularity' and the page
+	// size. Throws std::runtime_error if the buffer can't be created.
+	void allocate(size_t size, size_t granularity);
+
+	// Frees the buffer.
+	void free() noexcept;
+
+	// Returns a pointer to the start of the first mapping.
+	void* data() noexcept {
+		return m_data;
+	}
+
+	// Returns the size of the buffer in bytes (i.e. the size of one of the mappings).
+	size_t size() const noexcept {
+		return m_size;
+	}
+
+};
@@ -21,6 +21,8 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 #include <algorithm>
 
@@ -49,6 +51,11 @@ template<> inline double clamp<double, double>(double v, double lo, double hi) {
 	return std::min(std::max(v, lo), hi);
 }
 
+// Normalized sinc function: sin(pi * x) / (pi * x).
+inline double sinc(double x) {
+	return (std::abs(x) < 1.0e-9)? 1.0 : std::sin(x * (double) M_PI) / (x * (double) M_PI);
+}
+
 template<typename F>
 inline int32_t rint32(F x) {
 	return (sizeof(long int) >= sizeof(int32_t))? (int32_t) std::lrint(x) : (int32_t) std::llrint(x);
@@ -58,3 +65,37 @@ template<typename F>
 inline int64_t rint64(F x) {
 	return (sizeof(long int) >= sizeof(int64_t))? (int64_t) std::lrint(x) : (int64_t) std::llrint(x);
 }
+
+// Returns the number of representable floats between a and b (i.e. the distance in units in the last place).
+inline uint32_t ulp_distance(float a, float b) {
+	int32_t ia, ib;
+	std::memcpy(&ia, &a, sizeof(float));
+	std::memcpy(&ib, &b, sizeof(float));
+	int64_t la = (ia < 0)? (int64_t) INT32_MIN - (int64_t) ia : (int64_t) ia;
+	int64_t lb = (ib < 0)? (int64_t) INT32_MIN - (int64_t) ib : (int64_t) ib;
+	return (uint32_t) std::min<int64_t>(std::abs(la - lb), UINT32_MAX);
+}
+
+// Converts a float to IEEE half precision, rounding to nearest even. Values outside the range are saturated to the
+// largest finite value. Values below the normal range are stored as denormals.
+inline uint16_t float_to_f16(float x) {
+	uint32_t bits;
+	std::memcpy(&bits, &x, sizeof(float));
+	uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+	float a = std::abs(x);
+	if(!(a < 65504.0f))
+		return sign | 0x7bff;
+	if(a < 6.103515625e-05f) // 2^-14, the smallest normal value
+		return sign | (uint16_t) rint32(a * 16777216.0f); // multiples of 2^-24, rounding up to 2^-14 gives the correct result
+	uint32_t value = ((((bits >> 23) & 0xff) - 127 + 15) << 10) | ((bits >> 13) & 0x3ff), rest = bits & 0x1fff;
+	if(rest > 0x1000 || (rest == 0x1000 && (value & 1)))
+		++value; // a carry into the exponent gives the correct result
+	return sign | (uint16_t) std::min<uint32_t>(value, 0x7bff);
+}
+
+// Converts a float to bfloat16 (the upper 16 bits of a float), rounding to nearest even.
+inline uint16_t float_to_bf16(float x) {
+	uint32_t bits;
+	std::memcpy(&bits, &x, sizeof(float));
+	return (uint16_t) ((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+}
@@ -19,6 +19,7 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "options.h"
 
+#include "farrow.h"
 #include "resampler.h"
 #include "string_helper.h"
 
@@ -30,8 +31,12 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 bool g_option_help = false;
 bool g_option_version = false;
 bool g_option_analyze_resampler = false;
+bool g_option_benchmark_resampler = false;
+bool g_option_design_resampler = false;
 bool g_option_test_hardware = false;
 
+lowrider_analyze_method g_option_analyze_method = lowrider_analyze_method_tones;
+
 bool g_option_trace_loopback = false;
 
 std::string g_option_device_in;
@@ -46,6 +51,7 @@ uint32_t g_option_period_in = 256;
 uint32_t g_option_period_out = 256;
 uint32_t g_option_buffer_in = 1024;
 uint32_t g_option_buffer_out = 1024;
+bool g_option_mmap = true;
 
 uint32_t g_option_target_level = 128;
 
@@ -58,11 +64,23 @@ bool g_option_memory_lock = true;
 float g_option_loop_bandwidth = 0.1f;
 float g_option_initial_drift = 0.0f;
 float g_option_max_drift = 0.002f;
+bool g_option_rate_switch = false;
+
+float g_option_max_latency = 0.0f;
+float g_option_max_cpu = 0.0f;
 
 float g_option_resampler_passband = 0.42f;
 float g_option_resampler_stopband = 0.50f;
 float g_option_resampler_beta = 8.0f;
 float g_option_resampler_gain = 1.0f;
+lowrider_resampler_interpolation g_option_resampler_interpolation = lowrider_resampler_interpolation_linear;
+lowrider_resampler_phase g_option_resampler_phase = lowrider_resampler_phase_linear;
+lowrider_resampler_engine g_option_resampler_engine = lowrider_resampler_engine_auto;
+uint32_t g_option_resampler_farrow_taps = 4;
+bool g_option_resampler_multistage = true;
+bool g_option_resampler_fixed_point = false;
+lowrider_resampler_storage g_option_resampler_storage = lowrider_resampler_storage_f32;
+bool g_option_resampler_cache = true;
 
 void print_help() {
 	std::cout << "Usage: lowrider [OPTION]" << std::endl;
@@ -72,14 +90,24 @@ void print_help() {
 	std::cout << "  --version                    Show version information." << std::endl;
 	std::cout << "  --analyze-resampler          Analyze the frequency response and accuracy of the" << std::endl;
 	std::cout << "                               resampler using the specified resampler parameters." << std::endl;
-	std::cout << "  --test-hardware              Run a hardware test and show timing statistics." << std::endl;
+	std::cout << "  --analyze-method=METHOD      Set the measurement method of --analyze-resampler and" << std::endl;
+	std::cout << "                               --design-resampler (default 'tones'). Can be 'tones' or" << std::endl;
+	std::cout << "                               'chirp'. The tone method measures each test frequency" << std::endl;
+	std::cout << "                               separately. The chirp method measures the whole spectrum" << std::endl;
+	std::cout << "                               (including the stopband and aliasing images) in a single" << std::endl;
+	std::cout << "                               run, which is much faster." << std::endl;
+	std::cout << "  --benchmark-resampler        Measure the performance of the resampler." << std::endl;
+	std::cout << "  --design-resampler           Search for the resampler parameters with the highest SNR that" << std::endl;
+	std::cout << "                               fit within --max-latency and --max-cpu, and print the" << std::endl;
+	std::cout << "                               Pareto-optimal settings and the options to use." << std::endl;
+	std::cout << "  --test-hardware              Run a hardware test and show timing and system call statistics." << std::endl;
 	std::cout << "  --trace-loopback             Output trace data during loopback operation (for testing)." << std::endl;
 	std::cout << "  --device-in=NAME             Set the input device (e.g. 'hw:1')." << std::endl;
 	std::cout << "  --device-out=NAME            Set the output device (e.g. 'hw:2')." << std::endl;
 	std::cout << "  --format-in=FORMAT           Set the input sample format (default 'any')." << std::endl;
-	std::cout << "                               Can be 'any', 'f32', 's32', 's24' or 's16'." << std::endl;
+	std::cout << "                               Can be 'any', 'f32', 's32', 's24', 's24_3le' or 's16'." << std::endl;
 	std::cout << "  --format-out=FORMAT          Set the output sample format (default 'any')." << std::endl;
-	std::cout << "                               Can be 'any', 'f32', 's32', 's24' or 's16'." << std::endl;
+	std::cout << "                               Can be 'any', 'f32', 's32', 's24', 's24_3le' or 's16'." << std::endl;
 	std::cout << "  --channels-in=NUM            Set the number of input channels (default 2)." << std::endl;
 	std::cout << "  --channels-out=NUM           Set the number of output channels (default 2)." << std::endl;
 	std::cout << "  --rate-in=RATE               Set the input sample rate (default 48000 Hz)." << std::endl;
@@ -88,6 +116,8 @@ void print_help() {
 	std::cout << "  --period-out=SIZE            Set the output period size (default 256)." << std::endl;
 	std::cout << "  --buffer-in=SIZE             Set the input buffer size (default 1024)." << std::endl;
 	std::cout << "  --buffer-out=SIZE            Set the output buffer size (default 1024)." << std::endl;
+	std::cout << "  --mmap=ENABLE                Set whether devices should be accessed through mmap when supported" << std::endl;
+	std::cout << "                               (default true)." << std::endl;
 	std::cout << "  --target-level=LEVEL         Set the targeted buffer fill level (default 128)." << std::endl;
 	std::cout << "  --wakeup-mode=MODE           Set the wakeup mode (default 'timer')." << std::endl;
 	std::cout << "                               Can be 'timer' or 'wait'." << std::endl;
@@ -97,10 +127,56 @@ void print_help() {
 	std::cout << "  --loop-bandwidth=FREQUENCY   Set the bandwidth of the feedback loop (default 0.1 Hz)." << std::endl;
 	std::cout << "  --initial-drift=DRIFT        Set the initial clock drift estimate (default 0.0)." << std::endl;
 	std::cout << "  --max-drift=DRIFT            Set the maximum allowed clock drift (default 0.002)." << std::endl;
+	std::cout << "  --rate-switch=ENABLE         Set whether the resampler should follow input sample rate" << std::endl;
+	std::cout << "                               changes (e.g. an S/PDIF source switching between 44100 Hz" << std::endl;
+	std::cout << "                               and 48000 Hz) without restarting (default false). The new" << std::endl;
+	std::cout << "                               rate must be a standard rate between half and double the" << std::endl;
+	std::cout << "                               input sample rate." << std::endl;
+	std::cout << "  --max-latency=MS             Set the latency budget of the resampler for" << std::endl;
+	std::cout << "                               --design-resampler (default 0, no limit)." << std::endl;
+	std::cout << "  --max-cpu=NS_PER_SAMPLE      Set the CPU budget of the resampler for --design-resampler," << std::endl;
+	std::cout << "                               in nanoseconds per sample (default 0, no limit)." << std::endl;
 	std::cout << "  --resampler-passband=VALUE   Set the resampler passband parameter (default 0.42)." << std::endl;
 	std::cout << "  --resampler-stopband=VALUE   Set the resampler stopband parameter (default 0.50)." << std::endl;
 	std::cout << "  --resampler-beta=VALUE       Set the resampler beta parameter (default 8.0)." << std::endl;
 	std::cout << "  --resampler-gain=VALUE       Set the resampler gain parameter (default 1.0)." << std::endl;
+	std::cout << "  --resampler-interpolation=METHOD  Set the interpolation method between filter bank rows" << std::endl;
+	std::cout << "                               (default 'linear'). Can be 'linear' or 'cubic'. Cubic" << std::endl;
+	std::cout << "                               interpolation uses a much smaller filter bank." << std::endl;
+	std::cout << "  --resampler-phase=PHASE      Set the phase response of the resampler filter (default" << std::endl;
+	std::cout << "                               'linear'). Can be 'linear' or 'minimum'. Minimum phase" << std::endl;
+	std::cout << "                               filters have a much lower latency." << std::endl;
+	std::cout << "  --resampler-engine=ENGINE    Set the resampler engine (default 'auto'). Can be 'auto'," << std::endl;
+	std::cout << "                               'polyphase', 'rational', 'fft', 'farrow' or 'slip'. The" << std::endl;
+	std::cout << "                               rational engine (experimental, slower than polyphase) uses an" << std::endl;
+	std::cout << "                               exact rational resampler for the nominal ratio followed by a" << std::endl;
+	std::cout << "                               short variable-rate resampler for the clock drift. The fft" << std::endl;
+	std::cout << "                               engine applies very long filters in the frequency domain," << std::endl;
+	std::cout << "                               which is only efficient with very large periods. The farrow" << std::endl;
+	std::cout << "                               engine uses a short Lagrange interpolator with a latency of a" << std::endl;
+	std::cout << "                               few samples, but without a stopband. The slip engine doesn't" << std::endl;
+	std::cout << "                               filter at all, it drops or repeats single samples at quiet" << std::endl;
+	std::cout << "                               points, which is almost as cheap as a copy. The farrow and" << std::endl;
+	std::cout << "                               slip engines require equal input and output rates. Use" << std::endl;
+	std::cout << "                               --benchmark-resampler to compare the speed and" << std::endl;
+	std::cout << "                               --analyze-resampler to compare the accuracy." << std::endl;
+	std::cout << "  --resampler-farrow-taps=N    Set the number of taps of the farrow engine (default 4). Must" << std::endl;
+	std::cout << "                               be even, between 2 and 16. More taps reduce the passband" << std::endl;
+	std::cout << "                               error but increase the latency (taps / 2 - 1 samples)." << std::endl;
+	std::cout << "  --resampler-multistage=ENABLE  Set whether large ratios should be handled by a series of" << std::endl;
+	std::cout << "                               half-band filters in front of or after the resampler" << std::endl;
+	std::cout << "                               (default true). This is faster, but increases the latency." << std::endl;
+	std::cout << "  --resampler-fixed-point=ENABLE  Set whether S16 or S32 data should be resampled without" << std::endl;
+	std::cout << "                               converting it to floating point, if the input and output use" << std::endl;
+	std::cout << "                               the same format and the resampler has a single stage (default" << std::endl;
+	std::cout << "                               false). For S16 this has a lower SNR, use --analyze-resampler" << std::endl;
+	std::cout << "                               and --benchmark-resampler to compare." << std::endl;
+	std::cout << "  --resampler-storage=FORMAT   Set the storage format of the filter bank (default 'f32')." << std::endl;
+	std::cout << "                               Can be 'f32', 'f16' or 'bf16'. The 16-bit formats halve the" << std::endl;
+	std::cout << "                               size of the filter bank but add rounding errors, use" << std::endl;
+	std::cout << "                               --analyze-resampler to check the SNR." << std::endl;
+	std::cout << "  --resampler-cache=ENABLE     Set whether generated filter banks should be cached in" << std::endl;
+	std::cout << "                               $XDG_CACHE_HOME/lowrider (default true)." << std::endl;
 }
 
 void print_version() {
@@ -163,6 +239,8 @@ static void parse_option_sample_format(bool has_value, const std::string &option
 		result = lowrider_sample_format_s32;
 	} else if(lower == "s24") {
 		result = lowrider_sample_format_s24;
+	} else if(lower == "s24_3le") {
+		result = lowrider_sample_format_s24_3le;
 	} else if(lower == "s16") {
 		result = lowrider_sample_format_s16;
 	} else {
@@ -184,6 +262,86 @@ static void parse_option_wakeup_mode(bool has_value, const std::string &option,
 	}
 }
 
+static void parse_option_analyze_method(bool has_value, const std::string &option, const std::string &value, lowrider_analyze_method &result) {
+	if(!has_value) {
+		throw std::runtime_error(make_string("option '", option, "' requires a value"));
+	}
+	std::string lower = to_lower(value);
+	if(lower == "tones") {
+		result = lowrider_analyze_method_tones;
+	} else if(lower == "chirp") {
+		result = lowrider_analyze_method_chirp;
+	} else {
+		throw std::runtime_error(make_string("invalid value '", value, "' for option '", option, "'"));
+	}
+}
+
+static void parse_option_resampler_interpolation(bool has_value, const std::string &option, const std::string &value, lowrider_resampler_interpolation &result) {
+	if(!has_value) {
+		throw std::runtime_error(make_string("option '", option, "' requires a value"));
+	}
+	std::string lower = to_lower(value);
+	if(lower == "linear") {
+		result = lowrider_resampler_interpolation_linear;
+	} else if(lower == "cubic") {
+		result = lowrider_resampler_interpolation_cubic;
+	} else {
+		throw std::runtime_error(make_string("invalid value '", value, "' for option '", option, "'"));
+	}
+}
+
+static void parse_option_resampler_phase(bool has_value, const std::string &option, const std::string &value, lowrider_resampler_phase &result) {
+	if(!has_value) {
+		throw std::runtime_error(make_string("option '", option, "' requires a value"));
+	}
+	std::string lower = to_lower(value);
+	if(lower == "linear") {
+		result = lowrider_resampler_phase_linear;
+	} else if(lower == "minimum") {
+		result = lowrider_resampler_phase_minimum;
+	} else {
+		throw std::runtime_error(make_string("invalid value '", value, "' for option '", option, "'"));
+	}
+}
+
+static void parse_option_resampler_engine(bool has_value, const std::string &option, const std::string &value, lowrider_resampler_engine &result) {
+	if(!has_value) {
+		throw std::runtime_error(make_string("option '", option, "' requires a value"));
+	}
+	std::string lower = to_lower(value);
+	if(lower == "auto") {
+		result = lowrider_resampler_engine_auto;
+	} else if(lower == "polyphase") {
+		result = lowrider_resampler_engine_polyphase;
+	} else if(lower == "rational") {
+		result = lowrider_resampler_engine_rational;
+	} else if(lower == "fft") {
+		result = lowrider_resampler_engine_fft;
+	} else if(lower == "farrow") {
+		result = lowrider_resampler_engine_farrow;
+	} else if(lower == "slip") {
+		result = lowrider_resampler_engine_slip;
+	} else {
+		throw std::runtime_error(make_string("invalid value '", value, "' for option '", option, "'"));
+	}
+}
+
+static void parse_option_resampler_storage(bool has_value, const std::string &option, const std::string &value, lowrider_resampler_storage &result) {
+	if(!has_value) {
+		throw std::runtime_error(make_string("option '", option, "' requires a value"));
+	}
+	std::string lower = to_lower(value);
+	if(lower == "f32") {
+		result = lowrider_resampler_storage_f32;
+	} else if(lower == "f16") {
+		result = lowrider_resampler_storage_f16;
+	} else if(lower == "bf16") {
+		result = lowrider_resampler_storage_bf16;
+	} else {
+		throw std::runtime_error(make_string("invalid value '", value, "' for option '", option, "'"));
+	}
+}
+
 void parse_options(int argc, char *argv[]) {
 
 	// parse options
@@ -210,6 +368,12 @@ void parse_options(int argc, char *argv[]) {
 			parse_option_novalue(has_value, option, g_option_version);
 		} else if(option == "--analyze-resampler") {
 			parse_option_novalue(has_value, option, g_option_analyze_resampler);
+		} else if(option == "--analyze-method") {
+			parse_option_analyze_method(has_value, option, value, g_option_analyze_method);
+		} else if(option == "--benchmark-resampler") {
+			parse_option_novalue(has_value, option, g_option_benchmark_resampler);
+		} else if(option == "--design-resampler") {
+			parse_option_novalue(has_value, option, g_option_design_resampler);
 		} else if(option == "--test-hardware") {
 			parse_option_novalue(has_value, option, g_option_test_hardware);
 		} else if(option == "--trace-loopback") {
@@ -223,9 +387,9 @@ void parse_options(int argc, char *argv[]) {
 		} else if(option == "--format-out") {
 			parse_option_sample_format(has_value, option, value, g_option_format_out);
 		} else if(option == "--channels-in") {
-			parse_option_value(has_value, option, value, g_option_channels_in, (uint32_t) 1, (uint32_t) 100);
+			parse_option_value(has_value, option, value, g_option_channels_in, (uint32_t) 1, (uint32_t) 256);
 		} else if(option == "--channels-out") {
-			parse_option_value(has_value, option, value, g_option_channels_out, (uint32_t) 1, (uint32_t) 100);
+			parse_option_value(has_value, option, value, g_option_channels_out, (uint32_t) 1, (uint32_t) 256);
 		} else if(option == "--rate-in") {
 			parse_option_value(has_value, option, value, g_option_rate_in, (uint32_t) 1, (uint32_t) 1000000);
 		} else if(option == "--rate-out") {
@@ -238,6 +402,8 @@ void parse_options(int argc, char *argv[]) {
 			parse_option_value(has_value, option, value, g_option_buffer_in, (uint32_t) 1, (uint32_t) 1000000);
 		} else if(option == "--buffer-out") {
 			parse_option_value(has_value, option, value, g_option_buffer_out, (uint32_t) 1, (uint32_t) 1000000);
+		} else if(option == "--mmap") {
+			parse_option_bool(has_value, option, value, g_option_mmap);
 		} else if(option == "--target-level") {
 			parse_option_value(has_value, option, value, g_option_target_level, (uint32_t) 1, (uint32_t) 1000000);
 		} else if(option == "--wakeup-mode") {
@@ -254,6 +420,12 @@ void parse_options(int argc, char *argv[]) {
 			parse_option_value(has_value, option, value, g_option_initial_drift, -0.1f, 0.1f);
 		} else if(option == "--max-drift") {
 			parse_option_value(has_value, option, value, g_option_max_drift, 0.0f, 0.1f);
+		} else if(option == "--rate-switch") {
+			parse_option_bool(has_value, option, value, g_option_rate_switch);
+		} else if(option == "--max-latency") {
+			parse_option_value(has_value, option, value, g_option_max_latency, 0.0f, 10000.0f);
+		} else if(option == "--max-cpu") {
+			parse_option_value(has_value, option, value, g_option_max_cpu, 0.0f, 1000000.0f);
 		} else if(option == "--resampler-passband") {
 			parse_option_value(has_value, option, value, g_option_resampler_passband, lowrider_resampler::PASSBAND_MIN, lowrider_resampler::PASSBAND_MAX);
 		} else if(option == "--resampler-stopband") {
@@ -262,6 +434,25 @@ void parse_options(int argc, char *argv[]) {
 			parse_option_value(has_value, option, value, g_option_resampler_beta, lowrider_resampler::BETA_MIN, lowrider_resampler::BETA_MAX);
 		} else if(option == "--resampler-gain") {
 			parse_option_value(has_value, option, value, g_option_resampler_gain, 0.0f, 1000000.0f);
+		} else if(option == "--resampler-interpolation") {
+			parse_option_resampler_interpolation(has_value, option, value, g_option_resampler_interpolation);
+		} else if(option == "--resampler-phase") {
+			parse_option_resampler_phase(has_value, option, value, g_option_resampler_phase);
+		} else if(option == "--resampler-engine") {
+			parse_option_resampler_engine(has_value, option, value, g_option_resampler_engine);
+		} else if(option == "--resampler-farrow-taps") {
+			parse_option_value(has_value, option, value, g_option_resampler_farrow_taps, lowrider_farrow::TAPS_MIN, lowrider_farrow::TAPS_MAX);
+			if(g_option_resampler_farrow_taps % 2 != 0) {
+				throw std::runtime_error(make_string("invalid value '", value, "' for option '", option, "', must be even"));
+			}
+		} else if(option == "--resampler-multistage") {
+			parse_option_bool(has_value, option, value, g_option_resampler_multistage);
+		} else if(option == "--resampler-fixed-point") {
+			parse_option_bool(has_value, option, value, g_option_resampler_fixed_point);
+		} else if(option == "--resampler-storage") {
+			parse_option_resampler_storage(has_value, option, value, g_option_resampler_storage);
+		} else if(option == "--resampler-cache") {
+			parse_option_bool(has_value, option, value, g_option_resampler_cache);
 		} else {
 			throw std::runtime_error(make_string("invalid command-line option '", arg, "'"));
 		}
@@ -269,7 +460,8 @@ void parse_options(int argc, char *argv[]) {
 	}
 
 	// check for incompatible options
-	if((uint32_t) g_option_help + (uint32_t) g_option_version + (uint32_t) g_option_analyze_resampler + (uint32_t) g_option_test_hardware > 1) {
+	if((uint32_t) g_option_help + (uint32_t) g_option_version + (uint32_t) g_option_analyze_resampler + (uint32_t) g_option_benchmark_resampler +
+			(uint32_t) g_option_design_resampler + (uint32_t) g_option_test_hardware > 1) {
 		std::ostringstream ss;
 		ss << "incompatible options:";
 		if(g_option_help)
@@ -278,13 +470,17 @@ void parse_options(int argc, char *argv[]) {
 			ss << " --version";
 		if(g_option_analyze_resampler)
 			ss << " --analyze-resampler";
+		if(g_option_benchmark_resampler)
+			ss << " --benchmark-resampler";
+		if(g_option_design_resampler)
+			ss << " --design-resampler";
 		if(g_option_test_hardware)
 			ss << " --test-hardware";
 		throw std::runtime_error(ss.str());
 	}
 
 	// check for missing options
-	if(!g_option_help && !g_option_version && !g_option_analyze_resampler) {
+	if(!g_option_help && !g_option_version && !g_option_analyze_resampler && !g_option_benchmark_resampler && !g_option_design_resampler) {
 		if(g_option_device_in.empty()) {
 			throw std::runtime_error("missing option: --device-in");
 		}
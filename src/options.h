@@ -19,6 +19,7 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "resampler_types.h"
 #include "sample_format.h"
 
 #include <cstdint>
@@ -30,11 +31,20 @@ enum lowrider_wakeup_mode {
 	lowrider_wakeup_mode_wait,
 };
 
+enum lowrider_analyze_method {
+	lowrider_analyze_method_tones,
+	lowrider_analyze_method_chirp,
+};
+
 extern bool g_option_help;
 extern bool g_option_version;
 extern bool g_option_analyze_resampler;
+extern bool g_option_benchmark_resampler;
+extern bool g_option_design_resampler;
 extern bool g_option_test_hardware;
 
+extern lowrider_analyze_method g_option_analyze_method;
+
 extern bool g_option_trace_loopback;
 
 extern std::string g_option_device_in;
@@ -49,6 +59,7 @@ extern uint32_t g_option_period_in;
 extern uint32_t g_option_period_out;
 extern uint32_t g_option_buffer_in;
 extern uint32_t g_option_buffer_out;
+extern bool g_option_mmap;
 
 extern uint32_t g_option_target_level;
 
@@ -61,11 +72,23 @@ extern bool g_option_memory_lock;
 extern float g_option_loop_bandwidth;
 extern float g_option_initial_drift;
 extern float g_option_max_drift;
+extern bool g_option_rate_switch;
+
+extern float g_option_max_latency;
+extern float g_option_max_cpu;
 
 extern float g_option_resampler_passband;
 extern float g_option_resampler_stopband;
 extern float g_option_resampler_beta;
 extern float g_option_resampler_gain;
+extern lowrider_resampler_interpolation g_option_resampler_interpolation;
+extern lowrider_resampler_phase g_option_resampler_phase;
+extern lowrider_resampler_engine g_option_resampler_engine;
+extern uint32_t g_option_resampler_farrow_taps;
+extern bool g_option_resampler_multistage;
+extern bool g_option_resampler_fixed_point;
+extern lowrider_resampler_storage g_option_resampler_storage;
+extern bool g_option_resampler_cache;
 
 void print_help();
 void print_version();
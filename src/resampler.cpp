@@ -20,66 +20,449 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 #include "resampler.h"
 
 #include "bessel.h"
+#include "fft.h"
+#include "filter_bank_cache.h"
 #include "miscmath.h"
+#include "resampler_kernels.h"
 
 #include <cassert>
 #include <cmath>
 
 #include <algorithm>
+#include <complex>
+#include <limits>
+#include <system_error>
+#include <thread>
+#include <vector>
 
-inline double sinc(double x) {
-	return (std::abs(x) < 1.0e-9)? 1.0 : std::sin(x * (double) M_PI) / (x * (double) M_PI);
-}
+static_assert(lowrider_resampler::INTERLEAVED_ALIGN % lowrider_resampler_kernels::INTERLEAVED_ALIGN == 0, "incompatible alignment");
 
-inline double kaiser(double x, double beta) {
-	return bessel_i0(beta * std::sqrt(std::max(0.0, 1.0 - sqr(x)))) / bessel_i0(beta);
-}
+lowrider_resampler::lowrider_resampler(float ratio, float passband, float stopband, float beta, float gain,
+									   lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, const std::string &cache_dir,
+									   bool skip_embedded) {
+	assert(std::isfinite(ratio) && ratio >= RATIO_MIN && ratio <= RATIO_MAX);
+	assert(interpolation != lowrider_resampler_interpolation_none);
 
-static void firfilter(uint32_t channels, uint32_t filter_length,
-					  const float *coef1, const float *coef2, float frac,
-					  const float * const *data_in, uint32_t pos_in, float * const *data_out, uint32_t pos_out) {
-	assert(filter_length % 4 == 0);
-	for(uint32_t c = 0; c < channels; ++c) {
-		const float *data = data_in[c] + pos_in;
-		float sum = 0.0f;
-		for(uint32_t i = 0; i < filter_length / 4 * 4; ++i) {
-			float coef = coef1[i] + (coef2[i] - coef1[i]) * frac;
-			sum += data[i] * coef;
-		}
-		data_out[c][pos_out] = sum;
-	}
+	m_ratio = rint64((float) RATIO_ONE * ratio);
+	m_ratio_one = RATIO_ONE;
+	m_offset = 0;
+	m_rational_step = 0;
+	m_rational_offset_step = 0;
+	m_interpolation = interpolation;
+
+	// The interpolation error is proportional to 1/rows^2 for linear interpolation and 1/rows^4 for cubic interpolation.
+	float sinc_freq = (passband + stopband) / std::max(1.0f, ratio);
+	float base_rows = (interpolation == lowrider_resampler_interpolation_cubic)?
+					  clamp(2.0f * std::exp(0.25f * beta), 4.0f, 256.0f) :
+					  clamp(3.0f * std::exp(0.5f * beta), 16.0f, 4096.0f);
+	m_filter_rows = (uint32_t) std::ceil(clamp(base_rows * sinc_freq, 1.0f, 16384.0f));
+
+	initialize(ratio, passband, stopband, beta, gain, phase, cache_dir, skip_embedded);
 }
 
-lowrider_resampler::lowrider_resampler(float ratio, float passband, float stopband, float beta, float gain) {
+lowrider_resampler::lowrider_resampler(uint32_t rate_in, uint32_t rate_out, float passband, float stopband, float beta, float gain,
+									   lowrider_resampler_phase phase, const std::string &cache_dir) {
+	assert(rate_in != 0 && rate_out != 0);
+
+	// The ratio is reduced to rate_in / rate_out = steps / phases. There is one row for every phase, so no interpolation
+	// is needed. The offset is the current phase, and advances by the number of steps for every output sample.
+	uint32_t phases = get_rational_phases(rate_in, rate_out);
+	uint32_t steps = (uint32_t) ((uint64_t) rate_in * phases / rate_out);
+	assert(phases <= RATIONAL_PHASES_MAX);
+	float ratio = (float) rate_in / (float) rate_out;
 	assert(std::isfinite(ratio) && ratio >= RATIO_MIN && ratio <= RATIO_MAX);
+
+	m_ratio = steps;
+	m_ratio_one = phases;
+	m_rational_step = steps / phases;
+	m_rational_offset_step = steps % phases;
+	m_offset = 0;
+	m_interpolation = lowrider_resampler_interpolation_none;
+	m_filter_rows = phases;
+
+	initialize(ratio, passband, stopband, beta, gain, phase, cache_dir, false);
+}
+
+void lowrider_resampler::initialize(float ratio, float passband, float stopband, float beta, float gain,
+									lowrider_resampler_phase phase, const std::string &cache_dir, bool skip_embedded) {
 	assert(std::isfinite(passband) && passband >= PASSBAND_MIN && passband <= PASSBAND_MAX);
 	assert(std::isfinite(stopband) && stopband >= STOPBAND_MIN && stopband <= STOPBAND_MAX);
 	assert(std::isfinite(beta) && beta >= BETA_MIN && beta <= BETA_MAX);
 
-	m_ratio = rint64((float) RATIO_ONE * ratio);
-	m_offset = 0;
+	m_phase = phase;
+	m_fixed_point_shift_s16 = -1;
+	m_fixed_point_shift_s32 = -1;
+	m_kernels = &get_resampler_kernels();
 
-	// calculate the filter bank size
-	float sinc_lobes = std::max(2.0f, beta / ((float) M_PI * 0.5f * (stopband - passband)));
+	// calculate the filter length
 	float sinc_freq = (passband + stopband) / std::max(1.0f, ratio);
-	float base_rows = clamp(3.0f * std::exp(0.5f * beta), 16.0f, 4096.0f);
-	m_filter_length = (uint32_t) std::ceil(clamp(sinc_lobes / sinc_freq * 0.25f, 1.0f, 4096.0f)) * 4;
-	m_filter_rows = (uint32_t) std::ceil(clamp(base_rows * sinc_freq, 1.0f, 16384.0f));
+	m_filter_length = calculate_filter_length(ratio, passband, stopband, beta);
+
+	// Linear interpolation uses rows 0 to m_filter_rows, cubic interpolation needs one extra row on each side.
+	// For linear phase filters, row j is the mirror image of row m_filter_rows - j, so only the first half of the rows is
+	// stored. Filters that start at a row below m_bank_split are read from the stored rows, the others are read backwards
+	// from the mirrored rows. Minimum phase filters are not symmetric, so all rows are stored. Stored row k corresponds to
+	// row k - m_row_extra.
+	m_row_extra = (m_interpolation == lowrider_resampler_interpolation_cubic)? 1 : 0;
+	m_bank_split = (phase == lowrider_resampler_phase_linear)? (m_filter_rows + 1) / 2 : m_filter_rows;
+	m_bank_rows = m_bank_split + 2 * m_row_extra + 1;
+	m_sinc_freq = sinc_freq;
+	m_beta = beta;
+	m_gain = gain;
+
+	// allocate memory
+	m_coef_temp.allocate(INTERLEAVED_ALIGN, (m_filter_length + INTERLEAVED_ALIGN - 1) / INTERLEAVED_ALIGN * INTERLEAVED_ALIGN);
+
+	// use an embedded filter bank or load the filter bank from the cache if possible, otherwise generate it and add it to the cache
+	lowrider_filter_bank_key key = get_filter_bank_key();
+	size_t bank_size = (size_t) m_bank_rows * (size_t) m_filter_length;
+	m_filter_bank = (skip_embedded)? nullptr : find_embedded_filter_bank(key, bank_size);
+	if(m_filter_bank != nullptr) {
+		m_filter_bank_source = lowrider_filter_bank_source_embedded;
+	} else if(m_filter_bank_file.load(cache_dir, key, bank_size)) {
+		m_filter_bank = m_filter_bank_file.data();
+		m_filter_bank_source = lowrider_filter_bank_source_cache;
+	} else {
+		m_filter_bank_memory.allocate(4, bank_size);
+		m_filter_bank = m_filter_bank_memory.data();
+		m_filter_bank_source = lowrider_filter_bank_source_generated;
+		generate_filter_bank();
+		store_filter_bank(cache_dir, key, m_filter_bank, bank_size);
+	}
+	m_storage = lowrider_resampler_storage_f32;
+	m_filter_bank_storage = m_filter_bank;
+	m_storage_element_size = sizeof(float);
 
-	// allocate filter bank
-	m_filter_bank.allocate(4, (m_filter_rows + 1) * m_filter_length);
+	// The delay of a linear phase filter is exactly half the filter length. The delay of a minimum phase filter is
+	// estimated as the centroid of row 0, which is equal to the group delay at DC.
+	m_filter_delay = (float) (m_filter_length / 2);
+	if(m_phase == lowrider_resampler_phase_minimum) {
+		const float *coef = m_filter_bank + m_row_extra * m_filter_length;
+		double sum = 0.0, moment = 0.0;
+		for(uint32_t i = 0; i < m_filter_length; ++i) {
+			sum += (double) coef[i];
+			moment += (double) coef[i] * (double) (i + 1);
+		}
+		if(sum > 0.0) {
+			m_filter_delay = (float) clamp(moment / sum, 1.0, (double) m_filter_length);
+		}
+	}
+
+}
+
+void lowrider_resampler::generate_filter_bank() {
+
+	// minimum phase filters are calculated from the spectrum of the filter
+	std::vector<std::complex<double>> spectrum;
+	if(m_phase == lowrider_resampler_phase_minimum) {
+		design_filter_spectrum(spectrum);
+	}
+	const std::complex<double> *spectrum_data = (spectrum.empty())? nullptr : spectrum.data();
+	size_t spectrum_size = spectrum.size();
+
+	// Large filter banks are split across multiple threads. If a thread can't be started, its rows are generated
+	// by the current thread instead.
+	uint32_t threads = clamp(std::thread::hardware_concurrency(), 1u, m_bank_rows / GENERATE_THREAD_ROWS_MIN + 1);
+	if(m_bank_rows * m_filter_length < GENERATE_THREAD_COEFFICIENTS_MIN) {
+		threads = 1;
+	}
+	std::vector<std::thread> workers;
+	for(uint32_t t = 1; t < threads; ++t) {
+		uint32_t row_begin = m_bank_rows * t / threads, row_end = m_bank_rows * (t + 1) / threads;
+		try {
+			workers.emplace_back(&lowrider_resampler::generate_filter_rows, this, row_begin, row_end, spectrum_data, spectrum_size);
+		} catch(const std::system_error&) {
+			generate_filter_rows(row_begin, row_end, spectrum_data, spectrum_size);
+		}
+	}
+	generate_filter_rows(0, m_bank_rows / threads, spectrum_data, spectrum_size);
+	for(std::thread &worker : workers) {
+		worker.join();
+	}
 
-	// generate filters
+}
+
+void lowrider_resampler::generate_filter_rows(uint32_t row_begin, uint32_t row_end, const std::complex<double> *spectrum, size_t spectrum_size) {
+	if(spectrum != nullptr) {
+		generate_filter_rows_spectrum(row_begin, row_end, spectrum, spectrum_size);
+		return;
+	}
+
+	// The sinc function is calculated with the angle sum identity, starting from one exact sin/cos evaluation per
+	// block of taps, so no errors accumulate.
 	double window_scale = 1.0f / (double) (m_filter_length / 2);
-	for(unsigned int j = 0; j <= m_filter_rows; ++j) {
-		float *coef = m_filter_bank.data() + j * m_filter_length;
-		double shift = 1.0f - (double) j / (double) m_filter_rows - (double) (m_filter_length / 2);
-		for(unsigned int i = 0; i < m_filter_length; ++i) {
-			double x = (double) i + shift;
-			coef[i] = kaiser(x * window_scale, (double) beta) * sinc(x * (double) sinc_freq) * (double) sinc_freq * (double) gain;
+	double window_norm = bessel_i0((double) m_beta);
+	double phase_step = (double) m_sinc_freq * (double) M_PI;
+	double block_sin[GENERATE_SINC_BLOCK], block_cos[GENERATE_SINC_BLOCK];
+	for(uint32_t k = 0; k < GENERATE_SINC_BLOCK; ++k) {
+		block_sin[k] = std::sin((double) k * phase_step);
+		block_cos[k] = std::cos((double) k * phase_step);
+	}
+
+	std::vector<double> x(m_filter_length), window(m_filter_length);
+	for(uint32_t j = row_begin; j < row_end; ++j) {
+		int32_t row = (int32_t) j - (int32_t) m_row_extra;
+		float *coef = m_filter_bank_memory.data() + j * m_filter_length;
+		double shift = 1.0f - (double) row / (double) m_filter_rows - (double) (m_filter_length / 2);
+
+		// calculate the window
+		for(uint32_t i = 0; i < m_filter_length; ++i) {
+			x[i] = (double) i + shift;
+			window[i] = (double) m_beta * std::sqrt(std::max(0.0, 1.0 - sqr(x[i] * window_scale)));
+		}
+		bessel_i0(window.data(), window.data(), m_filter_length);
+
+		// calculate the filter
+		for(uint32_t b = 0; b < m_filter_length; b += GENERATE_SINC_BLOCK) {
+			uint32_t n = std::min((uint32_t) GENERATE_SINC_BLOCK, m_filter_length - b);
+			double phase = x[b] * (double) m_sinc_freq * (double) M_PI;
+			double s = std::sin(phase), c = std::cos(phase);
+			for(uint32_t k = 0; k < n; ++k) {
+				double y = x[b + k] * (double) m_sinc_freq;
+				double sinc = (std::abs(y) < 1.0e-9)? 1.0 : (s * block_cos[k] + c * block_sin[k]) / (y * (double) M_PI);
+				coef[b + k] = window[b + k] / window_norm * sinc * (double) m_sinc_freq * (double) m_gain;
+			}
+		}
+
+	}
+
+}
+
+void lowrider_resampler::design_filter_spectrum(std::vector<std::complex<double>> &spectrum) {
+
+	// The filter is designed with the homomorphic method. The linear phase prototype is sampled with a resolution of
+	// GENERATE_PHASE_OVERSAMPLING samples per input sample. The real cepstrum of the prototype is folded onto the positive
+	// quefrencies, which results in a minimum phase filter with the same magnitude response. A large FFT is used to keep
+	// the aliasing of the cepstrum small. The prototype must be heavily oversampled, otherwise the minimum phase filter
+	// is not accurate enough (with 4x oversampling, the error is only about 85 dB below the signal).
+	uint32_t half_length = m_filter_length / 2 * GENERATE_PHASE_OVERSAMPLING;
+	size_t size = 1;
+	while(size < (size_t) half_length * 2 * GENERATE_PHASE_FFT_FACTOR) {
+		size *= 2;
+	}
+	lowrider_fft fft(size);
+	spectrum.assign(size, 0.0);
+
+	// calculate the spectrum of the zero phase prototype
+	double window_scale = 1.0 / (double) (m_filter_length / 2);
+	for(int32_t m = -(int32_t) half_length; m <= (int32_t) half_length; ++m) {
+		double x = (double) m / (double) GENERATE_PHASE_OVERSAMPLING;
+		double value = kaiser(x * window_scale, (double) m_beta) * sinc(x * (double) m_sinc_freq) * (double) m_sinc_freq * (double) m_gain;
+		spectrum[(size_t) (m + (int32_t) size) % size] = value;
+	}
+	fft.forward(spectrum.data());
+
+	// calculate the real cepstrum
+	double peak = 0.0;
+	for(size_t k = 0; k < size; ++k) {
+		peak = std::max(peak, std::abs(spectrum[k]));
+	}
+	if(peak == 0.0)
+		return;
+	double floor = peak * GENERATE_PHASE_FLOOR;
+	for(size_t k = 0; k < size; ++k) {
+		spectrum[k] = std::log(std::max(std::abs(spectrum[k]), floor));
+	}
+	fft.inverse(spectrum.data());
+
+	// fold the cepstrum
+	for(size_t n = 0; n < size; ++n) {
+		double c = spectrum[n].real() / (double) size;
+		spectrum[n] = (n == 0 || n == size / 2)? c : (n < size / 2)? 2.0 * c : 0.0;
+	}
+	fft.forward(spectrum.data());
+	for(size_t k = 0; k < size; ++k) {
+		spectrum[k] = std::exp(spectrum[k]);
+	}
+
+}
+
+void lowrider_resampler::calculate_phase_ramp(double phase_step, size_t size, std::complex<double> *ramp) {
+	// Calculates exp(i * phase_step * k) for frequency k of an FFT, i.e. k = n for n < size / 2 and k = n - size otherwise.
+	// Like the sinc function, this is calculated with one exact evaluation per block.
+	std::complex<double> block[GENERATE_SINC_BLOCK];
+	for(uint32_t q = 0; q < GENERATE_SINC_BLOCK; ++q) {
+		block[q] = std::polar(1.0, phase_step * (double) q);
+	}
+	for(size_t b = 0; b < size; b += GENERATE_SINC_BLOCK) {
+		size_t n = std::min((size_t) GENERATE_SINC_BLOCK, size - b);
+		int64_t k = (b < size / 2)? (int64_t) b : (int64_t) b - (int64_t) size;
+		std::complex<double> start = std::polar(1.0, phase_step * (double) k);
+		for(size_t q = 0; q < n; ++q) {
+			ramp[b + q] = start * block[q];
+		}
+	}
+}
+
+void lowrider_resampler::generate_filter_rows_spectrum(uint32_t row_begin, uint32_t row_end, const std::complex<double> *spectrum, size_t spectrum_size) {
+
+	// Each row is a delayed version of the filter, which is calculated by applying a phase ramp to the spectrum. Only
+	// every GENERATE_PHASE_OVERSAMPLING'th sample of the result is needed, so the spectrum is folded first, which reduces
+	// the size of the inverse FFT.
+	size_t fold_size = spectrum_size / GENERATE_PHASE_OVERSAMPLING;
+	lowrider_fft fft(fold_size);
+	std::vector<std::complex<double>> ramp(spectrum_size), fold(fold_size);
+	for(uint32_t j = row_begin; j < row_end; ++j) {
+		int32_t row = (int32_t) j - (int32_t) m_row_extra;
+		float *coef = m_filter_bank_memory.data() + j * m_filter_length;
+		double shift = (1.0 - (double) row / (double) m_filter_rows) * (double) GENERATE_PHASE_OVERSAMPLING;
+		calculate_phase_ramp(2.0 * M_PI * shift / (double) spectrum_size, spectrum_size, ramp.data());
+		std::fill(fold.begin(), fold.end(), 0.0);
+		for(size_t k = 0; k < spectrum_size; ++k) {
+			fold[k % fold_size] += spectrum[k] * ramp[k];
+		}
+		fft.inverse(fold.data());
+		for(uint32_t i = 0; i < m_filter_length; ++i) {
+			coef[i] = fold[i].real() / (double) spectrum_size;
+		}
+	}
+
+}
+
+void lowrider_resampler::generate_filter_row_reference(int32_t row, float *coef, const std::complex<double> *spectrum, size_t spectrum_size) {
+	if(spectrum != nullptr) {
+		std::vector<std::complex<double>> ramp(spectrum_size);
+		for(uint32_t i = 0; i < m_filter_length; ++i) {
+			double x = ((double) (i + 1) - (double) row / (double) m_filter_rows) * (double) GENERATE_PHASE_OVERSAMPLING;
+			calculate_phase_ramp(2.0 * M_PI * x / (double) spectrum_size, spectrum_size, ramp.data());
+			double sum = 0.0;
+			for(size_t k = 0; k < spectrum_size; ++k) {
+				sum += (spectrum[k] * ramp[k]).real();
+			}
+			coef[i] = sum / (double) spectrum_size;
+		}
+		return;
+	}
+	double window_scale = 1.0f / (double) (m_filter_length / 2);
+	double shift = 1.0f - (double) row / (double) m_filter_rows - (double) (m_filter_length / 2);
+	for(unsigned int i = 0; i < m_filter_length; ++i) {
+		double x = (double) i + shift;
+		coef[i] = kaiser(x * window_scale, (double) m_beta) * sinc(x * (double) m_sinc_freq) * (double) m_sinc_freq * (double) m_gain;
+	}
+}
+
+inline uint32_t lowrider_resampler::advance() {
+	if(m_interpolation == lowrider_resampler_interpolation_none) {
+		uint32_t new_offset = m_offset + m_rational_offset_step;
+		bool wrap = (new_offset >= m_ratio_one);
+		m_offset = (wrap)? new_offset - (uint32_t) m_ratio_one : new_offset;
+		return m_rational_step + (uint32_t) wrap;
+	} else {
+		uint64_t new_offset = (uint64_t) m_offset + m_ratio;
+		m_offset = (uint32_t) new_offset;
+		return (uint32_t) (new_offset >> 32);
+	}
+}
+
+inline uint32_t lowrider_resampler::select_row(float *weights) {
+	uint64_t sel = (uint64_t) m_offset * m_filter_rows;
+	uint32_t row = (uint32_t) (sel >> 32);
+	float frac = (float) (uint32_t) sel * (1.0f / (float) RATIO_ONE);
+	switch(m_interpolation) {
+		case lowrider_resampler_interpolation_none: {
+			// the offset is the phase, which is also the row
+			row = m_offset;
+			break;
+		}
+		case lowrider_resampler_interpolation_linear: {
+			weights[0] = frac;
+			break;
+		}
+		case lowrider_resampler_interpolation_cubic: {
+			// 4-point Lagrange interpolation, the rows are located at -1, 0, 1 and 2
+			float fm1 = frac - 1.0f, fm2 = frac - 2.0f, fp1 = frac + 1.0f;
+			weights[0] = -(1.0f / 6.0f) * frac * fm1 * fm2;
+			weights[1] = 0.5f * fp1 * fm1 * fm2;
+			weights[2] = -0.5f * fp1 * frac * fm2;
+			weights[3] = (1.0f / 6.0f) * fp1 * frac * fm1;
+			break;
+		}
+	}
+	return row;
+}
+
+inline const void* lowrider_resampler::select_filter(float *weights, bool *reverse) {
+	uint32_t row = select_row(weights);
+	// The first row used by the filter is row - m_row_extra, which is stored row 'row'. Mirrored filters are read
+	// backwards starting from the end of stored row m_filter_rows - row + 2 * m_row_extra.
+	*reverse = (row >= m_bank_split);
+	size_t index = (*reverse)? (size_t) (m_filter_rows - row + 2 * m_row_extra + 1) * m_filter_length - 1 : (size_t) row * m_filter_length;
+	return (const char*) m_filter_bank_storage + index * m_storage_element_size;
+}
+
+void lowrider_resampler::get_filter_row(uint32_t row, float *coef) {
+	if(row < m_bank_rows) {
+		std::copy_n(m_filter_bank + (size_t) row * m_filter_length, m_filter_length, coef);
+	} else {
+		const float *mirror = m_filter_bank + (size_t) (m_filter_rows - row + 2 * m_row_extra) * m_filter_length;
+		std::reverse_copy(mirror, mirror + m_filter_length, coef);
+	}
+}
+
+template<typename T, typename A>
+int32_t lowrider_resampler::quantize_filter_bank(lowrider_aligned_memory<T> &bank) {
+
+	// get the full filter bank
+	uint32_t rows = m_filter_rows + 2 * m_row_extra + 1;
+	std::vector<float> coef((size_t) rows * m_filter_length);
+	for(uint32_t row = 0; row < rows; ++row) {
+		get_filter_row(row, coef.data() + (size_t) row * m_filter_length);
+	}
+
+	// Use as many fractional bits as possible without overflowing the accumulator. The worst case input has the largest
+	// possible magnitude and the same sign as the coefficients, so the sum of the absolute values of the coefficients
+	// of every row is checked (after rounding).
+	double sample_max = -(double) std::numeric_limits<T>::min();
+	double acc_max = (double) std::numeric_limits<A>::max();
+	bank.allocate(4, (size_t) rows * m_filter_length);
+	int32_t shift = std::numeric_limits<T>::digits;
+	for( ; ; --shift) {
+		double scale = std::ldexp(1.0, shift), max_sum = 0.0;
+		bool fits = true;
+		for(uint32_t row = 0; row < rows; ++row) {
+			double sum = 0.0;
+			for(uint32_t i = 0; i < m_filter_length; ++i) {
+				double value = std::round((double) coef[(size_t) row * m_filter_length + i] * scale);
+				fits = fits && std::abs(value) <= (double) std::numeric_limits<T>::max();
+				sum += std::abs(value);
+			}
+			max_sum = std::max(max_sum, sum);
 		}
+		if(shift == 0 || (fits && max_sum * sample_max < acc_max))
+			break;
 	}
 
+	// quantize the coefficients
+	double scale = std::ldexp(1.0, shift);
+	for(size_t i = 0; i < (size_t) rows * m_filter_length; ++i) {
+		bank.data()[i] = (T) clamp(std::round((double) coef[i] * scale),
+								   (double) std::numeric_limits<T>::min(), (double) std::numeric_limits<T>::max());
+	}
+
+	return shift;
+}
+
+template<typename T, typename F>
+std::pair<uint32_t, uint32_t> lowrider_resampler::resample_fixed_point(F firfilter, const T *filter_bank, int32_t shift, uint32_t channels,
+																	   const T * const *data_in, uint32_t size_in, T * const *data_out, uint32_t size_out) {
+	assert(filter_bank != nullptr);
+	float scale = std::ldexp(1.0f, -shift);
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + m_filter_length <= size_in && pos_out < size_out) {
+
+		// select the required filter, all rows are stored
+		float weights[4];
+		uint32_t row = select_row(weights);
+
+		// calculate the next sample
+		firfilter(channels, m_filter_length, filter_bank + (size_t) row * m_filter_length, weights, scale, data_in, pos_in, data_out, pos_out);
+
+		// increase the position
+		pos_in += advance();
+		++pos_out;
+
+	}
+	return std::make_pair(pos_in, pos_out);
 }
 
 void lowrider_resampler::reset() {
@@ -88,58 +471,251 @@ void lowrider_resampler::reset() {
 
 std::pair<uint32_t, uint32_t> lowrider_resampler::resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
 												  float * const *data_out, uint32_t size_out) {
-	float frac_scale = 1.0f / (float) RATIO_ONE;
+	lowrider_firfilter_func firfilter = m_kernels->firfilter[m_storage][m_interpolation][(channels <= lowrider_resampler_kernels::FIRFILTER_CHANNELS_MAX)? channels : 0];
 	uint32_t pos_in = 0, pos_out = 0;
 	while(pos_in + m_filter_length <= size_in && pos_out < size_out) {
 
 		// select the required filter
-		uint64_t sel = (uint64_t) m_offset * m_filter_rows;
-		uint32_t row = (uint32_t) (sel >> 32);
-		float *coef1 = m_filter_bank.data() + row * m_filter_length;
-		float *coef2 = coef1 + m_filter_length;
-		float frac = (float) (uint32_t) sel * frac_scale;
+		float weights[4];
+		bool reverse;
+		const void *coef = select_filter(weights, &reverse);
 
 		// calculate the next sample
-		firfilter(channels, m_filter_length, coef1, coef2, frac, data_in, pos_in, data_out, pos_out);
+		firfilter(channels, m_filter_length, coef, weights, reverse, data_in, pos_in, data_out, pos_out);
 
 		// increase the position
-		uint64_t new_offset = (uint64_t) m_offset + m_ratio;
-		m_offset = (uint32_t) new_offset;
-		pos_in += (uint32_t) (new_offset >> 32);
+		pos_in += advance();
+		++pos_out;
+
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler::resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+																	  float *data_out, uint32_t size_out) {
+	assert(stride % INTERLEAVED_ALIGN == 0);
+	lowrider_firfilter_interleaved_func firfilter = m_kernels->firfilter_interleaved[m_storage][m_interpolation];
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + m_filter_length <= size_in && pos_out < size_out) {
+
+		// select the required filter
+		float weights[4];
+		bool reverse;
+		const void *coef = select_filter(weights, &reverse);
+
+		// calculate the next frame
+		firfilter(stride, m_filter_length, coef, weights, reverse, m_coef_temp.data(),
+				  data_in + (size_t) pos_in * stride, data_out + (size_t) pos_out * stride);
+
+		// increase the position
+		pos_in += advance();
 		++pos_out;
 
 	}
 	return std::make_pair(pos_in, pos_out);
 }
 
+std::pair<uint32_t, uint32_t> lowrider_resampler::resample_device(uint32_t channels, const float * const *data_in, uint32_t size_in,
+																 lowrider_sample_format format, void *data_out, uint32_t size_out) {
+	assert(m_storage == lowrider_resampler_storage_f32);
+	lowrider_firfilter_device_func firfilter = m_kernels->firfilter_device[format][m_interpolation][(channels <= lowrider_resampler_kernels::FIRFILTER_CHANNELS_MAX)? channels : 0];
+	size_t frame_size = (size_t) channels * get_sample_format_bytes(format);
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + m_filter_length <= size_in && pos_out < size_out) {
+
+		// select the required filter
+		float weights[4];
+		bool reverse;
+		const void *coef = select_filter(weights, &reverse);
+
+		// calculate and convert the next frame
+		firfilter(channels, m_filter_length, coef, weights, reverse, data_in, pos_in, (uint8_t*) data_out + (size_t) pos_out * frame_size);
+
+		// increase the position
+		pos_in += advance();
+		++pos_out;
+
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+void lowrider_resampler::prepare_fixed_point(lowrider_resampler_fixed_point type) {
+	switch(type) {
+		case lowrider_resampler_fixed_point_s16: {
+			if(m_fixed_point_shift_s16 < 0) {
+				m_fixed_point_shift_s16 = quantize_filter_bank<int16_t, int32_t>(m_filter_bank_s16);
+			}
+			break;
+		}
+		case lowrider_resampler_fixed_point_s32: {
+			if(m_fixed_point_shift_s32 < 0) {
+				m_fixed_point_shift_s32 = quantize_filter_bank<int32_t, int64_t>(m_filter_bank_s32);
+			}
+			break;
+		}
+	}
+}
+
+void lowrider_resampler::set_storage(lowrider_resampler_storage storage) {
+	size_t bank_size = (size_t) m_bank_rows * (size_t) m_filter_length;
+	switch(storage) {
+		case lowrider_resampler_storage_f32: {
+			m_filter_bank_half.free();
+			m_filter_bank_storage = m_filter_bank;
+			m_storage_element_size = sizeof(float);
+			break;
+		}
+		case lowrider_resampler_storage_f16:
+		case lowrider_resampler_storage_bf16: {
+			m_filter_bank_half.allocate(4, bank_size);
+			for(size_t i = 0; i < bank_size; ++i) {
+				m_filter_bank_half.data()[i] = (storage == lowrider_resampler_storage_f16)? float_to_f16(m_filter_bank[i]) : float_to_bf16(m_filter_bank[i]);
+			}
+			m_filter_bank_storage = m_filter_bank_half.data();
+			m_storage_element_size = sizeof(uint16_t);
+			break;
+		}
+	}
+	m_storage = storage;
+}
+
+lowrider_resampler_storage lowrider_resampler::get_storage() {
+	return m_storage;
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler::resample(uint32_t channels, const int16_t * const *data_in, uint32_t size_in,
+														   int16_t * const *data_out, uint32_t size_out) {
+	return resample_fixed_point(m_kernels->firfilter_s16[m_interpolation], m_filter_bank_s16.data(), m_fixed_point_shift_s16,
+								channels, data_in, size_in, data_out, size_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler::resample(uint32_t channels, const int32_t * const *data_in, uint32_t size_in,
+														   int32_t * const *data_out, uint32_t size_out) {
+	return resample_fixed_point(m_kernels->firfilter_s32[m_interpolation], m_filter_bank_s32.data(), m_fixed_point_shift_s32,
+								channels, data_in, size_in, data_out, size_out);
+}
+
 uint32_t lowrider_resampler::calculate_size_in(uint32_t size_out) {
-	return (uint32_t) (((uint64_t) m_offset + m_ratio * size_out) >> 32) + (m_filter_length - 1);
+	return (uint32_t) (((uint64_t) m_offset + m_ratio * size_out) / m_ratio_one) + (m_filter_length - 1);
 }
 
 uint32_t lowrider_resampler::calculate_size_out(uint32_t size_in) {
-	return (size_in < m_filter_length)? 0 : (((uint64_t) (size_in - (m_filter_length - 1)) << 32) - (uint64_t) m_offset - 1) / m_ratio + 1;
+	return (size_in < m_filter_length)? 0 : ((uint64_t) (size_in - (m_filter_length - 1)) * m_ratio_one - (uint64_t) m_offset - 1) / m_ratio + 1;
 }
 
 float lowrider_resampler::get_latency_in() {
-	return (float) (m_filter_length / 2 - 1) + (float) m_offset / (float) RATIO_ONE;
+	return m_filter_delay - 1.0f + (float) m_offset / (float) m_ratio_one;
 }
 
 float lowrider_resampler::get_latency_out() {
-	return get_latency_in() * (float) RATIO_ONE / (float) m_ratio;
+	return get_latency_in() * (float) m_ratio_one / (float) m_ratio;
 }
 
-float lowrider_resampler::get_ratio() {
-	return (float) m_ratio / (float) RATIO_ONE;
+double lowrider_resampler::get_ratio() {
+	return (double) m_ratio / (double) m_ratio_one;
 }
 
-void lowrider_resampler::set_ratio(float ratio) {
-	m_ratio = rint64((float) RATIO_ONE * ratio);
+void lowrider_resampler::set_ratio(double ratio) {
+	assert(m_interpolation != lowrider_resampler_interpolation_none);
+	m_ratio = rint64((double) RATIO_ONE * ratio);
 }
 
 uint32_t lowrider_resampler::get_filter_length() {
 	return m_filter_length;
 }
 
+int32_t lowrider_resampler::get_fixed_point_shift(lowrider_resampler_fixed_point type) {
+	return (type == lowrider_resampler_fixed_point_s16)? m_fixed_point_shift_s16 : m_fixed_point_shift_s32;
+}
+
 uint32_t lowrider_resampler::get_filter_rows() {
 	return m_filter_rows;
 }
+
+uint32_t lowrider_resampler::get_rational_phases(uint32_t rate_in, uint32_t rate_out) {
+	uint32_t a = rate_in, b = rate_out;
+	while(b != 0) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return rate_out / a;
+}
+
+uint32_t lowrider_resampler::calculate_filter_length(float ratio, float passband, float stopband, float beta) {
+	float sinc_lobes = std::max(2.0f, beta / ((float) M_PI * 0.5f * (stopband - passband)));
+	float sinc_freq = (passband + stopband) / std::max(1.0f, ratio);
+	return (uint32_t) std::ceil(clamp(sinc_lobes / sinc_freq * 0.25f, 1.0f, 4096.0f)) * 4;
+}
+
+lowrider_resampler_interpolation lowrider_resampler::get_interpolation() {
+	return m_interpolation;
+}
+
+lowrider_resampler_phase lowrider_resampler::get_phase() {
+	return m_phase;
+}
+
+float lowrider_resampler::get_filter_delay() {
+	return m_filter_delay;
+}
+
+lowrider_filter_bank_key lowrider_resampler::get_filter_bank_key() {
+	return {m_filter_length, m_filter_rows, m_bank_rows, m_row_extra, (uint32_t) m_phase, m_sinc_freq, m_beta, m_gain};
+}
+
+const float* lowrider_resampler::get_filter_bank() {
+	return m_filter_bank;
+}
+
+lowrider_filter_bank_source lowrider_resampler::get_filter_bank_source() {
+	return m_filter_bank_source;
+}
+
+size_t lowrider_resampler::get_filter_bank_size() {
+	return (size_t) m_bank_rows * (size_t) m_filter_length * sizeof(float);
+}
+
+size_t lowrider_resampler::get_filter_bank_storage_size() {
+	return (size_t) m_bank_rows * (size_t) m_filter_length * m_storage_element_size;
+}
+
+uint32_t lowrider_resampler::verify_filter_bank() {
+
+	// The reference for minimum phase filters is calculated from the spectrum without the FFT. This is very slow, so only
+	// a subset of the rows is checked.
+	std::vector<std::complex<double>> spectrum;
+	int32_t row_step = 1;
+	if(m_phase == lowrider_resampler_phase_minimum) {
+		design_filter_spectrum(spectrum);
+		row_step = (int32_t) std::max(1u, m_bank_rows / VERIFY_SPECTRUM_ROWS);
+	}
+	const std::complex<double> *spectrum_data = (spectrum.empty())? nullptr : spectrum.data();
+
+	// Coefficients close to the zero crossings of the sinc function are compared with the resolution of a coefficient that is
+	// 2^24 times smaller than the peak of the filter, since their relative error is meaningless.
+	std::vector<float> coef(m_filter_length);
+	float threshold = std::ldexp(m_sinc_freq * m_gain, -24);
+	uint32_t max_error = 0;
+	for(int32_t row = -(int32_t) m_row_extra; row <= (int32_t) (m_filter_rows + m_row_extra); row += row_step) {
+		generate_filter_row_reference(row, coef.data(), spectrum_data, spectrum.size());
+		uint32_t stored = (uint32_t) (row + (int32_t) m_row_extra);
+		for(uint32_t i = 0; i < m_filter_length; ++i) {
+			float value = (stored < m_bank_rows)? m_filter_bank[stored * m_filter_length + i] :
+						  m_filter_bank[(m_filter_rows - stored + 2 * m_row_extra) * m_filter_length + m_filter_length - 1 - i];
+			uint32_t error = (std::abs(coef[i]) >= threshold)? ulp_distance(value, coef[i]) :
+							 ulp_distance(threshold + std::abs(value - coef[i]), threshold);
+			max_error = std::max(max_error, error);
+		}
+	}
+	return max_error;
+}
+
+const char* get_resampler_storage_name(lowrider_resampler_storage storage) {
+	switch(storage) {
+		case lowrider_resampler_storage_f32: return "f32";
+		case lowrider_resampler_storage_f16: return "f16";
+		case lowrider_resampler_storage_bf16: return "bf16";
+	}
+	return "unknown";
+}
@@ -20,21 +20,62 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include "aligned_memory.h"
+#include "filter_bank_cache.h"
+#include "resampler_types.h"
+#include "sample_format.h"
 
+#include <cstddef>
 #include <cstdint>
 
+#include <complex>
+#include <string>
 #include <utility>
+#include <vector>
+
+struct lowrider_resampler_kernels;
 
 /*
-This is a simple variable-rate resampler based on a polyphase filter bank with linear interpolation.
+This is a simple variable-rate resampler based on a polyphase filter bank with linear or cubic interpolation.
 It uses a sinc filter windowed with a Kaiser window. The algorithm is described in more detail here:
 https://ccrma.stanford.edu/~jos/resample/resample.html
 
+Filters between the rows of the filter bank are calculated with linear or cubic (4-point Lagrange) interpolation. Cubic
+interpolation is more accurate, so it needs far fewer rows to reach the same accuracy (roughly 8x fewer for beta=8, 16x
+fewer for beta=11). This makes the filter bank small enough to stay in the cache, at the cost of a slightly more
+expensive filter calculation. The filter is symmetric, so row j of the filter bank is the mirror image of row
+(rows - j). Only the first half of the filter bank is stored, the kernels read the other half backwards.
+
+The filter can optionally be converted to a minimum phase filter with the same magnitude response. This moves most of
+the energy to the first taps, which reduces the latency by an order of magnitude, at the cost of a group delay that
+varies with frequency (it increases close to the edge of the passband). Minimum phase filters are not symmetric, so the
+full filter bank is stored.
+
+The resampler can also be constructed in rational mode for a fixed ratio rate_in / rate_out. In that case the filter bank
+has exactly one row for every output phase and the offset is an integer phase index, so there is no interpolation
+between rows at all. This is used by lowrider_resampler_chain.
+
+The filter bank can optionally be stored with 16-bit coefficients (f16 or bf16, see lowrider_resampler_storage), which
+halves the memory bandwidth and cache footprint of the filter bank. The kernels convert the coefficients back to float,
+the calculation itself is still done in single precision. This only makes sense for large filter banks that don't fit
+in the L2 cache. The rounding of the coefficients limits the SNR to roughly 75-80 dB for f16 and 60 dB for bf16, so
+with the default filter parameters (beta=8) the storage format is already the dominant source of errors. Use
+--analyze-resampler to check the SNR and --benchmark-resampler to check whether it is actually faster.
+
+For integer devices there is an optional fixed-point path, which resamples int16 or int32 data directly. It uses a
+separate copy of the filter bank with integer coefficients (int16 for int16 data, int32 for int32 data) in which all rows
+are stored. Every row is applied to the data with exact integer accumulation (32-bit or 64-bit), and only the results of
+the two or four rows are interpolated, which is equivalent to interpolating the filter. The number of fractional bits of
+the coefficients is chosen such that the accumulator can't overflow for any input, which is usually one bit less than
+the full range (Q14 or Q30). For int16, the rounding of the coefficients limits the SNR to roughly 75-80 dB with the
+default filter parameters, which is less than the floating point path. For int32, the accuracy is the same as the
+floating point path. Use --analyze-resampler to check the SNR.
+
 - The resampling ratio is defined as the input rate divided by the output rate.
 - The passband and stopband frequencies are specified relative to the lowest sample rate.
   The 6dB point of the filter is located exactly in the center of the transition band.
 - The beta parameter controls the stopband attenuation of the filter.
 - The gain parameter can be used to rescale the input data, which can be useful to avoid clipping due to ringing.
+- The phase parameter selects a linear phase or minimum phase filter.
 
 The stopband attenuation can be estimated using the following empirical formulas:
 	min attenuation = (beta * 8.7 + 6) dB
@@ -47,7 +88,8 @@ Some sensible default values:
 - medium quality: passband=0.42, stopband=0.50, beta=8.0  => latency ~ 36 samples
 - low quality:    passband=0.40, stopband=0.54, beta=7.0  => latency ~ 18 samples
 
-The latency function can be used to accurately convert timestamps. The correct formula for this is:
+The latency function can be used to accurately convert timestamps. For minimum phase filters, the latency is the group
+delay at DC. The correct formula for this is:
 	output_timestamp = input_timestamp - buffered_samples + get_latency_in()
 
 In order to minimize unneccesary copying, the resampler does not do any buffering. When data is processed in blocks,
@@ -76,14 +118,91 @@ In this implementation, the number of buffered samples is equal to buffer_size -
 class lowrider_resampler {
 
 private:
-	uint64_t m_ratio;
+	uint64_t m_ratio, m_ratio_one;
 	uint32_t m_offset;
+	uint32_t m_rational_step, m_rational_offset_step;
+	lowrider_resampler_interpolation m_interpolation;
 	uint32_t m_filter_length, m_filter_rows;
-	lowrider_aligned_memory<float> m_filter_bank;
+	uint32_t m_bank_rows, m_bank_split, m_row_extra;
+	lowrider_resampler_phase m_phase;
+	float m_sinc_freq, m_beta, m_gain;
+	float m_filter_delay;
+	const float *m_filter_bank;
+	lowrider_aligned_memory<float> m_filter_bank_memory;
+	lowrider_resampler_storage m_storage;
+	const void *m_filter_bank_storage;
+	size_t m_storage_element_size;
+	lowrider_aligned_memory<uint16_t> m_filter_bank_half;
+	lowrider_filter_bank_file m_filter_bank_file;
+	lowrider_filter_bank_source m_filter_bank_source;
+	lowrider_aligned_memory<float> m_coef_temp;
+	lowrider_aligned_memory<int16_t> m_filter_bank_s16;
+	lowrider_aligned_memory<int32_t> m_filter_bank_s32;
+	int32_t m_fixed_point_shift_s16, m_fixed_point_shift_s32;
+	const lowrider_resampler_kernels *m_kernels;
 
 private:
 	static constexpr uint64_t RATIO_ONE = (uint64_t) 1 << 32;
 
+	// Parameters for filter bank generation.
+	static constexpr uint32_t GENERATE_SINC_BLOCK = 32;
+	static constexpr uint32_t GENERATE_THREAD_ROWS_MIN = 16;
+	static constexpr uint32_t GENERATE_THREAD_COEFFICIENTS_MIN = 65536;
+	static constexpr uint32_t GENERATE_PHASE_OVERSAMPLING = 16;
+	static constexpr uint32_t GENERATE_PHASE_FFT_FACTOR = 8;
+	static constexpr double GENERATE_PHASE_FLOOR = 1.0e-10;
+
+	// Number of rows that are checked by verify_filter_bank for minimum phase filters.
+	static constexpr uint32_t VERIFY_SPECTRUM_ROWS = 64;
+
+private:
+	// Calculates the filter length and loads or generates the filter bank. The ratio and the number of rows must be set.
+	void initialize(float ratio, float passband, float stopband, float beta, float gain,
+					lowrider_resampler_phase phase, const std::string &cache_dir, bool skip_embedded);
+
+	// Generates the filter bank in m_filter_bank_memory, using multiple threads if the filter bank is large.
+	void generate_filter_bank();
+
+	// Calculates the spectrum of the minimum phase filter. The spectrum corresponds to the filter sampled with a
+	// resolution of GENERATE_PHASE_OVERSAMPLING samples per input sample, starting at the first tap of row 0.
+	void design_filter_spectrum(std::vector<std::complex<double>> &spectrum);
+
+	// Calculates the phase ramp for all frequencies of an FFT.
+	static void calculate_phase_ramp(double phase_step, size_t size, std::complex<double> *ramp);
+
+	// Generates rows [row_begin, row_end) of the stored filter bank. If 'spectrum' is not null, the rows are calculated
+	// from the spectrum of the filter, otherwise the linear phase filter is used.
+	void generate_filter_rows(uint32_t row_begin, uint32_t row_end, const std::complex<double> *spectrum, size_t spectrum_size);
+	void generate_filter_rows_spectrum(uint32_t row_begin, uint32_t row_end, const std::complex<double> *spectrum, size_t spectrum_size);
+
+	// Generates one row of the full filter bank using the direct formula (or the direct inverse DFT of the spectrum).
+	// This is much slower than generate_filter_rows, it is only used to verify the filter bank. Rows -1 and
+	// m_filter_rows + 1 are only used for cubic interpolation.
+	void generate_filter_row_reference(int32_t row, float *coef, const std::complex<double> *spectrum, size_t spectrum_size);
+
+	// Advances the offset by one output sample. Returns the number of input samples to advance.
+	inline uint32_t advance();
+
+	// Selects the filter for the current offset. Returns the first row (relative to stored row 0, i.e. row - m_row_extra)
+	// and calculates the weights.
+	inline uint32_t select_row(float *weights);
+
+	// Selects the filter for the current offset. Returns a pointer to the first row (in the selected storage format) and
+	// calculates the weights. If 'reverse' is set, the rows must be read backwards (see lowrider_firfilter_func).
+	inline const void* select_filter(float *weights, bool *reverse);
+
+	// Copies stored row 'row' of the full filter bank (including the mirrored rows) to 'coef'.
+	void get_filter_row(uint32_t row, float *coef);
+
+	// Converts the full filter bank to integer coefficients. Returns the number of fractional bits.
+	template<typename T, typename A>
+	int32_t quantize_filter_bank(lowrider_aligned_memory<T> &bank);
+
+	// Implements resample() for the fixed-point path.
+	template<typename T, typename F>
+	std::pair<uint32_t, uint32_t> resample_fixed_point(F firfilter, const T *filter_bank, int32_t shift, uint32_t channels,
+													   const T * const *data_in, uint32_t size_in, T * const *data_out, uint32_t size_out);
+
 public:
 	// Lower and upper bounds for parameters.
 	static constexpr float RATIO_MIN = 1.0e-3f;
@@ -95,10 +214,30 @@ public:
 	static constexpr float BETA_MIN = 1.0f;
 	static constexpr float BETA_MAX = 20.0f;
 
+	// Maximum number of phases for exact rational ratios, i.e. rate_out / gcd(rate_in, rate_out).
+	static constexpr uint32_t RATIONAL_PHASES_MAX = 4096;
+
+	// Interleaved data must use a stride (in floats) that is a multiple of this value.
+	static constexpr uint32_t INTERLEAVED_ALIGN = 16;
+
+	// Minimum channel count for which interleaved data is recommended. Below this, planar data is faster.
+	static constexpr uint32_t INTERLEAVED_CHANNELS_MIN = 16;
+
 public:
 	// Initializes the resampler and generates a filter bank based on the provided filter parameters.
-	// The parameters must be within the bounds defined above.
-	lowrider_resampler(float ratio, float passband, float stopband, float beta, float gain);
+	// The parameters must be within the bounds defined above. If cache_dir is not empty, the filter bank is loaded from
+	// the filter bank cache in that directory if possible, otherwise it is generated and stored in the cache. Filter banks
+	// that are embedded in the binary are used if they match the parameters, unless skip_embedded is true. With skip_embedded
+	// and an empty cache_dir, the filter bank is always generated (this is used to benchmark the generator and the cache).
+	lowrider_resampler(float ratio, float passband, float stopband, float beta, float gain,
+					   lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, const std::string &cache_dir,
+					   bool skip_embedded);
+
+	// Initializes the resampler for the exact rational ratio rate_in / rate_out. The filter bank contains a row for every
+	// phase, so the filters don't have to be interpolated. The reduced ratio must not have more than RATIONAL_PHASES_MAX
+	// phases (see get_rational_phases). The ratio can't be changed afterwards.
+	lowrider_resampler(uint32_t rate_in, uint32_t rate_out, float passband, float stopband, float beta, float gain,
+					   lowrider_resampler_phase phase, const std::string &cache_dir);
 
 	// Resets the state of the resampler, while reusing the existing filter bank.
 	void reset();
@@ -113,6 +252,40 @@ public:
 	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
 										   float * const *data_out, uint32_t size_out);
 
+	// Same as resample(), but for interleaved data, i.e. sample c of frame i is located at data[i * stride + c]. The stride
+	// must be a multiple of INTERLEAVED_ALIGN. Padding channels are processed as well, so they should contain zeros.
+	// This scales better to high channel counts than planar data, since each SIMD lane processes a different channel.
+	std::pair<uint32_t, uint32_t> resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+													   float *data_out, uint32_t size_out);
+
+	// Same as resample(), but the output is written as interleaved frames in a device sample format, e.g. directly into the
+	// buffer of an output device. The samples are converted by the kernel, which is specialized for every format (and for
+	// common channel counts) at compile time. The filter bank must use f32 storage.
+	std::pair<uint32_t, uint32_t> resample_device(uint32_t channels, const float * const *data_in, uint32_t size_in,
+												  lowrider_sample_format format, void *data_out, uint32_t size_out);
+
+	// Creates the integer filter bank for the fixed-point path. This must be called before the fixed-point version of
+	// resample() is used for the corresponding type.
+	void prepare_fixed_point(lowrider_resampler_fixed_point type);
+
+	// Same as resample(), but for int16 or int32 data, using the fixed-point path (see prepare_fixed_point). The results are
+	// rounded and saturated.
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const int16_t * const *data_in, uint32_t size_in,
+										   int16_t * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const int32_t * const *data_in, uint32_t size_in,
+										   int32_t * const *data_out, uint32_t size_out);
+
+	// Changes the storage format of the filter bank that is used by the kernels. The filter bank is converted to the 16-bit
+	// formats with rounding to nearest. The original filter bank is kept, so the format can be changed again later.
+	void set_storage(lowrider_resampler_storage storage);
+
+	// Returns the storage format of the filter bank.
+	lowrider_resampler_storage get_storage();
+
+	// Returns the number of fractional bits of the integer coefficients of the fixed-point path, or -1 if
+	// prepare_fixed_point has not been called.
+	int32_t get_fixed_point_shift(lowrider_resampler_fixed_point type);
+
 	// Calculates the required input size to produce the requested number of output samples.
 	uint32_t calculate_size_in(uint32_t size_out);
 
@@ -125,11 +298,13 @@ public:
 	// Returns the current resampler latency expressed in output samples.
 	float get_latency_out();
 
-	// Returns the current resampling ratio (rate_in/rate_out).
-	float get_ratio();
+	// Returns the current resampling ratio (rate_in/rate_out). This uses double precision because the internal 32.32
+	// fixed-point ratio is more accurate than a float.
+	double get_ratio();
 
 	// Changes the resampling ratio. The filter bank is not regenerated, so large changes are not recommended.
-	void set_ratio(float ratio);
+	// This is not allowed for exact rational ratios.
+	void set_ratio(double ratio);
 
 	// Returns the filter length (in input samples).
 	uint32_t get_filter_length();
@@ -137,4 +312,44 @@ public:
 	// Returns the number of filter rows in the filter bank.
 	uint32_t get_filter_rows();
 
+	// Returns the number of phases needed to resample at the exact ratio rate_in / rate_out.
+	static uint32_t get_rational_phases(uint32_t rate_in, uint32_t rate_out);
+
+	// Returns the filter length for the given parameters without creating the resampler.
+	static uint32_t calculate_filter_length(float ratio, float passband, float stopband, float beta);
+
+	// Returns the interpolation method.
+	lowrider_resampler_interpolation get_interpolation();
+
+	// Returns the phase response.
+	lowrider_resampler_phase get_phase();
+
+	// Returns the delay of the filter (in input samples), i.e. the group delay at DC. For linear phase filters, this is
+	// half the filter length.
+	float get_filter_delay();
+
+	// Returns the parameters that determine the contents of the filter bank.
+	lowrider_filter_bank_key get_filter_bank_key();
+
+	// Returns a pointer to the stored part of the filter bank (see get_filter_bank_size).
+	const float* get_filter_bank();
+
+	// Returns whether the filter bank was generated, loaded from the cache or embedded in the binary.
+	lowrider_filter_bank_source get_filter_bank_source();
+
+	// Returns the size of the filter bank in bytes. For linear phase filters, only half of the rows are stored, the others
+	// are mirror images.
+	size_t get_filter_bank_size();
+
+	// Returns the size in bytes of the filter bank that is used by the kernels, i.e. in the selected storage format.
+	size_t get_filter_bank_storage_size();
+
+	// Compares the filter bank, including the mirrored rows, with rows of the full filter bank generated by the direct
+	// formula. For minimum phase filters, only a subset of the rows is checked.
+	// Returns the largest difference in units in the last place (ignoring tiny differences near the zero crossings).
+	uint32_t verify_filter_bank();
+
 };
+
+// Returns a human-readable name for the storage format of the filter bank.
+const char* get_resampler_storage_name(lowrider_resampler_storage storage);
@@ -0,0 +1,574 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resampler_chain.h"
+
+#include "miscmath.h"
+
+#include <cassert>
+
+#include <algorithm>
+
+lowrider_resampler_chain::lowrider_resampler_chain(uint32_t rate_in, uint32_t rate_out, lowrider_resampler_engine engine, bool multistage, uint32_t block_size,
+												   float passband, float stopband, float beta, float gain,
+												   lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, uint32_t farrow_taps,
+												   const std::string &cache_dir) {
+
+	// The passband of the half-band filters and the trim resampler is derived from the final passband, which is relative
+	// to the lowest sample rate. The half-band stages don't change the lowest sample rate, so the passband and stopband
+	// of the main resampler stay the same.
+	float passband_hz = passband * (float) std::min(rate_in, rate_out);
+	float trim_beta = clamp(beta + TRIM_BETA_EXTRA, lowrider_resampler::BETA_MIN, lowrider_resampler::BETA_MAX);
+	float halfband_beta = clamp(beta + HALFBAND_BETA_EXTRA, lowrider_resampler::BETA_MIN, lowrider_resampler::BETA_MAX);
+	uint32_t decimate_stages = (multistage)? get_halfband_decimate_stages(rate_in, rate_out) : 0;
+	uint32_t interpolate_stages = (multistage)? get_halfband_interpolate_stages(rate_in, rate_out) : 0;
+	uint32_t core_rate_in = rate_in >> decimate_stages, core_rate_out = rate_out >> interpolate_stages;
+
+	// half-band decimation stages
+	m_stages.reserve(decimate_stages + 2 + interpolate_stages);
+	for(uint32_t i = 0; i < decimate_stages; ++i) {
+		float halfband_passband = std::min(passband_hz / (float) (rate_in >> i), (float) lowrider_halfband::PASSBAND_MAX);
+		add_stage().halfband.reset(new lowrider_halfband(lowrider_halfband_mode_decimate, halfband_passband, halfband_beta));
+	}
+
+	// main resampler stages
+	m_variable = nullptr;
+	m_farrow = nullptr;
+	m_slip = nullptr;
+	m_engine = resolve_engine(rate_in, rate_out, engine, multistage, block_size, passband, stopband, beta, phase);
+	float ratio = (float) core_rate_in / (float) core_rate_out;
+	switch(m_engine) {
+		case lowrider_resampler_engine_auto:
+		case lowrider_resampler_engine_polyphase: {
+			m_variable = new lowrider_resampler(ratio, passband, stopband, beta, gain, interpolation, phase, cache_dir, false);
+			add_stage().resampler.reset(m_variable);
+			break;
+		}
+		case lowrider_resampler_engine_rational: {
+			float trim_passband = passband_hz / (float) std::max(core_rate_in, core_rate_out);
+			float trim_stopband = clamp(1.0f - trim_passband, lowrider_resampler::STOPBAND_MIN, lowrider_resampler::STOPBAND_MAX);
+			lowrider_resampler *rational = new lowrider_resampler(core_rate_in, core_rate_out, passband, stopband, beta, gain, phase, cache_dir);
+			m_variable = new lowrider_resampler(1.0f, trim_passband, trim_stopband, trim_beta, 1.0f, interpolation, phase, cache_dir, false);
+			if(core_rate_out > core_rate_in) {
+				add_stage().resampler.reset(rational);
+				add_stage().resampler.reset(m_variable);
+			} else {
+				add_stage().resampler.reset(m_variable);
+				add_stage().resampler.reset(rational);
+			}
+			break;
+		}
+		case lowrider_resampler_engine_fft: {
+			float relaxed_stopband = clamp(std::max(stopband, 1.0f - passband), lowrider_resampler::STOPBAND_MIN, lowrider_resampler::STOPBAND_MAX);
+			m_variable = new lowrider_resampler(ratio, passband, relaxed_stopband, trim_beta, 1.0f, interpolation, phase, cache_dir, false);
+			add_stage().fft_filter.reset(new lowrider_fft_filter(ratio, passband, stopband, beta, gain));
+			add_stage().resampler.reset(m_variable);
+			break;
+		}
+		case lowrider_resampler_engine_farrow: {
+			m_farrow = new lowrider_farrow(ratio, farrow_taps, gain);
+			add_stage().farrow.reset(m_farrow);
+			break;
+		}
+		case lowrider_resampler_engine_slip: {
+			m_slip = new lowrider_slip(ratio, gain);
+			add_stage().slip.reset(m_slip);
+			break;
+		}
+	}
+
+	// half-band interpolation stages
+	for(uint32_t i = interpolate_stages; i > 0; --i) {
+		float halfband_passband = std::min(passband_hz / (float) (rate_out >> (i - 1)), (float) lowrider_halfband::PASSBAND_MAX);
+		add_stage().halfband.reset(new lowrider_halfband(lowrider_halfband_mode_interpolate, halfband_passband, halfband_beta));
+	}
+
+	// the ratio of all stages except the variable-rate resampler
+	m_fixed_ratio = 1.0;
+	for(stage &s : m_stages) {
+		if(s.resampler.get() != m_variable) {
+			m_fixed_ratio *= stage_get_ratio(s);
+		}
+	}
+
+	reset();
+}
+
+lowrider_resampler_chain::stage& lowrider_resampler_chain::add_stage() {
+	m_stages.emplace_back();
+	stage &s = m_stages.back();
+	s.interleaved = false;
+	s.stride = 0;
+	s.capacity = 0;
+	s.size = 0;
+	s.skip = 0;
+	s.request = 0;
+	return s;
+}
+
+void lowrider_resampler_chain::stage_reset(stage &s) {
+	if(s.resampler) {
+		s.resampler->reset();
+	} else if(s.halfband) {
+		s.halfband->reset();
+	} else if(s.fft_filter) {
+		s.fft_filter->reset();
+	} else if(s.farrow) {
+		s.farrow->reset();
+	} else {
+		s.slip->reset();
+	}
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::stage_resample(stage &s, uint32_t channels, const float * const *data_in, uint32_t size_in,
+																	   float * const *data_out, uint32_t size_out) {
+	if(s.resampler) {
+		return s.resampler->resample(channels, data_in, size_in, data_out, size_out);
+	} else if(s.halfband) {
+		return s.halfband->resample(channels, data_in, size_in, data_out, size_out);
+	} else if(s.fft_filter) {
+		return s.fft_filter->resample(channels, data_in, size_in, data_out, size_out);
+	} else if(s.farrow) {
+		return s.farrow->resample(channels, data_in, size_in, data_out, size_out);
+	} else {
+		return s.slip->resample(channels, data_in, size_in, data_out, size_out);
+	}
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::stage_resample_interleaved(stage &s, uint32_t stride, const float *data_in, uint32_t size_in,
+																				   float *data_out, uint32_t size_out) {
+	if(s.resampler) {
+		return s.resampler->resample_interleaved(stride, data_in, size_in, data_out, size_out);
+	} else if(s.halfband) {
+		return s.halfband->resample_interleaved(stride, data_in, size_in, data_out, size_out);
+	} else if(s.fft_filter) {
+		return s.fft_filter->resample_interleaved(stride, data_in, size_in, data_out, size_out);
+	} else if(s.farrow) {
+		return s.farrow->resample_interleaved(stride, data_in, size_in, data_out, size_out);
+	} else {
+		return s.slip->resample_interleaved(stride, data_in, size_in, data_out, size_out);
+	}
+}
+
+uint32_t lowrider_resampler_chain::stage_calculate_size_in(stage &s, uint32_t size_out) {
+	return (s.resampler)? s.resampler->calculate_size_in(size_out) : (s.halfband)? s.halfband->calculate_size_in(size_out) : (s.fft_filter)? s.fft_filter->calculate_size_in(size_out) : (s.farrow)? s.farrow->calculate_size_in(size_out) : s.slip->calculate_size_in(size_out);
+}
+
+uint32_t lowrider_resampler_chain::stage_calculate_size_out(stage &s, uint32_t size_in) {
+	return (s.resampler)? s.resampler->calculate_size_out(size_in) : (s.halfband)? s.halfband->calculate_size_out(size_in) : (s.fft_filter)? s.fft_filter->calculate_size_out(size_in) : (s.farrow)? s.farrow->calculate_size_out(size_in) : s.slip->calculate_size_out(size_in);
+}
+
+float lowrider_resampler_chain::stage_get_latency_in(stage &s) {
+	return (s.resampler)? s.resampler->get_latency_in() : (s.halfband)? s.halfband->get_latency_in() : (s.fft_filter)? s.fft_filter->get_latency_in() : (s.farrow)? s.farrow->get_latency_in() : s.slip->get_latency_in();
+}
+
+double lowrider_resampler_chain::stage_get_ratio(stage &s) {
+	return (s.resampler)? s.resampler->get_ratio() : (s.halfband)? s.halfband->get_ratio() : (s.fft_filter)? s.fft_filter->get_ratio() : (s.farrow)? s.farrow->get_ratio() : s.slip->get_ratio();
+}
+
+uint32_t lowrider_resampler_chain::stage_get_filter_length(stage &s) {
+	return (s.resampler)? s.resampler->get_filter_length() : (s.halfband)? s.halfband->get_filter_length() : (s.fft_filter)? s.fft_filter->get_filter_length() : (s.farrow)? s.farrow->get_filter_length() : s.slip->get_filter_length();
+}
+
+float lowrider_resampler_chain::stage_get_filter_delay(stage &s) {
+	return (s.resampler)? s.resampler->get_filter_delay() : (s.halfband)? s.halfband->get_filter_delay() : (s.fft_filter)? s.fft_filter->get_filter_delay() : (s.farrow)? s.farrow->get_filter_delay() : s.slip->get_filter_delay();
+}
+
+void lowrider_resampler_chain::prepare_buffer(stage &s, bool interleaved, uint32_t stride, uint32_t capacity) {
+	if(interleaved != s.interleaved || stride != s.stride) {
+		s.interleaved = interleaved;
+		s.stride = stride;
+		s.capacity = 0;
+		s.size = 0;
+		s.data.clear();
+	}
+	if(capacity > s.capacity) {
+		uint32_t new_capacity = std::max(capacity, s.capacity + s.capacity / 2);
+		std::vector<float> new_data((size_t) s.stride * new_capacity, 0.0f);
+		if(!s.data.empty()) {
+			if(s.interleaved) {
+				std::copy_n(s.data.data(), (size_t) s.stride * s.size, new_data.data());
+			} else {
+				for(uint32_t c = 0; c < s.stride; ++c) {
+					std::copy_n(s.data.data() + (size_t) c * s.capacity, s.size, new_data.data() + (size_t) c * new_capacity);
+				}
+			}
+		}
+		s.data = std::move(new_data);
+		s.capacity = new_capacity;
+	}
+	if(!s.interleaved) {
+		s.pointers.resize(s.stride);
+		s.write_pointers.resize(s.stride);
+		for(uint32_t c = 0; c < s.stride; ++c) {
+			s.pointers[c] = s.data.data() + (size_t) c * s.capacity;
+			s.write_pointers[c] = s.pointers[c] + s.size;
+		}
+	}
+}
+
+void lowrider_resampler_chain::consume_buffer(stage &s, uint32_t count) {
+	// If the next stage skipped more samples than available (which can happen after extreme ratio changes), the remaining
+	// samples are skipped as soon as they are produced.
+	if(count > s.size) {
+		s.skip += count - s.size;
+		count = s.size;
+	}
+	if(s.interleaved) {
+		std::copy(s.data.data() + (size_t) count * s.stride, s.data.data() + (size_t) s.size * s.stride, s.data.data());
+	} else {
+		for(uint32_t c = 0; c < s.stride; ++c) {
+			float *data = s.data.data() + (size_t) c * s.capacity;
+			std::copy(data + count, data + s.size, data);
+		}
+	}
+	s.size -= count;
+}
+
+void lowrider_resampler_chain::calculate_requests(uint32_t size_out) {
+	// Each stage should produce enough data for the next stage to produce one sample more than requested, taking into
+	// account the data that is already buffered. If a stage can't produce all the data that is requested, it is limited
+	// by its input, which means that the previous stage was also limited by its input. This guarantees that the first
+	// stage consumes all the input data (except one filter length) whenever the last stage is limited by its input,
+	// even if the stages can only consume data in multiples of 2. The buffers never grow beyond what the next stage needs
+	// for one extra sample.
+	m_stages.back().request = size_out;
+	for(size_t i = m_stages.size() - 1; i > 0; --i) {
+		stage &prev = m_stages[i - 1];
+		uint32_t needed = stage_calculate_size_in(m_stages[i], m_stages[i].request + 1) + prev.skip;
+		prev.request = (needed > prev.size)? needed - prev.size : 0;
+	}
+}
+
+void lowrider_resampler_chain::reset() {
+	// The buffers start empty. Just like the input of the first stage, the first filter length of data produced by each
+	// stage is used as history for the next stage.
+	for(stage &s : m_stages) {
+		stage_reset(s);
+		s.size = 0;
+		s.skip = 0;
+	}
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::stage_resample_last(stage &s, uint32_t channels, const float * const *data_in, uint32_t size_in,
+																			float * const *data_out, lowrider_sample_format format, void *device_out,
+																			uint32_t size_out) {
+	if(device_out != nullptr)
+		return s.resampler->resample_device(channels, data_in, size_in, format, device_out, size_out);
+	return stage_resample(s, channels, data_in, size_in, data_out, size_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::resample_planar(uint32_t channels, const float * const *data_in, uint32_t size_in,
+																		float * const *data_out, lowrider_sample_format format, void *device_out,
+																		uint32_t size_out) {
+	if(m_stages.size() == 1)
+		return stage_resample_last(m_stages[0], channels, data_in, size_in, data_out, format, device_out, size_out);
+	calculate_requests(size_out);
+	uint32_t pos_in = 0, pos_out = 0;
+	for(size_t i = 0; i < m_stages.size(); ++i) {
+		stage &s = m_stages[i];
+		const float * const *stage_in = (i == 0)? data_in : m_stages[i - 1].pointers.data();
+		uint32_t stage_size_in = (i == 0)? size_in : m_stages[i - 1].size;
+		std::pair<uint32_t, uint32_t> p;
+		if(i == m_stages.size() - 1) {
+			p = stage_resample_last(s, channels, stage_in, stage_size_in, data_out, format, device_out, size_out);
+			pos_out = p.second;
+		} else {
+			prepare_buffer(s, false, channels, s.size + s.request);
+			p = stage_resample(s, channels, stage_in, stage_size_in, s.write_pointers.data(), s.request);
+			uint32_t skip = std::min(s.skip, p.second);
+			if(skip != 0) {
+				s.skip -= skip;
+				for(uint32_t c = 0; c < channels; ++c) {
+					float *data = s.write_pointers[c];
+					std::copy(data + skip, data + p.second, data);
+				}
+			}
+			s.size += p.second - skip;
+		}
+		if(i == 0) {
+			pos_in = p.first;
+		} else {
+			consume_buffer(m_stages[i - 1], p.first);
+		}
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+																 float * const *data_out, uint32_t size_out) {
+	return resample_planar(channels, data_in, size_in, data_out, lowrider_sample_format_any, nullptr, size_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+																			 float *data_out, uint32_t size_out) {
+	if(m_stages.size() == 1)
+		return stage_resample_interleaved(m_stages[0], stride, data_in, size_in, data_out, size_out);
+	calculate_requests(size_out);
+	uint32_t pos_in = 0, pos_out = 0;
+	for(size_t i = 0; i < m_stages.size(); ++i) {
+		stage &s = m_stages[i];
+		const float *stage_in = (i == 0)? data_in : m_stages[i - 1].data.data();
+		uint32_t stage_size_in = (i == 0)? size_in : m_stages[i - 1].size;
+		std::pair<uint32_t, uint32_t> p;
+		if(i == m_stages.size() - 1) {
+			p = stage_resample_interleaved(s, stride, stage_in, stage_size_in, data_out, size_out);
+			pos_out = p.second;
+		} else {
+			prepare_buffer(s, true, stride, s.size + s.request);
+			float *data = s.data.data() + (size_t) s.size * stride;
+			p = stage_resample_interleaved(s, stride, stage_in, stage_size_in, data, s.request);
+			uint32_t skip = std::min(s.skip, p.second);
+			if(skip != 0) {
+				s.skip -= skip;
+				std::copy(data + (size_t) skip * stride, data + (size_t) p.second * stride, data);
+			}
+			s.size += p.second - skip;
+		}
+		if(i == 0) {
+			pos_in = p.first;
+		} else {
+			consume_buffer(m_stages[i - 1], p.first);
+		}
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+void lowrider_resampler_chain::reserve(uint32_t size_out, bool interleaved, uint32_t stride) {
+	// This follows calculate_requests. A buffer never has to hold more than what the next stage needs for its largest
+	// request plus one sample.
+	uint32_t request = size_out;
+	for(size_t i = m_stages.size() - 1; i > 0; --i) {
+		stage &prev = m_stages[i - 1];
+		uint32_t needed = stage_calculate_size_in(m_stages[i], request + 1);
+		prepare_buffer(prev, interleaved, stride, needed);
+		request = needed;
+	}
+}
+
+void lowrider_resampler_chain::set_storage(lowrider_resampler_storage storage) {
+	for(stage &s : m_stages) {
+		if(s.resampler) {
+			s.resampler->set_storage(storage);
+		}
+	}
+}
+
+bool lowrider_resampler_chain::supports_fixed_point() {
+	return (m_stages.size() == 1 && m_stages[0].resampler);
+}
+
+bool lowrider_resampler_chain::supports_device_output() {
+	const stage &s = m_stages.back();
+	return (s.resampler && s.resampler->get_storage() == lowrider_resampler_storage_f32);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::resample_device(uint32_t channels, const float * const *data_in, uint32_t size_in,
+																		lowrider_sample_format format, void *data_out, uint32_t size_out) {
+	assert(supports_device_output());
+	assert(format != lowrider_sample_format_any);
+	return resample_planar(channels, data_in, size_in, nullptr, format, data_out, size_out);
+}
+
+void lowrider_resampler_chain::prepare_fixed_point(lowrider_resampler_fixed_point type) {
+	assert(supports_fixed_point());
+	m_stages[0].resampler->prepare_fixed_point(type);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::resample(uint32_t channels, const int16_t * const *data_in, uint32_t size_in,
+																 int16_t * const *data_out, uint32_t size_out) {
+	assert(supports_fixed_point());
+	return m_stages[0].resampler->resample(channels, data_in, size_in, data_out, size_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_resampler_chain::resample(uint32_t channels, const int32_t * const *data_in, uint32_t size_in,
+																 int32_t * const *data_out, uint32_t size_out) {
+	assert(supports_fixed_point());
+	return m_stages[0].resampler->resample(channels, data_in, size_in, data_out, size_out);
+}
+
+uint32_t lowrider_resampler_chain::calculate_size_in(uint32_t size_out) {
+	uint32_t size = size_out;
+	for(size_t i = m_stages.size() - 1; i > 0; --i) {
+		stage &prev = m_stages[i - 1];
+		uint32_t needed = stage_calculate_size_in(m_stages[i], size) + prev.skip;
+		size = (needed > prev.size)? needed - prev.size : 0;
+	}
+	return stage_calculate_size_in(m_stages[0], size);
+}
+
+uint32_t lowrider_resampler_chain::calculate_size_out(uint32_t size_in) {
+	uint32_t size = stage_calculate_size_out(m_stages[0], size_in);
+	for(size_t i = 1; i < m_stages.size(); ++i) {
+		stage &prev = m_stages[i - 1];
+		uint32_t available = prev.size + size;
+		size = stage_calculate_size_out(m_stages[i], (available > prev.skip)? available - prev.skip : 0);
+	}
+	return size;
+}
+
+float lowrider_resampler_chain::get_latency_in() {
+	// The input window of the next stage starts at the oldest sample in the buffer after the previous stage, which lies
+	// 'size' samples before the next output of the previous stage. Samples that will be skipped move the start of the
+	// window forward.
+	float latency = stage_get_latency_in(m_stages.back());
+	for(size_t i = m_stages.size() - 1; i > 0; --i) {
+		stage &prev = m_stages[i - 1];
+		latency = stage_get_latency_in(prev) + (latency - (float) prev.size + (float) prev.skip) * (float) stage_get_ratio(prev);
+	}
+	return latency;
+}
+
+float lowrider_resampler_chain::get_latency_out() {
+	return (float) ((double) get_latency_in() / get_ratio());
+}
+
+double lowrider_resampler_chain::get_ratio() {
+	double ratio = 1.0;
+	for(stage &s : m_stages) {
+		ratio *= stage_get_ratio(s);
+	}
+	return ratio;
+}
+
+void lowrider_resampler_chain::set_ratio(double ratio) {
+	if(m_farrow != nullptr) {
+		m_farrow->set_ratio(ratio / m_fixed_ratio);
+	} else if(m_slip != nullptr) {
+		m_slip->set_ratio(ratio / m_fixed_ratio);
+	} else {
+		m_variable->set_ratio(ratio / m_fixed_ratio);
+	}
+}
+
+uint32_t lowrider_resampler_chain::get_filter_length() {
+	return stage_get_filter_length(m_stages[0]);
+}
+
+float lowrider_resampler_chain::get_filter_delay() {
+	float delay = stage_get_filter_delay(m_stages.back());
+	for(size_t i = m_stages.size() - 1; i > 0; --i) {
+		stage &prev = m_stages[i - 1];
+		delay = stage_get_filter_delay(prev) + (delay - 0.5f) * (float) stage_get_ratio(prev);
+	}
+	return delay;
+}
+
+lowrider_resampler_engine lowrider_resampler_chain::get_engine() {
+	return m_engine;
+}
+
+uint32_t lowrider_resampler_chain::get_stage_count() {
+	return (uint32_t) m_stages.size();
+}
+
+lowrider_resampler* lowrider_resampler_chain::get_stage_resampler(uint32_t stage) {
+	assert(stage < get_stage_count());
+	return m_stages[stage].resampler.get();
+}
+
+lowrider_halfband* lowrider_resampler_chain::get_stage_halfband(uint32_t stage) {
+	assert(stage < get_stage_count());
+	return m_stages[stage].halfband.get();
+}
+
+lowrider_fft_filter* lowrider_resampler_chain::get_stage_fft_filter(uint32_t stage) {
+	assert(stage < get_stage_count());
+	return m_stages[stage].fft_filter.get();
+}
+
+lowrider_farrow* lowrider_resampler_chain::get_stage_farrow(uint32_t stage) {
+	assert(stage < get_stage_count());
+	return m_stages[stage].farrow.get();
+}
+
+lowrider_slip* lowrider_resampler_chain::get_stage_slip(uint32_t stage) {
+	assert(stage < get_stage_count());
+	return m_stages[stage].slip.get();
+}
+
+lowrider_resampler_engine lowrider_resampler_chain::resolve_engine(uint32_t rate_in, uint32_t rate_out, lowrider_resampler_engine engine, bool multistage,
+																   uint32_t block_size, float passband, float stopband, float beta, lowrider_resampler_phase phase) {
+	uint32_t decimate_stages = 0;
+	if(multistage) {
+		decimate_stages = get_halfband_decimate_stages(rate_in, rate_out);
+		rate_in >>= decimate_stages;
+		rate_out >>= get_halfband_interpolate_stages(rate_in, rate_out);
+	}
+	bool rational_possible = (rate_in != rate_out && lowrider_resampler::get_rational_phases(rate_in, rate_out) <= lowrider_resampler::RATIONAL_PHASES_MAX);
+	switch(engine) {
+		case lowrider_resampler_engine_auto: {
+			// the block size is measured at the input of the chain, the half-band stages reduce it
+			float ratio = (float) rate_in / (float) rate_out;
+			uint32_t core_block_size = block_size >> decimate_stages;
+			bool fft_faster = (phase == lowrider_resampler_phase_linear &&
+							   lowrider_resampler::calculate_filter_length(ratio, passband, stopband, beta) >= FFT_FILTER_LENGTH_MIN &&
+							   core_block_size >= lowrider_fft_filter::calculate_block_size(ratio, passband, stopband, beta));
+			return (fft_faster)? lowrider_resampler_engine_fft : lowrider_resampler_engine_polyphase;
+		}
+		case lowrider_resampler_engine_polyphase: {
+			return lowrider_resampler_engine_polyphase;
+		}
+		case lowrider_resampler_engine_rational: {
+			return (rational_possible)? lowrider_resampler_engine_rational : lowrider_resampler_engine_polyphase;
+		}
+		case lowrider_resampler_engine_fft: {
+			return lowrider_resampler_engine_fft;
+		}
+		case lowrider_resampler_engine_farrow: {
+			return (rate_in == rate_out)? lowrider_resampler_engine_farrow : lowrider_resampler_engine_polyphase;
+		}
+		case lowrider_resampler_engine_slip: {
+			return (rate_in == rate_out)? lowrider_resampler_engine_slip : lowrider_resampler_engine_polyphase;
+		}
+	}
+	return lowrider_resampler_engine_polyphase;
+}
+
+uint32_t lowrider_resampler_chain::get_halfband_decimate_stages(uint32_t rate_in, uint32_t rate_out) {
+	if((uint64_t) rate_in < (uint64_t) rate_out * HALFBAND_DECIMATE_RATIO_MIN)
+		return 0;
+	uint32_t stages = 0;
+	while(stages < HALFBAND_STAGES_MAX && rate_in % 2 == 0 && rate_in / 2 >= rate_out) {
+		rate_in /= 2;
+		++stages;
+	}
+	return stages;
+}
+
+uint32_t lowrider_resampler_chain::get_halfband_interpolate_stages(uint32_t rate_in, uint32_t rate_out) {
+	uint32_t stages = 0;
+	while(stages < HALFBAND_STAGES_MAX && rate_out % 2 == 0 && rate_out / 2 >= rate_in) {
+		rate_out /= 2;
+		++stages;
+	}
+	return stages;
+}
+
+const char* get_resampler_engine_name(lowrider_resampler_engine engine) {
+	switch(engine) {
+		case lowrider_resampler_engine_auto: return "auto";
+		case lowrider_resampler_engine_polyphase: return "polyphase";
+		case lowrider_resampler_engine_rational: return "rational";
+		case lowrider_resampler_engine_fft: return "fft";
+		case lowrider_resampler_engine_farrow: return "farrow";
+		case lowrider_resampler_engine_slip: return "slip";
+	}
+	return "unknown";
+}
@@ -0,0 +1,268 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "farrow.h"
+#include "fft_filter.h"
+#include "halfband.h"
+#include "resampler.h"
+#include "resampler_types.h"
+#include "slip.h"
+
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+This class combines one or more resampler stages into a single resampler with the same interface as lowrider_resampler,
+so it can be used as a drop-in replacement. The user of this class must still store one filter length (as returned by
+get_filter_length) of input data for the next invocation. The data between the stages is buffered internally.
+
+The rational engine splits the conversion into an exact rational resampler for the nominal ratio (e.g. 147/160 for
+44100 Hz to 48000 Hz), which doesn't need to interpolate between filter rows, and a variable-rate 'trim' resampler with a
+ratio close to 1 that only corrects the clock drift. The trim resampler runs at the highest of both sample rates, so
+everything above the final passband can be sacrificed, which makes its filter much shorter than the filter of a regular
+resampler:
+	trim passband = passband * lowest_rate / highest_rate
+	trim stopband = 1 - trim passband
+When upsampling, the rational resampler comes first. When downsampling, the trim resampler comes first.
+
+The rational engine is experimental. The rational resampler doesn't need to interpolate between filter rows, but with
+the current kernels the cost of each output sample is dominated by the dot product and the horizontal sums rather than by
+the interpolation, so the rational stage alone costs about as much as the polyphase engine and the trim stage comes on
+top of that (see --benchmark-resampler). For this reason the auto engine never selects the rational engine, and its
+filter banks are not embedded in the binary. It is only useful if a well-defined filter for the nominal ratio is needed.
+
+The FFT engine is meant for very long filters (high beta, narrow transition bands or large downsampling ratios). It
+applies the full filter at the input rate with lowrider_fft_filter (overlap-save), which costs roughly the same for any
+filter length. After this filter, there is nothing left between the stopband and the images of the passband, so the
+variable-rate resampler that follows only needs to protect the passband, just like the trim resampler:
+	relaxed stopband = max(stopband, 1 - passband)
+This halves the length of the variable-rate filter (for stopband=0.5). The FFT filter always has a linear phase, the
+phase parameter only affects the variable-rate resampler. The FFT filter processes at least one full block per
+invocation, so it is only efficient if the data is processed in blocks of at least lowrider_fft_filter::get_block_size()
+samples, which is a few times the filter length. This makes it a block engine for offline use rather than for
+low-latency loopback. The auto engine selects it only for linear phase filters when the filter length of the polyphase
+engine is at least FFT_FILTER_LENGTH_MIN and the block size (the number of input samples per invocation) is at least the
+block size of the FFT filter. The threshold is based on the crossover point measured by --benchmark-resampler.
+
+In multistage mode, large ratios are first reduced by a series of half-band filters (see lowrider_halfband), which
+decimate by 2 in front of the resampler when downsampling, or interpolate by 2 after the resampler when upsampling. A
+half-band stage is added for every factor of 2 in the nominal ratio (as long as the intermediate sample rate is an
+integer), so the remaining ratio is between 0.5 and 2. The half-band filters only need to protect the final passband, so
+the stages at the highest sample rates are very short. When upsampling, this is faster for every ratio of 2 or more,
+because the resampler no longer has to calculate every output sample. When downsampling, the long filter of a single
+resampler is still quite efficient, so half-band stages are only used for ratios of HALFBAND_DECIMATE_RATIO_MIN or more.
+The half-band filters always have a linear phase, so multistage mode increases the latency.
+
+The Farrow engine replaces the filter bank by a short Lagrange interpolator (see lowrider_farrow) with a latency of only a
+few samples. It has no stopband, so it is only possible if the input and output sample rates are the same (i.e. the
+ratio only differs from 1 because of clock drift), and the passband error depends on the number of taps rather than on
+the filter parameters. The auto engine never selects it, use --analyze-resampler to check the error.
+
+The slip engine doesn't filter at all (see lowrider_slip). It copies the input to the output and corrects the clock drift by
+dropping or repeating single samples at quiet points, with a short crossfade. This is almost as cheap as a copy, but
+each slip is a small discontinuity, so it is only meant for systems that can't afford any of the other engines. Like the
+Farrow engine, it is only possible if the input and output sample rates are the same, and the auto engine never selects
+it.
+
+The latency of the chain is calculated exactly, including the data that is buffered between the stages.
+
+The fixed-point path of lowrider_resampler (for int16 and int32 data) is only available if the chain consists of a single
+resampler, since the buffers between the stages are floating point. This is the case for the polyphase engine, unless
+half-band stages are added.
+*/
+
+class lowrider_resampler_chain {
+
+private:
+	struct stage {
+
+		// exactly one of these is used
+		std::unique_ptr<lowrider_resampler> resampler;
+		std::unique_ptr<lowrider_halfband> halfband;
+		std::unique_ptr<lowrider_fft_filter> fft_filter;
+		std::unique_ptr<lowrider_farrow> farrow;
+		std::unique_ptr<lowrider_slip> slip;
+
+		// Output data of this stage, which is the input of the next stage (not used for the last stage). The buffer holds
+		// 'size' samples per channel, either planar (channel c at data[c * capacity]) or interleaved (sample i of channel c
+		// at data[i * stride + c]). If the next stage skipped more samples than available, the remaining samples are
+		// skipped as soon as they are produced.
+		std::vector<float> data;
+		std::vector<float*> pointers, write_pointers;
+		bool interleaved;
+		uint32_t stride, capacity, size, skip;
+
+		// amount of output data requested during the current invocation
+		uint32_t request;
+
+	};
+
+private:
+	lowrider_resampler_engine m_engine;
+	std::vector<stage> m_stages;
+	lowrider_resampler *m_variable;
+	lowrider_farrow *m_farrow;
+	lowrider_slip *m_slip;
+	double m_fixed_ratio;
+
+private:
+	// Adds an empty stage, the caller must set one of the filters.
+	stage& add_stage();
+
+	// Calls the corresponding function of the resampler, half-band filter, FFT filter, Farrow resampler or slip
+	// resampler of a stage.
+	static void stage_reset(stage &s);
+	static std::pair<uint32_t, uint32_t> stage_resample(stage &s, uint32_t channels, const float * const *data_in, uint32_t size_in,
+														float * const *data_out, uint32_t size_out);
+	static std::pair<uint32_t, uint32_t> stage_resample_last(stage &s, uint32_t channels, const float * const *data_in, uint32_t size_in,
+															 float * const *data_out, lowrider_sample_format format, void *device_out,
+															 uint32_t size_out);
+	static std::pair<uint32_t, uint32_t> stage_resample_interleaved(stage &s, uint32_t stride, const float *data_in, uint32_t size_in,
+																	float *data_out, uint32_t size_out);
+	static uint32_t stage_calculate_size_in(stage &s, uint32_t size_out);
+	static uint32_t stage_calculate_size_out(stage &s, uint32_t size_in);
+	static float stage_get_latency_in(stage &s);
+	static double stage_get_ratio(stage &s);
+	static uint32_t stage_get_filter_length(stage &s);
+	static float stage_get_filter_delay(stage &s);
+
+	// Makes sure that the output buffer of a stage has the right layout and can hold at least 'capacity' samples.
+	// If the layout changes, the buffer is cleared.
+	static void prepare_buffer(stage &s, bool interleaved, uint32_t stride, uint32_t capacity);
+
+	// Removes samples from the start of the output buffer of a stage.
+	static void consume_buffer(stage &s, uint32_t count);
+
+	// Calculates how much data each stage should produce to get 'size_out' samples at the output of the last stage.
+	void calculate_requests(uint32_t size_out);
+
+	// Runs the planar path. If 'device_out' is not null, the last stage writes interleaved frames in the given sample
+	// format to 'device_out' instead of writing to 'data_out'.
+	std::pair<uint32_t, uint32_t> resample_planar(uint32_t channels, const float * const *data_in, uint32_t size_in,
+												  float * const *data_out, lowrider_sample_format format, void *device_out,
+												  uint32_t size_out);
+
+public:
+	// Maximum number of half-band stages.
+	static constexpr uint32_t HALFBAND_STAGES_MAX = 8;
+
+	// Minimum downsampling ratio for half-band decimation stages.
+	static constexpr uint32_t HALFBAND_DECIMATE_RATIO_MIN = 8;
+
+	// The images of the trim resampler fold back into the passband with only the minimum stopband attenuation, rather than
+	// the average attenuation, so the trim resampler uses a slightly higher beta to get the same SNR.
+	static constexpr float TRIM_BETA_EXTRA = 2.0f;
+
+	// The passband ripple of the half-band filters adds directly to the error of the main resampler, and their aliases
+	// also fold back into the passband, so they use a higher beta. The half-band filters are short, so this is cheap.
+	static constexpr float HALFBAND_BETA_EXTRA = 4.0f;
+
+	// Minimum filter length of the polyphase engine for which the auto engine selects the FFT engine. Below about 800 taps
+	// the FFT engine is not reliably faster, the gain is only clear for filters of about 1000 taps and longer.
+	static constexpr uint32_t FFT_FILTER_LENGTH_MIN = 1024;
+
+public:
+	// Creates the resampler chain. The auto engine is resolved immediately, based on the expected number of input samples
+	// per invocation (block_size). If multistage is enabled, half-band stages are added for large ratios. The remaining
+	// parameters are the same as for lowrider_resampler. The interpolation method is only used for the variable-rate
+	// resampler. The number of taps is only used by the Farrow engine.
+	lowrider_resampler_chain(uint32_t rate_in, uint32_t rate_out, lowrider_resampler_engine engine, bool multistage, uint32_t block_size,
+							 float passband, float stopband, float beta, float gain,
+							 lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, uint32_t farrow_taps,
+							 const std::string &cache_dir);
+
+	// See lowrider_resampler.
+	void reset();
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+										   float * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+													   float *data_out, uint32_t size_out);
+	uint32_t calculate_size_in(uint32_t size_out);
+	uint32_t calculate_size_out(uint32_t size_in);
+	float get_latency_in();
+	float get_latency_out();
+	double get_ratio();
+
+	// Allocates the buffers between the stages for the given layout (planar or interleaved, as used by resample() and
+	// resample_interleaved() respectively), large enough for requests of up to 'size_out' output samples at the current
+	// ratio, so resampling doesn't allocate memory afterwards. 'stride' is the number of channels for planar data.
+	void reserve(uint32_t size_out, bool interleaved, uint32_t stride);
+
+	// Changes the storage format of the filter banks of all resampler stages (see lowrider_resampler::set_storage). The
+	// half-band filters are very short, so they always use float coefficients.
+	void set_storage(lowrider_resampler_storage storage);
+
+	// Returns whether the fixed-point path can be used, i.e. whether the chain consists of a single resampler.
+	bool supports_fixed_point();
+
+	// Returns whether resample_device can be used, i.e. whether the last stage is a resampler with f32 storage.
+	bool supports_device_output();
+
+	// See lowrider_resampler. This can only be used if supports_device_output returns true.
+	std::pair<uint32_t, uint32_t> resample_device(uint32_t channels, const float * const *data_in, uint32_t size_in,
+												  lowrider_sample_format format, void *data_out, uint32_t size_out);
+
+	// See lowrider_resampler. These can only be used if supports_fixed_point returns true.
+	void prepare_fixed_point(lowrider_resampler_fixed_point type);
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const int16_t * const *data_in, uint32_t size_in,
+										   int16_t * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const int32_t * const *data_in, uint32_t size_in,
+										   int32_t * const *data_out, uint32_t size_out);
+
+	// Changes the total resampling ratio. Only the ratio of the variable-rate resampler is changed, so for the rational
+	// engine and in multistage mode, the ratio should stay close to the nominal ratio.
+	void set_ratio(double ratio);
+
+	// Returns the filter length of the first stage, i.e. the amount of input data that must be kept for the next
+	// invocation.
+	uint32_t get_filter_length();
+
+	// Returns the combined group delay at DC of all stages, in input samples (see lowrider_resampler::get_filter_delay).
+	float get_filter_delay();
+
+	// Returns the engine that is used (never auto).
+	lowrider_resampler_engine get_engine();
+
+	// Returns the number of stages and the stages themselves, in processing order. Each stage is either a resampler, a
+	// half-band filter, an FFT filter, a Farrow resampler or a slip resampler, the other pointers are null.
+	uint32_t get_stage_count();
+	lowrider_resampler* get_stage_resampler(uint32_t stage);
+	lowrider_halfband* get_stage_halfband(uint32_t stage);
+	lowrider_fft_filter* get_stage_fft_filter(uint32_t stage);
+	lowrider_farrow* get_stage_farrow(uint32_t stage);
+	lowrider_slip* get_stage_slip(uint32_t stage);
+
+	// Returns the engine that would be used for the given sample rates, filter parameters and block size.
+	static lowrider_resampler_engine resolve_engine(uint32_t rate_in, uint32_t rate_out, lowrider_resampler_engine engine, bool multistage,
+													uint32_t block_size, float passband, float stopband, float beta, lowrider_resampler_phase phase);
+
+	// Returns the number of half-band decimation or interpolation stages for the given sample rates in multistage mode.
+	static uint32_t get_halfband_decimate_stages(uint32_t rate_in, uint32_t rate_out);
+	static uint32_t get_halfband_interpolate_stages(uint32_t rate_in, uint32_t rate_out);
+
+};
+
+// Returns a human-readable name for a resampler engine.
+const char* get_resampler_engine_name(lowrider_resampler_engine engine);
@@ -0,0 +1,43 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resampler_kernels.h"
+
+const lowrider_resampler_kernels& get_resampler_kernels() {
+	static const lowrider_resampler_kernels &kernels = *get_supported_resampler_kernels().back();
+	return kernels;
+}
+
+std::vector<const lowrider_resampler_kernels*> get_supported_resampler_kernels() {
+	std::vector<const lowrider_resampler_kernels*> res;
+	res.push_back(&g_resampler_kernels_scalar);
+#if LOWRIDER_RESAMPLER_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse2")) {
+		res.push_back(&g_resampler_kernels_sse2);
+	}
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+		res.push_back(&g_resampler_kernels_avx2);
+	}
+	if(__builtin_cpu_supports("avx512f")) {
+		res.push_back(&g_resampler_kernels_avx512);
+	}
+#endif
+	return res;
+}
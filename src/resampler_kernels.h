@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "resampler_types.h"
+#include "sample_format.h"
+
+#include <cstdint>
+
+#include <vector>
+
+// The x86 kernels are only built when assembly is enabled and the target is x86. This must match src/CMakeLists.txt.
+#if LOWRIDER_ENABLE_ASM && (defined(__x86_64__) || defined(__i386__))
+#define LOWRIDER_RESAMPLER_X86 1
+#else
+#define LOWRIDER_RESAMPLER_X86 0
+#endif
+
+// Calculates one output sample for each channel, using a filter that is interpolated between consecutive rows of the
+// filter bank. 'coef' points to the first row, the number of rows and the meaning of the weights depend on the
+// interpolation method:
+// - linear: 2 rows, filter = row0 + (row1 - row0) * weights[0]
+// - cubic:  4 rows, filter = row0 * weights[0] + row1 * weights[1] + row2 * weights[2] + row3 * weights[3]
+// - none:   1 row, filter = row0 (the weights are not used)
+// The coefficients are stored in the format that corresponds to the table entry (see lowrider_resampler_storage), i.e.
+// 'coef' points to floats for f32 and to 16-bit values for f16 and bf16. They are converted to float while loading.
+// If 'reverse' is true, the rows are mirrored images of rows stored in the filter bank and are read backwards: 'coef'
+// points to the last coefficient of the first row, and coefficient i of row k is located at coef[-k * filter_length - i].
+// The filter length must be a multiple of 4.
+typedef void (*lowrider_firfilter_func)(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+										const float * const *data_in, uint32_t pos_in,
+										float * const *data_out, uint32_t pos_out);
+
+// Same as lowrider_firfilter_func, but for interleaved data. Sample c of frame i is located at data_in[i * stride + c],
+// and the output frame is written to data_out[c]. All 'stride' lanes are calculated, so padding channels should contain
+// valid (preferably zero) data. The stride must be a multiple of INTERLEAVED_ALIGN (see below). The interpolated filter
+// is stored in coef_temp, which must have room for the filter length rounded up to a multiple of INTERLEAVED_ALIGN.
+typedef void (*lowrider_firfilter_interleaved_func)(uint32_t stride, uint32_t filter_length,
+													const void *coef, const float *weights, bool reverse, float *coef_temp,
+													const float *data_in, float *data_out);
+
+// Applies a single filter to consecutive positions of one channel: data_out[m] = sum_i coef[i] * data_in[m + i] for
+// m < count. This is vectorized across the outputs rather than across the taps, so it is also efficient for very short
+// filters. It is used by the half-band filters.
+typedef void (*lowrider_convolve_func)(uint32_t filter_length, const float *coef, const float *data_in, float *data_out, uint32_t count);
+
+// Fixed-point versions of lowrider_firfilter_func for planar int16 or int32 data and a filter bank with integer
+// coefficients of the same size. The rows are never mirrored, so there is no 'reverse' flag. Each row is applied to the
+// data separately with exact integer accumulation (32-bit for int16, 64-bit for int32, which is what pmaddwd and pmuldq
+// do), then the results are combined with the weights, multiplied by 'scale', rounded and saturated. The caller must make
+// sure that the accumulator can't overflow, i.e. the sum of the absolute values of the coefficients of every row times
+// the largest sample magnitude must fit in the accumulator. The filter length must be a multiple of 4.
+typedef void (*lowrider_firfilter_s16_func)(uint32_t channels, uint32_t filter_length, const int16_t *coef, const float *weights, float scale,
+											const int16_t * const *data_in, uint32_t pos_in,
+											int16_t * const *data_out, uint32_t pos_out);
+typedef void (*lowrider_firfilter_s32_func)(uint32_t channels, uint32_t filter_length, const int32_t *coef, const float *weights, float scale,
+											const int32_t * const *data_in, uint32_t pos_in,
+											int32_t * const *data_out, uint32_t pos_out);
+
+// Converts 'size' interleaved frames in a device sample format to positions [pos_out, pos_out + size) of planar float
+// data. Integer samples are scaled to the range [-1, 1).
+typedef void (*lowrider_convert_in_func)(uint32_t channels, const void *data_in, float * const *data_out, uint32_t pos_out, uint32_t size);
+
+// Converts positions [pos_in, pos_in + size) of planar float data to interleaved frames in a device sample format.
+// Integer samples are saturated and rounded to nearest (ties to even). Float samples are copied without clipping.
+typedef void (*lowrider_convert_out_func)(uint32_t channels, const float * const *data_in, uint32_t pos_in, void *data_out, uint32_t size);
+
+// Same as lowrider_firfilter_func for a filter bank with f32 storage, but the output frame is converted to a device
+// sample format (like lowrider_convert_out_func) and written as an interleaved frame to data_out. This avoids a separate
+// conversion pass over the output.
+typedef void (*lowrider_firfilter_device_func)(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+											   const float * const *data_in, uint32_t pos_in, void *data_out);
+
+// The tables are indexed by interpolation method. The floating point tables are additionally indexed by storage format
+// (first index), and the firfilter table is also indexed by channel count (last index). Entry 0 accepts any channel count,
+// the other entries are specialized for one particular channel count (or equal to entry 0 if there is no specialization).
+// The conversion tables and the device firfilter table are indexed by sample format (see lowrider_sample_format, the
+// entry for 'any' is nullptr) and channel count in the same way.
+struct lowrider_resampler_kernels {
+	static constexpr uint32_t STORAGE_COUNT = 3;
+	static constexpr uint32_t INTERPOLATION_COUNT = 3;
+	static constexpr uint32_t FIRFILTER_CHANNELS_MAX = 8;
+	static constexpr uint32_t INTERLEAVED_ALIGN = 16; // widest vector size of all kernels
+	static constexpr uint32_t FORMAT_COUNT = 6;
+	static constexpr uint32_t CONVERT_CHANNELS_MAX = 8;
+	const char *name;
+	lowrider_firfilter_func firfilter[STORAGE_COUNT][INTERPOLATION_COUNT][FIRFILTER_CHANNELS_MAX + 1];
+	lowrider_firfilter_interleaved_func firfilter_interleaved[STORAGE_COUNT][INTERPOLATION_COUNT];
+	lowrider_convolve_func convolve;
+	lowrider_firfilter_s16_func firfilter_s16[INTERPOLATION_COUNT];
+	lowrider_firfilter_s32_func firfilter_s32[INTERPOLATION_COUNT];
+	lowrider_firfilter_device_func firfilter_device[FORMAT_COUNT][INTERPOLATION_COUNT][FIRFILTER_CHANNELS_MAX + 1];
+	lowrider_convert_in_func convert_in[FORMAT_COUNT][CONVERT_CHANNELS_MAX + 1];
+	lowrider_convert_out_func convert_out[FORMAT_COUNT][CONVERT_CHANNELS_MAX + 1];
+};
+
+// Portable reference implementation.
+extern const lowrider_resampler_kernels g_resampler_kernels_scalar;
+
+#if LOWRIDER_RESAMPLER_X86
+extern const lowrider_resampler_kernels g_resampler_kernels_sse2;
+extern const lowrider_resampler_kernels g_resampler_kernels_avx2;
+extern const lowrider_resampler_kernels g_resampler_kernels_avx512;
+#endif
+
+// Returns the fastest set of kernels supported by the current CPU. The CPU is only checked once.
+const lowrider_resampler_kernels& get_resampler_kernels();
+
+// Returns all sets of kernels supported by the current CPU, starting with the scalar reference implementation.
+std::vector<const lowrider_resampler_kernels*> get_supported_resampler_kernels();
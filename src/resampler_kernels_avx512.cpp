@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resampler_kernels.h"
+#include "resampler_kernels_impl.h"
+
+#include <immintrin.h>
+
+namespace {
+
+// sliding window of masks for the 256-bit loads of 16-bit values
+alignas(32) const int32_t g_tail_masks[24] = {0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+struct simd_avx512 {
+	typedef __m512 vec;
+	static constexpr uint32_t WIDTH = 16;
+	static inline vec zero() { return _mm512_setzero_ps(); }
+	static inline vec set1(float x) { return _mm512_set1_ps(x); }
+	static inline vec load(const float *ptr) { return _mm512_loadu_ps(ptr); }
+	static inline vec load_tail(const float *ptr, uint32_t n) { return _mm512_maskz_loadu_ps((__mmask16) ((1u << n) - 1), ptr); }
+	static inline vec load_reverse(const float *ptr) {
+		return _mm512_permutexvar_ps(_mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_loadu_ps(ptr - 15));
+	}
+	static inline vec load_tail_reverse(const float *ptr, uint32_t n) {
+		// masked out lanes are never accessed, so this can't read outside the row
+		__m512 a = _mm512_maskz_loadu_ps((__mmask16) (((1u << n) - 1) << (16 - n)), ptr - 15);
+		return _mm512_permutexvar_ps(_mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), a);
+	}
+	static inline void store(float *ptr, vec a) { _mm512_storeu_ps(ptr, a); }
+	static inline vec add(vec a, vec b) { return _mm512_add_ps(a, b); }
+	static inline vec sub(vec a, vec b) { return _mm512_sub_ps(a, b); }
+	static inline vec mul(vec a, vec b) { return _mm512_mul_ps(a, b); }
+	static inline vec fmadd(vec a, vec b, vec c) { return _mm512_fmadd_ps(a, b, c); }
+	static inline float hsum(vec a) { return _mm512_reduce_add_ps(a); }
+	typedef __m256i half;
+	static inline half load_half(const uint16_t *ptr) { return _mm256_loadu_si256((const __m256i*) ptr); }
+	static inline half load_half_tail(const uint16_t *ptr, uint32_t n) {
+		return _mm256_maskload_epi32((const int*) ptr, _mm256_loadu_si256((const __m256i*) (g_tail_masks + 16 - n / 2)));
+	}
+	static inline half load_half_tail_reverse(const uint16_t *ptr, uint32_t n) {
+		// masked out lanes are never accessed, so this can't read outside the row
+		return _mm256_maskload_epi32((const int*) ptr, _mm256_loadu_si256((const __m256i*) (g_tail_masks + n / 2)));
+	}
+	static inline vec widen_f16(half h) { return _mm512_cvtph_ps(h); }
+	static inline vec widen_bf16(half h) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16)); }
+	static inline vec reverse(vec a) {
+		return _mm512_permutexvar_ps(_mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), a);
+	}
+};
+
+// 512-bit pmaddwd requires AVX-512BW, so int16 data uses 256-bit vectors.
+struct integer_avx512_s16 {
+	typedef int16_t sample;
+	typedef int32_t acc;
+	typedef float real;
+	typedef __m256i vec;
+	static constexpr uint32_t WIDTH = 16;
+	static inline vec zero() { return _mm256_setzero_si256(); }
+	static inline vec load(const sample *ptr) { return _mm256_loadu_si256((const __m256i*) ptr); }
+	static inline vec load_tail(const sample *ptr, uint32_t n) {
+		return _mm256_maskload_epi32((const int*) ptr, _mm256_loadu_si256((const __m256i*) (g_tail_masks + 16 - n / 2)));
+	}
+	static inline vec madd(vec sum, vec a, vec b) { return _mm256_add_epi32(sum, _mm256_madd_epi16(a, b)); }
+	static inline vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+	static inline acc hsum(vec a) {
+		__m128i b = _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+		b = _mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtsi128_si32(_mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+};
+
+// See integer_avx2_s32.
+struct integer_avx512_s32 {
+	typedef int32_t sample;
+	typedef int64_t acc;
+	typedef double real;
+	typedef __m512i vec;
+	static constexpr uint32_t WIDTH = 16;
+	static inline vec zero() { return _mm512_setzero_si512(); }
+	static inline vec load(const sample *ptr) { return _mm512_loadu_si512(ptr); }
+	static inline vec load_tail(const sample *ptr, uint32_t n) { return _mm512_maskz_loadu_epi32((__mmask16) ((1u << n) - 1), ptr); }
+	static inline vec madd(vec sum, vec a, vec b) {
+		sum = _mm512_add_epi64(sum, _mm512_mul_epi32(a, b));
+		return _mm512_add_epi64(sum, _mm512_mul_epi32(_mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32)));
+	}
+	static inline vec add(vec a, vec b) { return _mm512_add_epi64(a, b); }
+	static inline acc hsum(vec a) { return _mm512_reduce_add_epi64(a); }
+};
+
+// See load8_s24_3le in resampler_kernels_avx2.cpp. AVX-512F has no byte shuffles for 512-bit vectors, so the packed
+// 24-bit samples are handled in 256-bit halves.
+inline __m256i load8_s24_3le(const uint8_t *ptr) {
+	__m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) ptr), _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11));
+	__m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (ptr + 8)), _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15));
+	return _mm256_srai_epi32(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), 8);
+}
+inline void store4_s24_3le(uint8_t *ptr, __m128i x) {
+	x = _mm_shuffle_epi8(x, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+	_mm_storel_epi64((__m128i*) ptr, x);
+	int32_t tail = _mm_extract_epi32(x, 2);
+	memcpy(ptr + 8, &tail, sizeof(tail));
+}
+inline void store8_s24_3le(uint8_t *ptr, __m256i x) {
+	store4_s24_3le(ptr, _mm256_castsi256_si128(x));
+	store4_s24_3le(ptr + 12, _mm256_extracti128_si256(x, 1));
+}
+
+struct convert_avx512 {
+	typedef __m512 vec;
+	static constexpr uint32_t WIDTH = 16;
+	static inline vec set1(float x) { return _mm512_set1_ps(x); }
+	static inline vec mul(vec a, vec b) { return _mm512_mul_ps(a, b); }
+	static inline vec min(vec a, vec b) { return _mm512_min_ps(a, b); }
+	static inline vec max(vec a, vec b) { return _mm512_max_ps(a, b); }
+	static inline vec load(const float *ptr) { return _mm512_loadu_ps(ptr); }
+	static inline void store(float *ptr, vec a) { _mm512_storeu_ps(ptr, a); }
+	static inline vec load_s32(const int32_t *ptr) { return _mm512_cvtepi32_ps(_mm512_loadu_si512(ptr)); }
+	static inline vec load_s16(const int16_t *ptr) { return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*) ptr))); }
+	static inline vec load_s24_3le(const uint8_t *ptr) {
+		return _mm512_cvtepi32_ps(_mm512_inserti64x4(_mm512_castsi256_si512(load8_s24_3le(ptr)), load8_s24_3le(ptr + 24), 1));
+	}
+	static inline void store_s32(int32_t *ptr, vec a) { _mm512_storeu_si512(ptr, _mm512_cvtps_epi32(a)); }
+	static inline void store_s16(int16_t *ptr, vec a) { _mm256_storeu_si256((__m256i*) ptr, _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(a))); }
+	static inline void store_s24_3le(uint8_t *ptr, vec a) {
+		__m512i x = _mm512_cvtps_epi32(a);
+		store8_s24_3le(ptr, _mm512_castsi512_si256(x));
+		store8_s24_3le(ptr + 24, _mm512_extracti64x4_epi64(x, 1));
+	}
+};
+
+}
+
+const lowrider_resampler_kernels g_resampler_kernels_avx512 = {
+	"avx512",
+	LOWRIDER_FIRFILTER_TABLE(simd_avx512),
+	LOWRIDER_FIRFILTER_INTERLEAVED_TABLE(simd_avx512),
+	convolve<simd_avx512>,
+	LOWRIDER_FIRFILTER_INTEGER_TABLE(integer_avx512_s16),
+	LOWRIDER_FIRFILTER_INTEGER_TABLE(integer_avx512_s32),
+	LOWRIDER_FIRFILTER_DEVICE_TABLE(simd_avx512),
+	LOWRIDER_CONVERT_TABLE(convert_avx512, convert_in),
+	LOWRIDER_CONVERT_TABLE(convert_avx512, convert_out),
+};
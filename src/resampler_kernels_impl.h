@@ -0,0 +1,818 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "resampler_kernels.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <limits>
+
+/*
+Generic kernel implementations, written in terms of a small vector abstraction V which must provide:
+- vec: the vector type
+- WIDTH: the number of floats in a vector
+- zero(), set1(x): create a vector
+- load(ptr): unaligned load of WIDTH floats
+- load_tail(ptr, n): unaligned load of n floats (n < WIDTH, n % 4 == 0), the remaining lanes are zero
+- load_reverse(ptr): unaligned load of ptr[0], ptr[-1], ..., ptr[-(WIDTH - 1)]
+- load_tail_reverse(ptr, n): same as load_reverse but only n floats (n < WIDTH, n % 4 == 0), the remaining lanes are zero
+- store(ptr, a): unaligned store of WIDTH floats
+- add(a, b), sub(a, b), mul(a, b), fmadd(a, b, c): arithmetic, fmadd calculates a * b + c
+- hsum(a): horizontal sum
+- half: a vector type that holds WIDTH 16-bit values
+- load_half(ptr): unaligned load of WIDTH 16-bit values
+- load_half_tail(ptr, n): unaligned load of n 16-bit values (n < WIDTH, n % 4 == 0), the remaining lanes are zero
+- load_half_tail_reverse(ptr, n): unaligned load of the last n of WIDTH 16-bit values, the remaining lanes are zero
+- widen_f16(h), widen_bf16(h): convert 16-bit values to floats
+- reverse(a): reverse the order of the lanes
+
+The fixed-point kernels use a separate abstraction I, which must provide:
+- sample, acc, real: the sample type, the accumulator type and the floating point type used to combine the rows
+- vec: the vector type, which holds samples as well as accumulators
+- WIDTH: the number of samples in a vector
+- zero(): create a vector
+- load(ptr): unaligned load of WIDTH samples
+- load_tail(ptr, n): unaligned load of n samples (n < WIDTH, n % 4 == 0), the remaining lanes are zero
+- madd(sum, a, b): multiplies the samples and adds the products to the accumulators (adjacent products may be added to
+  the same accumulator, like pmaddwd)
+- add(a, b): adds accumulators
+- hsum(a): horizontal sum of the accumulators
+
+The conversion kernels use a third abstraction C, which must provide:
+- vec: the vector type
+- WIDTH: the number of floats in a vector
+- set1(x), mul(a, b), min(a, b), max(a, b): create a vector, arithmetic
+- load(ptr), store(ptr, a): unaligned load or store of WIDTH floats
+- load_s32(ptr), load_s16(ptr), load_s24_3le(ptr): unaligned load of WIDTH integer samples, converted to float
+- store_s32(ptr, a), store_s16(ptr, a), store_s24_3le(ptr, a): rounds WIDTH floats to nearest (ties to even, like
+  lrint) and stores them as integer samples, the values must be within the range of the sample type
+
+This file is included by each of the ISA-specific source files, which are compiled with different compiler flags. Everything
+is kept in an anonymous namespace so the linker can never merge instantiations that were compiled for different ISAs.
+*/
+
+namespace {
+
+// Storage type of the coefficients for each storage format.
+template<lowrider_resampler_storage STORAGE>
+struct storage_type {
+	typedef uint16_t type;
+};
+template<>
+struct storage_type<lowrider_resampler_storage_f32> {
+	typedef float type;
+};
+
+// Portable conversions from 16-bit values to float. The f16 conversion moves the exponent and mantissa to the float
+// position and then corrects the exponent bias with a multiplication by 2^112, which also handles denormals exactly.
+// Infinity and NaN are not supported, filter coefficients are always finite.
+inline float bits_to_float(uint32_t x) {
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+inline float f16_to_float(uint16_t h) {
+	float f = bits_to_float((uint32_t) (h & 0x7fff) << 13) * bits_to_float(0x77800000);
+	return (h & 0x8000)? -f : f;
+}
+inline float bf16_to_float(uint16_t h) {
+	return bits_to_float((uint32_t) h << 16);
+}
+
+// Loads n coefficients starting at coefficient i of a row and converts them to float. Reversed rows are read backwards
+// from the row pointer.
+template<class V, lowrider_resampler_storage STORAGE, bool REVERSE>
+inline typename V::vec load_row(const float *row, uint32_t i, uint32_t n) {
+	if(REVERSE) {
+		return (n == V::WIDTH)? V::load_reverse(row - i) : V::load_tail_reverse(row - i, n);
+	} else {
+		return (n == V::WIDTH)? V::load(row + i) : V::load_tail(row + i, n);
+	}
+}
+template<class V, lowrider_resampler_storage STORAGE, bool REVERSE>
+inline typename V::vec load_row(const uint16_t *row, uint32_t i, uint32_t n) {
+	typename V::half h;
+	if(REVERSE) {
+		const uint16_t *ptr = row - i - (V::WIDTH - 1);
+		h = (n == V::WIDTH)? V::load_half(ptr) : V::load_half_tail_reverse(ptr, n);
+	} else {
+		h = (n == V::WIDTH)? V::load_half(row + i) : V::load_half_tail(row + i, n);
+	}
+	typename V::vec x = (STORAGE == lowrider_resampler_storage_f16)? V::widen_f16(h) : V::widen_bf16(h);
+	return (REVERSE)? V::reverse(x) : x;
+}
+
+// Linear interpolation between two consecutive rows: coef = row0 + (row1 - row0) * weights[0].
+template<class V, lowrider_resampler_storage STORAGE, bool REVERSE>
+struct interp_linear {
+	typedef typename storage_type<STORAGE>::type type;
+	const type *m_row0, *m_row1;
+	typename V::vec m_frac;
+	inline interp_linear(uint32_t filter_length, const void *coef, const float *weights) {
+		int32_t step = (REVERSE)? -(int32_t) filter_length : (int32_t) filter_length;
+		m_row0 = (const type*) coef;
+		m_row1 = m_row0 + step;
+		m_frac = V::set1(weights[0]);
+	}
+	inline typename V::vec get(uint32_t i, uint32_t n) const {
+		typename V::vec c0 = load_row<V, STORAGE, REVERSE>(m_row0, i, n), c1 = load_row<V, STORAGE, REVERSE>(m_row1, i, n);
+		return V::fmadd(V::sub(c1, c0), m_frac, c0);
+	}
+};
+
+// Cubic interpolation between four consecutive rows: coef = sum(row[k] * weights[k]).
+template<class V, lowrider_resampler_storage STORAGE, bool REVERSE>
+struct interp_cubic {
+	typedef typename storage_type<STORAGE>::type type;
+	const type *m_row0, *m_row1, *m_row2, *m_row3;
+	typename V::vec m_weight0, m_weight1, m_weight2, m_weight3;
+	inline interp_cubic(uint32_t filter_length, const void *coef, const float *weights) {
+		int32_t step = (REVERSE)? -(int32_t) filter_length : (int32_t) filter_length;
+		m_row0 = (const type*) coef;
+		m_row1 = m_row0 + step;
+		m_row2 = m_row0 + 2 * step;
+		m_row3 = m_row0 + 3 * step;
+		m_weight0 = V::set1(weights[0]);
+		m_weight1 = V::set1(weights[1]);
+		m_weight2 = V::set1(weights[2]);
+		m_weight3 = V::set1(weights[3]);
+	}
+	inline typename V::vec get(uint32_t i, uint32_t n) const {
+		typename V::vec sum = V::mul(load_row<V, STORAGE, REVERSE>(m_row0, i, n), m_weight0);
+		sum = V::fmadd(load_row<V, STORAGE, REVERSE>(m_row1, i, n), m_weight1, sum);
+		sum = V::fmadd(load_row<V, STORAGE, REVERSE>(m_row2, i, n), m_weight2, sum);
+		return V::fmadd(load_row<V, STORAGE, REVERSE>(m_row3, i, n), m_weight3, sum);
+	}
+};
+
+// No interpolation, the filter is a single row: coef = row0.
+template<class V, lowrider_resampler_storage STORAGE, bool REVERSE>
+struct interp_none {
+	typedef typename storage_type<STORAGE>::type type;
+	const type *m_row0;
+	inline interp_none(uint32_t filter_length, const void *coef, const float *weights) {
+		(void) filter_length;
+		(void) weights;
+		m_row0 = (const type*) coef;
+	}
+	inline typename V::vec get(uint32_t i, uint32_t n) const {
+		return load_row<V, STORAGE, REVERSE>(m_row0, i, n);
+	}
+};
+
+// Calculates one output sample for a fixed number of channels and stores it in result. Each interpolated coefficient is
+// calculated only once and then applied to all channels.
+template<class V, class Interp, uint32_t CHANNELS>
+inline void firfilter_sums(uint32_t filter_length, const void *coef, const float *weights,
+						   const float * const *data_in, uint32_t pos_in, float *result) {
+	assert(filter_length % 4 == 0);
+	Interp interp(filter_length, coef, weights);
+	const float *data[CHANNELS];
+	typename V::vec sum[CHANNELS];
+	for(uint32_t c = 0; c < CHANNELS; ++c) {
+		data[c] = data_in[c] + pos_in;
+		sum[c] = V::zero();
+	}
+	uint32_t i = 0;
+	for( ; i + V::WIDTH <= filter_length; i += V::WIDTH) {
+		typename V::vec vcoef = interp.get(i, V::WIDTH);
+		for(uint32_t c = 0; c < CHANNELS; ++c) {
+			sum[c] = V::fmadd(V::load(data[c] + i), vcoef, sum[c]);
+		}
+	}
+	if(V::WIDTH > 4 && i < filter_length) {
+		uint32_t n = filter_length - i;
+		typename V::vec vcoef = interp.get(i, n);
+		for(uint32_t c = 0; c < CHANNELS; ++c) {
+			sum[c] = V::fmadd(V::load_tail(data[c] + i, n), vcoef, sum[c]);
+		}
+	}
+	for(uint32_t c = 0; c < CHANNELS; ++c) {
+		result[c] = V::hsum(sum[c]);
+	}
+}
+
+template<class V, class Interp, uint32_t CHANNELS>
+inline void firfilter_block(uint32_t filter_length, const void *coef, const float *weights,
+							const float * const *data_in, uint32_t pos_in, float * const *data_out, uint32_t pos_out) {
+	float result[CHANNELS];
+	firfilter_sums<V, Interp, CHANNELS>(filter_length, coef, weights, data_in, pos_in, result);
+	for(uint32_t c = 0; c < CHANNELS; ++c) {
+		data_out[c][pos_out] = result[c];
+	}
+}
+
+// Handles any number of channels by splitting them into blocks of at most 8 channels.
+template<class V, class Interp>
+void firfilter_channels(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights,
+						const float * const *data_in, uint32_t pos_in, float * const *data_out, uint32_t pos_out) {
+	uint32_t c = 0;
+	for( ; c + 8 <= channels; c += 8) {
+		firfilter_block<V, Interp, 8>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out);
+	}
+	switch(channels - c) {
+		case 0: break;
+		case 1: firfilter_block<V, Interp, 1>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		case 2: firfilter_block<V, Interp, 2>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		case 3: firfilter_block<V, Interp, 3>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		case 4: firfilter_block<V, Interp, 4>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		case 5: firfilter_block<V, Interp, 5>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		case 6: firfilter_block<V, Interp, 6>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		case 7: firfilter_block<V, Interp, 7>(filter_length, coef, weights, data_in + c, pos_in, data_out + c, pos_out); break;
+		default: assert(false);
+	}
+}
+
+template<class V, template<class, lowrider_resampler_storage, bool> class Interp, lowrider_resampler_storage STORAGE, uint32_t CHANNELS>
+void firfilter_fixed(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+					 const float * const *data_in, uint32_t pos_in, float * const *data_out, uint32_t pos_out) {
+	assert(channels == CHANNELS);
+	(void) channels;
+	if(reverse) {
+		firfilter_block<V, Interp<V, STORAGE, true>, CHANNELS>(filter_length, coef, weights, data_in, pos_in, data_out, pos_out);
+	} else {
+		firfilter_block<V, Interp<V, STORAGE, false>, CHANNELS>(filter_length, coef, weights, data_in, pos_in, data_out, pos_out);
+	}
+}
+
+template<class V, template<class, lowrider_resampler_storage, bool> class Interp, lowrider_resampler_storage STORAGE>
+void firfilter_generic(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+					   const float * const *data_in, uint32_t pos_in, float * const *data_out, uint32_t pos_out) {
+	if(reverse) {
+		firfilter_channels<V, Interp<V, STORAGE, true>>(channels, filter_length, coef, weights, data_in, pos_in, data_out, pos_out);
+	} else {
+		firfilter_channels<V, Interp<V, STORAGE, false>>(channels, filter_length, coef, weights, data_in, pos_in, data_out, pos_out);
+	}
+}
+
+// Calculates one output frame for a block of VECTORS * V::WIDTH interleaved channels. Each lane of each vector is a
+// separate channel, so every coefficient is broadcast once and then applied to the entire block.
+template<class V, uint32_t VECTORS>
+inline void firfilter_interleaved_block(uint32_t stride, uint32_t filter_length, const float *coef,
+										const float *data_in, float *data_out) {
+	// With few vectors, two taps are processed in parallel to hide the latency of the accumulation.
+	constexpr uint32_t TAPS = (VECTORS <= 4)? 2 : 1;
+	typename V::vec sum[TAPS][VECTORS];
+	for(uint32_t t = 0; t < TAPS; ++t) {
+		for(uint32_t k = 0; k < VECTORS; ++k) {
+			sum[t][k] = V::zero();
+		}
+	}
+	for(uint32_t i = 0; i < filter_length; i += TAPS) {
+		for(uint32_t t = 0; t < TAPS; ++t) {
+			typename V::vec vcoef = V::set1(coef[i + t]);
+			const float *data = data_in + (i + t) * stride;
+			for(uint32_t k = 0; k < VECTORS; ++k) {
+				sum[t][k] = V::fmadd(V::load(data + k * V::WIDTH), vcoef, sum[t][k]);
+			}
+		}
+	}
+	for(uint32_t k = 0; k < VECTORS; ++k) {
+		typename V::vec total = sum[0][k];
+		for(uint32_t t = 1; t < TAPS; ++t) {
+			total = V::add(total, sum[t][k]);
+		}
+		V::store(data_out + k * V::WIDTH, total);
+	}
+}
+
+// Stores the interpolated filter in coef_temp.
+template<class V, class Interp>
+inline void interpolate_filter(uint32_t filter_length, const void *coef, const float *weights, float *coef_temp) {
+	Interp interp(filter_length, coef, weights);
+	for(uint32_t i = 0; i < filter_length; i += V::WIDTH) {
+		V::store(coef_temp + i, interp.get(i, (V::WIDTH > 4 && i + V::WIDTH > filter_length)? filter_length - i : V::WIDTH));
+	}
+}
+
+template<class V, template<class, lowrider_resampler_storage, bool> class Interp, lowrider_resampler_storage STORAGE>
+void firfilter_interleaved(uint32_t stride, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+						   float *coef_temp, const float *data_in, float *data_out) {
+	assert(filter_length % 4 == 0);
+	assert(stride % V::WIDTH == 0);
+
+	// interpolate the coefficients
+	if(reverse) {
+		interpolate_filter<V, Interp<V, STORAGE, true>>(filter_length, coef, weights, coef_temp);
+	} else {
+		interpolate_filter<V, Interp<V, STORAGE, false>>(filter_length, coef, weights, coef_temp);
+	}
+
+	// apply the filter to blocks of channels
+	uint32_t vectors = stride / V::WIDTH, k = 0;
+	for( ; k + 8 <= vectors; k += 8) {
+		firfilter_interleaved_block<V, 8>(stride, filter_length, coef_temp, data_in + k * V::WIDTH, data_out + k * V::WIDTH);
+	}
+	const float *block_in = data_in + k * V::WIDTH;
+	float *block_out = data_out + k * V::WIDTH;
+	switch(vectors - k) {
+		case 0: break;
+		case 1: firfilter_interleaved_block<V, 1>(stride, filter_length, coef_temp, block_in, block_out); break;
+		case 2: firfilter_interleaved_block<V, 2>(stride, filter_length, coef_temp, block_in, block_out); break;
+		case 3: firfilter_interleaved_block<V, 3>(stride, filter_length, coef_temp, block_in, block_out); break;
+		case 4: firfilter_interleaved_block<V, 4>(stride, filter_length, coef_temp, block_in, block_out); break;
+		case 5: firfilter_interleaved_block<V, 5>(stride, filter_length, coef_temp, block_in, block_out); break;
+		case 6: firfilter_interleaved_block<V, 6>(stride, filter_length, coef_temp, block_in, block_out); break;
+		case 7: firfilter_interleaved_block<V, 7>(stride, filter_length, coef_temp, block_in, block_out); break;
+		default: assert(false);
+	}
+
+}
+
+// Calculates VECTORS * V::WIDTH consecutive outputs of a convolution.
+template<class V, uint32_t VECTORS>
+inline void convolve_block(uint32_t filter_length, const float *coef, const float *data_in, float *data_out) {
+	typename V::vec sum[VECTORS];
+	for(uint32_t k = 0; k < VECTORS; ++k) {
+		sum[k] = V::zero();
+	}
+	for(uint32_t i = 0; i < filter_length; ++i) {
+		typename V::vec vcoef = V::set1(coef[i]);
+		const float *data = data_in + i;
+		for(uint32_t k = 0; k < VECTORS; ++k) {
+			sum[k] = V::fmadd(V::load(data + k * V::WIDTH), vcoef, sum[k]);
+		}
+	}
+	for(uint32_t k = 0; k < VECTORS; ++k) {
+		V::store(data_out + k * V::WIDTH, sum[k]);
+	}
+}
+
+template<class V>
+void convolve(uint32_t filter_length, const float *coef, const float *data_in, float *data_out, uint32_t count) {
+	uint32_t m = 0;
+	for( ; m + 4 * V::WIDTH <= count; m += 4 * V::WIDTH) {
+		convolve_block<V, 4>(filter_length, coef, data_in + m, data_out + m);
+	}
+	for( ; m + V::WIDTH <= count; m += V::WIDTH) {
+		convolve_block<V, 1>(filter_length, coef, data_in + m, data_out + m);
+	}
+	for( ; m < count; ++m) {
+		float sum = 0.0f;
+		for(uint32_t i = 0; i < filter_length; ++i) {
+			sum += coef[i] * data_in[m + i];
+		}
+		data_out[m] = sum;
+	}
+}
+
+// Portable implementation of the fixed-point abstraction, also used when an ISA has no suitable instructions.
+template<typename Sample, typename Acc, typename Real>
+struct integer_scalar {
+	typedef Sample sample;
+	typedef Acc acc;
+	typedef Real real;
+	typedef Acc vec;
+	static constexpr uint32_t WIDTH = 1;
+	static inline vec zero() { return 0; }
+	static inline vec load(const sample *ptr) { return *ptr; }
+	static inline vec load_tail(const sample*, uint32_t) { return 0; }
+	static inline vec madd(vec sum, vec a, vec b) { return sum + a * b; }
+	static inline vec add(vec a, vec b) { return a + b; }
+	static inline acc hsum(vec a) { return a; }
+};
+
+// Calculates the exact dot products of ROWS consecutive rows of the filter bank and the data. The data is loaded only
+// once for all rows.
+template<class I, uint32_t ROWS>
+inline void dot_integer(uint32_t filter_length, const typename I::sample *coef, const typename I::sample *data, typename I::acc *result) {
+	typename I::vec sum[ROWS];
+	for(uint32_t r = 0; r < ROWS; ++r) {
+		sum[r] = I::zero();
+	}
+	uint32_t i = 0;
+	for( ; i + I::WIDTH <= filter_length; i += I::WIDTH) {
+		typename I::vec x = I::load(data + i);
+		for(uint32_t r = 0; r < ROWS; ++r) {
+			sum[r] = I::madd(sum[r], I::load(coef + r * filter_length + i), x);
+		}
+	}
+	if(I::WIDTH > 4 && i < filter_length) {
+		uint32_t n = filter_length - i;
+		typename I::vec x = I::load_tail(data + i, n);
+		for(uint32_t r = 0; r < ROWS; ++r) {
+			sum[r] = I::madd(sum[r], I::load_tail(coef + r * filter_length + i, n), x);
+		}
+	}
+	for(uint32_t r = 0; r < ROWS; ++r) {
+		result[r] = I::hsum(sum[r]);
+	}
+}
+
+// Rounds to the nearest sample value and saturates. This avoids library functions, since they could be merged with
+// instantiations that were compiled for a different ISA.
+template<class I>
+inline typename I::sample round_integer(typename I::real x) {
+	typedef typename I::real R;
+	constexpr R lo = (R) std::numeric_limits<typename I::sample>::min(), hi = (R) std::numeric_limits<typename I::sample>::max();
+	x += (x < (R) 0)? (R) -0.5 : (R) 0.5;
+	x = (x < lo)? lo : (x > hi)? hi : x;
+	return (typename I::sample) x;
+}
+
+template<class I, lowrider_resampler_interpolation INTERPOLATION>
+void firfilter_integer(uint32_t channels, uint32_t filter_length, const typename I::sample *coef, const float *weights, float scale,
+					   const typename I::sample * const *data_in, uint32_t pos_in, typename I::sample * const *data_out, uint32_t pos_out) {
+	assert(filter_length % 4 == 0);
+	typedef typename I::real R;
+	for(uint32_t c = 0; c < channels; ++c) {
+		const typename I::sample *data = data_in[c] + pos_in;
+		typename I::acc sum[4];
+		R value = (R) 0;
+		switch(INTERPOLATION) {
+			case lowrider_resampler_interpolation_linear: {
+				dot_integer<I, 2>(filter_length, coef, data, sum);
+				value = (R) sum[0] + ((R) sum[1] - (R) sum[0]) * (R) weights[0];
+				break;
+			}
+			case lowrider_resampler_interpolation_cubic: {
+				dot_integer<I, 4>(filter_length, coef, data, sum);
+				value = (R) sum[0] * (R) weights[0] + (R) sum[1] * (R) weights[1] + (R) sum[2] * (R) weights[2] + (R) sum[3] * (R) weights[3];
+				break;
+			}
+			case lowrider_resampler_interpolation_none: {
+				dot_integer<I, 1>(filter_length, coef, data, sum);
+				value = (R) sum[0];
+				break;
+			}
+		}
+		data_out[c][pos_out] = round_integer<I>(value * (R) scale);
+	}
+}
+
+// Scalar helpers for the conversion abstraction. Rounding uses the builtin rather than a library function, since inline
+// library functions could be merged with instantiations that were compiled for a different ISA (see round_integer).
+inline int32_t round_sample(float x) {
+	return (int32_t) __builtin_lrintf(x);
+}
+inline int32_t unpack_s24_3le(const uint8_t *ptr) {
+	return (int32_t) ((uint32_t) ptr[0] << 8 | (uint32_t) ptr[1] << 16 | (uint32_t) ptr[2] << 24) >> 8;
+}
+inline void pack_s24_3le(uint8_t *ptr, int32_t x) {
+	ptr[0] = (uint8_t) x;
+	ptr[1] = (uint8_t) (x >> 8);
+	ptr[2] = (uint8_t) (x >> 16);
+}
+
+// Portable implementation of the conversion abstraction. It is also used for the channels and frames that don't fill an
+// entire vector.
+struct convert_scalar {
+	typedef float vec;
+	static constexpr uint32_t WIDTH = 1;
+	static inline vec set1(float x) { return x; }
+	static inline vec mul(vec a, vec b) { return a * b; }
+	static inline vec min(vec a, vec b) { return (b < a)? b : a; }
+	static inline vec max(vec a, vec b) { return (a < b)? b : a; }
+	static inline vec load(const float *ptr) { return *ptr; }
+	static inline void store(float *ptr, vec a) { *ptr = a; }
+	static inline vec load_s32(const int32_t *ptr) { return (float) *ptr; }
+	static inline vec load_s16(const int16_t *ptr) { return (float) *ptr; }
+	static inline vec load_s24_3le(const uint8_t *ptr) { return (float) unpack_s24_3le(ptr); }
+	static inline void store_s32(int32_t *ptr, vec a) { *ptr = round_sample(a); }
+	static inline void store_s16(int16_t *ptr, vec a) { *ptr = (int16_t) round_sample(a); }
+	static inline void store_s24_3le(uint8_t *ptr, vec a) { pack_s24_3le(ptr, round_sample(a)); }
+};
+
+// Maps each device sample format to the operations of the conversion abstraction. Integer samples are scaled by SCALE
+// on input and by 1 / SCALE on output, and clamped to [LOW, HIGH] before rounding. The upper limit of S32 is the
+// largest float below 2^31, since 2^31 - 1 can't be represented and would overflow.
+template<class C, lowrider_sample_format FORMAT>
+struct sample_io;
+template<class C>
+struct sample_io<C, lowrider_sample_format_f32> {
+	static constexpr uint32_t BYTES = 4;
+	static constexpr bool CLAMP = false;
+	static constexpr float SCALE = 1.0f, LOW = 0.0f, HIGH = 0.0f;
+	static inline typename C::vec load(const uint8_t *ptr) { return C::load((const float*) ptr); }
+	static inline void store(uint8_t *ptr, typename C::vec a) { C::store((float*) ptr, a); }
+};
+template<class C>
+struct sample_io<C, lowrider_sample_format_s32> {
+	static constexpr uint32_t BYTES = 4;
+	static constexpr bool CLAMP = true;
+	static constexpr float SCALE = 1.0f / 2147483648.0f, LOW = -2147483648.0f, HIGH = 2147483520.0f;
+	static inline typename C::vec load(const uint8_t *ptr) { return C::load_s32((const int32_t*) ptr); }
+	static inline void store(uint8_t *ptr, typename C::vec a) { C::store_s32((int32_t*) ptr, a); }
+};
+template<class C>
+struct sample_io<C, lowrider_sample_format_s24> {
+	static constexpr uint32_t BYTES = 4;
+	static constexpr bool CLAMP = true;
+	static constexpr float SCALE = 1.0f / 8388608.0f, LOW = -8388608.0f, HIGH = 8388607.0f;
+	static inline typename C::vec load(const uint8_t *ptr) { return C::load_s32((const int32_t*) ptr); }
+	static inline void store(uint8_t *ptr, typename C::vec a) { C::store_s32((int32_t*) ptr, a); }
+};
+template<class C>
+struct sample_io<C, lowrider_sample_format_s16> {
+	static constexpr uint32_t BYTES = 2;
+	static constexpr bool CLAMP = true;
+	static constexpr float SCALE = 1.0f / 32768.0f, LOW = -32768.0f, HIGH = 32767.0f;
+	static inline typename C::vec load(const uint8_t *ptr) { return C::load_s16((const int16_t*) ptr); }
+	static inline void store(uint8_t *ptr, typename C::vec a) { C::store_s16((int16_t*) ptr, a); }
+};
+template<class C>
+struct sample_io<C, lowrider_sample_format_s24_3le> {
+	static constexpr uint32_t BYTES = 3;
+	static constexpr bool CLAMP = true;
+	static constexpr float SCALE = 1.0f / 8388608.0f, LOW = -8388608.0f, HIGH = 8388607.0f;
+	static inline typename C::vec load(const uint8_t *ptr) { return C::load_s24_3le(ptr); }
+	static inline void store(uint8_t *ptr, typename C::vec a) { C::store_s24_3le(ptr, a); }
+};
+
+// Converts WIDTH samples from device format to float and back.
+template<class C, lowrider_sample_format FORMAT>
+inline typename C::vec convert_load(const uint8_t *ptr) {
+	typedef sample_io<C, FORMAT> IO;
+	return C::mul(IO::load(ptr), C::set1(IO::SCALE));
+}
+template<class C, lowrider_sample_format FORMAT>
+inline void convert_store(uint8_t *ptr, typename C::vec a) {
+	typedef sample_io<C, FORMAT> IO;
+	a = C::mul(a, C::set1(1.0f / IO::SCALE));
+	if(IO::CLAMP) {
+		a = C::min(C::max(a, C::set1(IO::LOW)), C::set1(IO::HIGH));
+	}
+	IO::store(ptr, a);
+}
+
+constexpr uint32_t convert_gcd(uint32_t a, uint32_t b) {
+	return (b == 0)? a : convert_gcd(b, a % b);
+}
+
+// Converts blocks of interleaved frames for a fixed number of channels. Each block contains just enough frames to fill
+// an integer number of vectors, so the loops that move the samples between the vectors and the planar buffers have a
+// fixed size and are fully unrolled. With one channel the vectors are stored directly.
+template<class C, lowrider_sample_format FORMAT, uint32_t CHANNELS>
+void convert_in_fixed(uint32_t channels, const void *data_in, float * const *data_out, uint32_t pos_out, uint32_t size) {
+	assert(channels == CHANNELS);
+	(void) channels;
+	constexpr uint32_t BYTES = sample_io<C, FORMAT>::BYTES;
+	constexpr uint32_t FRAMES = C::WIDTH / convert_gcd(C::WIDTH, CHANNELS), VECTORS = FRAMES * CHANNELS / C::WIDTH;
+	const uint8_t *in = (const uint8_t*) data_in;
+	float *out[CHANNELS];
+	for(uint32_t c = 0; c < CHANNELS; ++c) {
+		out[c] = data_out[c] + pos_out;
+	}
+	uint32_t i = 0;
+	for( ; i + FRAMES <= size; i += FRAMES) {
+		const uint8_t *block = in + i * CHANNELS * BYTES;
+		if(CHANNELS == 1) {
+			C::store(out[0] + i, convert_load<C, FORMAT>(block));
+		} else {
+			float temp[VECTORS * C::WIDTH];
+			for(uint32_t k = 0; k < VECTORS; ++k) {
+				C::store(temp + k * C::WIDTH, convert_load<C, FORMAT>(block + k * C::WIDTH * BYTES));
+			}
+			for(uint32_t f = 0; f < FRAMES; ++f) {
+				for(uint32_t c = 0; c < CHANNELS; ++c) {
+					out[c][i + f] = temp[f * CHANNELS + c];
+				}
+			}
+		}
+	}
+	for( ; i < size; ++i) {
+		for(uint32_t c = 0; c < CHANNELS; ++c) {
+			out[c][i] = convert_load<convert_scalar, FORMAT>(in + (i * CHANNELS + c) * BYTES);
+		}
+	}
+}
+
+// Handles any number of channels by converting WIDTH channels of a frame at a time.
+template<class C, lowrider_sample_format FORMAT>
+void convert_in_generic(uint32_t channels, const void *data_in, float * const *data_out, uint32_t pos_out, uint32_t size) {
+	constexpr uint32_t BYTES = sample_io<C, FORMAT>::BYTES;
+	const uint8_t *in = (const uint8_t*) data_in;
+	for(uint32_t i = 0; i < size; ++i) {
+		const uint8_t *frame = in + i * channels * BYTES;
+		uint32_t c = 0;
+		for( ; c + C::WIDTH <= channels; c += C::WIDTH) {
+			float temp[C::WIDTH];
+			C::store(temp, convert_load<C, FORMAT>(frame + c * BYTES));
+			for(uint32_t k = 0; k < C::WIDTH; ++k) {
+				data_out[c + k][pos_out + i] = temp[k];
+			}
+		}
+		for( ; c < channels; ++c) {
+			data_out[c][pos_out + i] = convert_load<convert_scalar, FORMAT>(frame + c * BYTES);
+		}
+	}
+}
+
+// See convert_in_fixed.
+template<class C, lowrider_sample_format FORMAT, uint32_t CHANNELS>
+void convert_out_fixed(uint32_t channels, const float * const *data_in, uint32_t pos_in, void *data_out, uint32_t size) {
+	assert(channels == CHANNELS);
+	(void) channels;
+	constexpr uint32_t BYTES = sample_io<C, FORMAT>::BYTES;
+	constexpr uint32_t FRAMES = C::WIDTH / convert_gcd(C::WIDTH, CHANNELS), VECTORS = FRAMES * CHANNELS / C::WIDTH;
+	const float *in[CHANNELS];
+	for(uint32_t c = 0; c < CHANNELS; ++c) {
+		in[c] = data_in[c] + pos_in;
+	}
+	uint8_t *out = (uint8_t*) data_out;
+	uint32_t i = 0;
+	for( ; i + FRAMES <= size; i += FRAMES) {
+		uint8_t *block = out + i * CHANNELS * BYTES;
+		if(CHANNELS == 1) {
+			convert_store<C, FORMAT>(block, C::load(in[0] + i));
+		} else {
+			float temp[VECTORS * C::WIDTH];
+			for(uint32_t f = 0; f < FRAMES; ++f) {
+				for(uint32_t c = 0; c < CHANNELS; ++c) {
+					temp[f * CHANNELS + c] = in[c][i + f];
+				}
+			}
+			for(uint32_t k = 0; k < VECTORS; ++k) {
+				convert_store<C, FORMAT>(block + k * C::WIDTH * BYTES, C::load(temp + k * C::WIDTH));
+			}
+		}
+	}
+	for( ; i < size; ++i) {
+		for(uint32_t c = 0; c < CHANNELS; ++c) {
+			convert_store<convert_scalar, FORMAT>(out + (i * CHANNELS + c) * BYTES, in[c][i]);
+		}
+	}
+}
+
+// See convert_in_generic.
+template<class C, lowrider_sample_format FORMAT>
+void convert_out_generic(uint32_t channels, const float * const *data_in, uint32_t pos_in, void *data_out, uint32_t size) {
+	constexpr uint32_t BYTES = sample_io<C, FORMAT>::BYTES;
+	uint8_t *out = (uint8_t*) data_out;
+	for(uint32_t i = 0; i < size; ++i) {
+		uint8_t *frame = out + i * channels * BYTES;
+		uint32_t c = 0;
+		for( ; c + C::WIDTH <= channels; c += C::WIDTH) {
+			float temp[C::WIDTH];
+			for(uint32_t k = 0; k < C::WIDTH; ++k) {
+				temp[k] = data_in[c + k][pos_in + i];
+			}
+			convert_store<C, FORMAT>(frame + c * BYTES, C::load(temp));
+		}
+		for( ; c < channels; ++c) {
+			convert_store<convert_scalar, FORMAT>(frame + c * BYTES, data_in[c][pos_in + i]);
+		}
+	}
+}
+
+// Calculates one output frame like firfilter_block, but converts it to a device sample format and stores it as an
+// interleaved frame. The samples are converted straight from the accumulators, so there is no planar output buffer.
+template<class V, class Interp, lowrider_sample_format FORMAT, uint32_t CHANNELS>
+inline void firfilter_device_block(uint32_t filter_length, const void *coef, const float *weights,
+								   const float * const *data_in, uint32_t pos_in, uint8_t *data_out) {
+	constexpr uint32_t BYTES = sample_io<convert_scalar, FORMAT>::BYTES;
+	float result[CHANNELS];
+	firfilter_sums<V, Interp, CHANNELS>(filter_length, coef, weights, data_in, pos_in, result);
+	for(uint32_t c = 0; c < CHANNELS; ++c) {
+		convert_store<convert_scalar, FORMAT>(data_out + c * BYTES, result[c]);
+	}
+}
+
+// See firfilter_channels.
+template<class V, class Interp, lowrider_sample_format FORMAT>
+void firfilter_device_channels(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights,
+							   const float * const *data_in, uint32_t pos_in, uint8_t *data_out) {
+	constexpr uint32_t BYTES = sample_io<convert_scalar, FORMAT>::BYTES;
+	uint32_t c = 0;
+	for( ; c + 8 <= channels; c += 8) {
+		firfilter_device_block<V, Interp, FORMAT, 8>(filter_length, coef, weights, data_in + c, pos_in, data_out + c * BYTES);
+	}
+	const float * const *block_in = data_in + c;
+	uint8_t *block_out = data_out + c * BYTES;
+	switch(channels - c) {
+		case 0: break;
+		case 1: firfilter_device_block<V, Interp, FORMAT, 1>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		case 2: firfilter_device_block<V, Interp, FORMAT, 2>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		case 3: firfilter_device_block<V, Interp, FORMAT, 3>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		case 4: firfilter_device_block<V, Interp, FORMAT, 4>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		case 5: firfilter_device_block<V, Interp, FORMAT, 5>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		case 6: firfilter_device_block<V, Interp, FORMAT, 6>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		case 7: firfilter_device_block<V, Interp, FORMAT, 7>(filter_length, coef, weights, block_in, pos_in, block_out); break;
+		default: assert(false);
+	}
+}
+
+template<class V, template<class, lowrider_resampler_storage, bool> class Interp, lowrider_sample_format FORMAT, uint32_t CHANNELS>
+void firfilter_device_fixed(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+							const float * const *data_in, uint32_t pos_in, void *data_out) {
+	assert(channels == CHANNELS);
+	(void) channels;
+	if(reverse) {
+		firfilter_device_block<V, Interp<V, lowrider_resampler_storage_f32, true>, FORMAT, CHANNELS>(filter_length, coef, weights, data_in, pos_in, (uint8_t*) data_out);
+	} else {
+		firfilter_device_block<V, Interp<V, lowrider_resampler_storage_f32, false>, FORMAT, CHANNELS>(filter_length, coef, weights, data_in, pos_in, (uint8_t*) data_out);
+	}
+}
+
+template<class V, template<class, lowrider_resampler_storage, bool> class Interp, lowrider_sample_format FORMAT>
+void firfilter_device_generic(uint32_t channels, uint32_t filter_length, const void *coef, const float *weights, bool reverse,
+							  const float * const *data_in, uint32_t pos_in, void *data_out) {
+	if(reverse) {
+		firfilter_device_channels<V, Interp<V, lowrider_resampler_storage_f32, true>, FORMAT>(channels, filter_length, coef, weights, data_in, pos_in, (uint8_t*) data_out);
+	} else {
+		firfilter_device_channels<V, Interp<V, lowrider_resampler_storage_f32, false>, FORMAT>(channels, filter_length, coef, weights, data_in, pos_in, (uint8_t*) data_out);
+	}
+}
+
+// Initializers for the tables of lowrider_resampler_kernels.
+#define LOWRIDER_FIRFILTER_TABLE_INTERP(V, Interp, S) { \
+	firfilter_generic<V, Interp, S>, \
+	firfilter_fixed<V, Interp, S, 1>, \
+	firfilter_fixed<V, Interp, S, 2>, \
+	firfilter_generic<V, Interp, S>, \
+	firfilter_fixed<V, Interp, S, 4>, \
+	firfilter_generic<V, Interp, S>, \
+	firfilter_fixed<V, Interp, S, 6>, \
+	firfilter_generic<V, Interp, S>, \
+	firfilter_fixed<V, Interp, S, 8>, \
+}
+#define LOWRIDER_FIRFILTER_TABLE_STORAGE(V, S) { \
+	LOWRIDER_FIRFILTER_TABLE_INTERP(V, interp_linear, S), \
+	LOWRIDER_FIRFILTER_TABLE_INTERP(V, interp_cubic, S), \
+	LOWRIDER_FIRFILTER_TABLE_INTERP(V, interp_none, S), \
+}
+#define LOWRIDER_FIRFILTER_TABLE(V) { \
+	LOWRIDER_FIRFILTER_TABLE_STORAGE(V, lowrider_resampler_storage_f32), \
+	LOWRIDER_FIRFILTER_TABLE_STORAGE(V, lowrider_resampler_storage_f16), \
+	LOWRIDER_FIRFILTER_TABLE_STORAGE(V, lowrider_resampler_storage_bf16), \
+}
+#define LOWRIDER_FIRFILTER_INTERLEAVED_TABLE_STORAGE(V, S) { \
+	firfilter_interleaved<V, interp_linear, S>, \
+	firfilter_interleaved<V, interp_cubic, S>, \
+	firfilter_interleaved<V, interp_none, S>, \
+}
+#define LOWRIDER_FIRFILTER_INTERLEAVED_TABLE(V) { \
+	LOWRIDER_FIRFILTER_INTERLEAVED_TABLE_STORAGE(V, lowrider_resampler_storage_f32), \
+	LOWRIDER_FIRFILTER_INTERLEAVED_TABLE_STORAGE(V, lowrider_resampler_storage_f16), \
+	LOWRIDER_FIRFILTER_INTERLEAVED_TABLE_STORAGE(V, lowrider_resampler_storage_bf16), \
+}
+#define LOWRIDER_FIRFILTER_INTEGER_TABLE(I) { \
+	firfilter_integer<I, lowrider_resampler_interpolation_linear>, \
+	firfilter_integer<I, lowrider_resampler_interpolation_cubic>, \
+	firfilter_integer<I, lowrider_resampler_interpolation_none>, \
+}
+#define LOWRIDER_FIRFILTER_DEVICE_TABLE_INTERP(V, Interp, F) { \
+	firfilter_device_generic<V, Interp, F>, \
+	firfilter_device_fixed<V, Interp, F, 1>, \
+	firfilter_device_fixed<V, Interp, F, 2>, \
+	firfilter_device_generic<V, Interp, F>, \
+	firfilter_device_fixed<V, Interp, F, 4>, \
+	firfilter_device_generic<V, Interp, F>, \
+	firfilter_device_fixed<V, Interp, F, 6>, \
+	firfilter_device_generic<V, Interp, F>, \
+	firfilter_device_fixed<V, Interp, F, 8>, \
+}
+#define LOWRIDER_FIRFILTER_DEVICE_TABLE_FORMAT(V, F) { \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_INTERP(V, interp_linear, F), \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_INTERP(V, interp_cubic, F), \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_INTERP(V, interp_none, F), \
+}
+#define LOWRIDER_FIRFILTER_DEVICE_TABLE(V) { \
+	{}, \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_FORMAT(V, lowrider_sample_format_f32), \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_FORMAT(V, lowrider_sample_format_s32), \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_FORMAT(V, lowrider_sample_format_s24), \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_FORMAT(V, lowrider_sample_format_s16), \
+	LOWRIDER_FIRFILTER_DEVICE_TABLE_FORMAT(V, lowrider_sample_format_s24_3le), \
+}
+#define LOWRIDER_CONVERT_TABLE_FORMAT(C, Func, F) { \
+	Func##_generic<C, F>, \
+	Func##_fixed<C, F, 1>, \
+	Func##_fixed<C, F, 2>, \
+	Func##_generic<C, F>, \
+	Func##_fixed<C, F, 4>, \
+	Func##_generic<C, F>, \
+	Func##_fixed<C, F, 6>, \
+	Func##_generic<C, F>, \
+	Func##_fixed<C, F, 8>, \
+}
+#define LOWRIDER_CONVERT_TABLE(C, Func) { \
+	{}, \
+	LOWRIDER_CONVERT_TABLE_FORMAT(C, Func, lowrider_sample_format_f32), \
+	LOWRIDER_CONVERT_TABLE_FORMAT(C, Func, lowrider_sample_format_s32), \
+	LOWRIDER_CONVERT_TABLE_FORMAT(C, Func, lowrider_sample_format_s24), \
+	LOWRIDER_CONVERT_TABLE_FORMAT(C, Func, lowrider_sample_format_s16), \
+	LOWRIDER_CONVERT_TABLE_FORMAT(C, Func, lowrider_sample_format_s24_3le), \
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resampler_kernels.h"
+#include "resampler_kernels_impl.h"
+
+namespace {
+
+struct simd_scalar {
+	typedef float vec;
+	static constexpr uint32_t WIDTH = 1;
+	static inline vec zero() { return 0.0f; }
+	static inline vec set1(float x) { return x; }
+	static inline vec load(const float *ptr) { return *ptr; }
+	static inline vec load_tail(const float*, uint32_t) { return 0.0f; }
+	static inline vec load_reverse(const float *ptr) { return *ptr; }
+	static inline vec load_tail_reverse(const float*, uint32_t) { return 0.0f; }
+	static inline void store(float *ptr, vec a) { *ptr = a; }
+	static inline vec add(vec a, vec b) { return a + b; }
+	static inline vec sub(vec a, vec b) { return a - b; }
+	static inline vec mul(vec a, vec b) { return a * b; }
+	static inline vec fmadd(vec a, vec b, vec c) { return a * b + c; }
+	static inline float hsum(vec a) { return a; }
+	typedef uint16_t half;
+	static inline half load_half(const uint16_t *ptr) { return *ptr; }
+	static inline half load_half_tail(const uint16_t*, uint32_t) { return 0; }
+	static inline half load_half_tail_reverse(const uint16_t*, uint32_t) { return 0; }
+	static inline vec widen_f16(half h) { return f16_to_float(h); }
+	static inline vec widen_bf16(half h) { return bf16_to_float(h); }
+	static inline vec reverse(vec a) { return a; }
+};
+
+typedef integer_scalar<int16_t, int32_t, float> integer_scalar_s16;
+typedef integer_scalar<int32_t, int64_t, double> integer_scalar_s32;
+
+}
+
+const lowrider_resampler_kernels g_resampler_kernels_scalar = {
+	"scalar",
+	LOWRIDER_FIRFILTER_TABLE(simd_scalar),
+	LOWRIDER_FIRFILTER_INTERLEAVED_TABLE(simd_scalar),
+	convolve<simd_scalar>,
+	LOWRIDER_FIRFILTER_INTEGER_TABLE(integer_scalar_s16),
+	LOWRIDER_FIRFILTER_INTEGER_TABLE(integer_scalar_s32),
+	LOWRIDER_FIRFILTER_DEVICE_TABLE(simd_scalar),
+	LOWRIDER_CONVERT_TABLE(convert_scalar, convert_in),
+	LOWRIDER_CONVERT_TABLE(convert_scalar, convert_out),
+};
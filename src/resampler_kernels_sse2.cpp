@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resampler_kernels.h"
+#include "resampler_kernels_impl.h"
+
+#include <emmintrin.h>
+
+namespace {
+
+struct simd_sse2 {
+	typedef __m128 vec;
+	static constexpr uint32_t WIDTH = 4;
+	static inline vec zero() { return _mm_setzero_ps(); }
+	static inline vec set1(float x) { return _mm_set1_ps(x); }
+	static inline vec load(const float *ptr) { return _mm_loadu_ps(ptr); }
+	static inline vec load_tail(const float*, uint32_t) { return _mm_setzero_ps(); } // never used, the filter length is a multiple of 4
+	static inline vec load_reverse(const float *ptr) {
+		__m128 a = _mm_loadu_ps(ptr - 3);
+		return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3));
+	}
+	static inline vec load_tail_reverse(const float*, uint32_t) { return _mm_setzero_ps(); } // never used, see load_tail
+	static inline void store(float *ptr, vec a) { _mm_storeu_ps(ptr, a); }
+	static inline vec add(vec a, vec b) { return _mm_add_ps(a, b); }
+	static inline vec sub(vec a, vec b) { return _mm_sub_ps(a, b); }
+	static inline vec mul(vec a, vec b) { return _mm_mul_ps(a, b); }
+	static inline vec fmadd(vec a, vec b, vec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static inline float hsum(vec a) {
+		__m128 b = _mm_add_ps(a, _mm_movehl_ps(a, a));
+		return _mm_cvtss_f32(_mm_add_ss(b, _mm_shuffle_ps(b, b, 0x55)));
+	}
+	typedef __m128i half; // only the low 4 values are used
+	static inline half load_half(const uint16_t *ptr) { return _mm_loadl_epi64((const __m128i*) ptr); }
+	static inline half load_half_tail(const uint16_t*, uint32_t) { return _mm_setzero_si128(); } // never used, see load_tail
+	static inline half load_half_tail_reverse(const uint16_t*, uint32_t) { return _mm_setzero_si128(); } // never used, see load_tail
+	static inline vec widen_f16(half h) {
+		// SSE2 has no F16C, this uses the same method as f16_to_float
+		__m128i x = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+		__m128i sign = _mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x8000)), 16);
+		__m128i magnitude = _mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x7fff)), 13);
+		__m128 f = _mm_mul_ps(_mm_castsi128_ps(magnitude), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+		return _mm_or_ps(f, _mm_castsi128_ps(sign));
+	}
+	static inline vec widen_bf16(half h) { return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), h)); }
+	static inline vec reverse(vec a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)); }
+};
+
+struct integer_sse2_s16 {
+	typedef int16_t sample;
+	typedef int32_t acc;
+	typedef float real;
+	typedef __m128i vec;
+	static constexpr uint32_t WIDTH = 8;
+	static inline vec zero() { return _mm_setzero_si128(); }
+	static inline vec load(const sample *ptr) { return _mm_loadu_si128((const __m128i*) ptr); }
+	static inline vec load_tail(const sample *ptr, uint32_t) { return _mm_loadl_epi64((const __m128i*) ptr); } // always 4 samples
+	static inline vec madd(vec sum, vec a, vec b) { return _mm_add_epi32(sum, _mm_madd_epi16(a, b)); }
+	static inline vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+	static inline acc hsum(vec a) {
+		__m128i b = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtsi128_si32(_mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+};
+
+// SSE2 has no signed 32x32->64 bit multiplication, so int32 data uses the scalar implementation.
+typedef integer_scalar<int32_t, int64_t, double> integer_scalar_s32;
+
+// SSE2 has no byte shuffles, so packed 24-bit samples are assembled with scalar code.
+struct convert_sse2 {
+	typedef __m128 vec;
+	static constexpr uint32_t WIDTH = 4;
+	static inline vec set1(float x) { return _mm_set1_ps(x); }
+	static inline vec mul(vec a, vec b) { return _mm_mul_ps(a, b); }
+	static inline vec min(vec a, vec b) { return _mm_min_ps(a, b); }
+	static inline vec max(vec a, vec b) { return _mm_max_ps(a, b); }
+	static inline vec load(const float *ptr) { return _mm_loadu_ps(ptr); }
+	static inline void store(float *ptr, vec a) { _mm_storeu_ps(ptr, a); }
+	static inline vec load_s32(const int32_t *ptr) { return _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) ptr)); }
+	static inline vec load_s16(const int16_t *ptr) {
+		__m128i x = _mm_loadl_epi64((const __m128i*) ptr);
+		return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+	}
+	static inline vec load_s24_3le(const uint8_t *ptr) {
+		return _mm_cvtepi32_ps(_mm_setr_epi32(unpack_s24_3le(ptr), unpack_s24_3le(ptr + 3), unpack_s24_3le(ptr + 6), unpack_s24_3le(ptr + 9)));
+	}
+	static inline void store_s32(int32_t *ptr, vec a) { _mm_storeu_si128((__m128i*) ptr, _mm_cvtps_epi32(a)); }
+	static inline void store_s16(int16_t *ptr, vec a) {
+		__m128i x = _mm_cvtps_epi32(a);
+		_mm_storel_epi64((__m128i*) ptr, _mm_packs_epi32(x, x));
+	}
+	static inline void store_s24_3le(uint8_t *ptr, vec a) {
+		alignas(16) int32_t temp[4];
+		_mm_store_si128((__m128i*) temp, _mm_cvtps_epi32(a));
+		for(uint32_t k = 0; k < 4; ++k) {
+			pack_s24_3le(ptr + 3 * k, temp[k]);
+		}
+	}
+};
+
+}
+
+const lowrider_resampler_kernels g_resampler_kernels_sse2 = {
+	"sse2",
+	LOWRIDER_FIRFILTER_TABLE(simd_sse2),
+	LOWRIDER_FIRFILTER_INTERLEAVED_TABLE(simd_sse2),
+	convolve<simd_sse2>,
+	LOWRIDER_FIRFILTER_INTEGER_TABLE(integer_sse2_s16),
+	LOWRIDER_FIRFILTER_INTEGER_TABLE(integer_scalar_s32),
+	LOWRIDER_FIRFILTER_DEVICE_TABLE(simd_sse2),
+	LOWRIDER_CONVERT_TABLE(convert_sse2, convert_in),
+	LOWRIDER_CONVERT_TABLE(convert_sse2, convert_out),
+};
@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resampler_rebuilder.h"
+
+#include <cerrno>
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sched.h>
+
+lowrider_resampler_rebuilder::lowrider_resampler_rebuilder(uint32_t rate_out, lowrider_resampler_engine engine, bool multistage, uint32_t block_size,
+														   float passband, float stopband, float beta, float gain,
+														   lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, uint32_t farrow_taps,
+														   lowrider_resampler_storage storage, bool fixed_point, lowrider_resampler_fixed_point fixed_point_type,
+														   uint32_t history_max, uint32_t reserve_size, bool reserve_interleaved, uint32_t reserve_stride,
+														   const std::string &cache_dir)
+	: m_stop(false), m_busy(false), m_request(0), m_ready(nullptr), m_retired(nullptr) {
+
+	m_rate_out = rate_out;
+	m_block_size = block_size;
+	m_farrow_taps = farrow_taps;
+	m_history_max = history_max;
+	m_reserve_size = reserve_size;
+	m_reserve_stride = reserve_stride;
+	m_reserve_interleaved = reserve_interleaved;
+	m_engine = engine;
+	m_multistage = multistage;
+	m_fixed_point = fixed_point;
+	m_passband = passband;
+	m_stopband = stopband;
+	m_beta = beta;
+	m_gain = gain;
+	m_interpolation = interpolation;
+	m_phase = phase;
+	m_storage = storage;
+	m_fixed_point_type = fixed_point_type;
+	m_cache_dir = cache_dir;
+
+	// start the worker thread
+	if(sem_init(&m_semaphore, 0, 0) != 0) {
+		throw std::runtime_error("failed to create semaphore");
+	}
+	try {
+		m_thread = std::thread(&lowrider_resampler_rebuilder::worker_thread, this);
+	} catch(...) {
+		sem_destroy(&m_semaphore);
+		throw;
+	}
+
+}
+
+lowrider_resampler_rebuilder::~lowrider_resampler_rebuilder() {
+
+	// stop the worker thread
+	m_stop = true;
+	sem_post(&m_semaphore);
+	m_thread.join();
+	sem_destroy(&m_semaphore);
+
+	// destroy the remaining chains
+	delete m_ready.exchange(nullptr);
+	delete m_retired.exchange(nullptr);
+
+}
+
+bool lowrider_resampler_rebuilder::request(uint32_t rate_in) {
+	bool expected = false;
+	if(!m_busy.compare_exchange_strong(expected, true))
+		return false;
+	m_request = rate_in;
+	sem_post(&m_semaphore);
+	return true;
+}
+
+lowrider_resampler_chain* lowrider_resampler_rebuilder::take() {
+	return m_ready.exchange(nullptr);
+}
+
+void lowrider_resampler_rebuilder::retire(lowrider_resampler_chain *chain) {
+	m_retired = chain;
+	sem_post(&m_semaphore);
+}
+
+void lowrider_resampler_rebuilder::worker_thread() {
+
+	// The worker thread inherits the real-time priority of the process, but designing a filter bank can take a long time,
+	// so it should never compete with the realtime thread. The threads that generate the filter bank inherit this policy.
+	sched_param param = {};
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+	for( ; ; ) {
+
+		// wait for work
+		while(sem_wait(&m_semaphore) != 0) {
+			if(errno != EINTR) {
+				std::cerr << "Warning: failed to wait for semaphore, stopping resampler rebuilder" << std::endl;
+				return;
+			}
+		}
+		if(m_stop)
+			return;
+
+		// destroy the retired chain, which ends the rebuild
+		lowrider_resampler_chain *retired = m_retired.exchange(nullptr);
+		if(retired != nullptr) {
+			delete retired;
+			m_busy = false;
+		}
+
+		// create the requested chain
+		uint32_t rate_in = m_request.exchange(0);
+		if(rate_in != 0) {
+			lowrider_resampler_chain *chain = create_chain(rate_in);
+			if(chain == nullptr) {
+				m_busy = false;
+			} else {
+				m_ready = chain;
+			}
+		}
+
+	}
+
+}
+
+lowrider_resampler_chain* lowrider_resampler_rebuilder::create_chain(uint32_t rate_in) {
+	try {
+		std::unique_ptr<lowrider_resampler_chain> chain(new lowrider_resampler_chain(
+			rate_in, m_rate_out, m_engine, m_multistage, m_block_size, m_passband, m_stopband, m_beta, m_gain,
+			m_interpolation, m_phase, m_farrow_taps, m_cache_dir));
+		chain->set_storage(m_storage);
+		if(m_fixed_point) {
+			if(!chain->supports_fixed_point()) {
+				std::cerr << "Warning: resampler for " << rate_in << " Hz does not support the fixed-point path, keeping the old resampler" << std::endl;
+				return nullptr;
+			}
+			chain->prepare_fixed_point(m_fixed_point_type);
+		}
+		if(chain->get_filter_length() > m_history_max) {
+			std::cerr << "Warning: resampler for " << rate_in << " Hz needs more history than the input buffer can hold, keeping the old resampler" << std::endl;
+			return nullptr;
+		}
+		chain->reserve(m_reserve_size, m_reserve_interleaved, m_reserve_stride);
+		std::cerr << "Info: created resampler for " << rate_in << " Hz" << std::endl;
+		return chain.release();
+	} catch(const std::exception &e) {
+		std::cerr << "Warning: failed to create resampler for " << rate_in << " Hz: " << e.what() << std::endl;
+		return nullptr;
+	}
+}
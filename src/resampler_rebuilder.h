@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "resampler_chain.h"
+#include "resampler_types.h"
+
+#include <cstdint>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <semaphore.h>
+
+/*
+This class creates new resampler chains on a background thread, so the sample rate of the loopback can be changed
+without interrupting the stream. lowrider_resampler::set_ratio doesn't regenerate the filter bank, so it is only suitable
+for small changes (clock drift). A large change, such as an S/PDIF source that switches between 44100 Hz and 48000 Hz,
+needs a new filter bank, which can take much longer than one period to design and allocates memory.
+
+The realtime thread calls request() with the new input sample rate. The worker thread then creates the new chain with
+the parameters that were passed to the constructor, and publishes it through an atomic pointer. The realtime thread
+picks it up with take() and crossfades from the old chain to the new one, after which it hands the old chain back with
+retire() so it is destroyed on the worker thread as well. All three functions are lock-free and never allocate or block,
+the worker is woken up with a semaphore. Only one rebuild can be in progress at a time: request() returns false until
+the previous chain has been retired (or the rebuild has failed).
+
+The new chain is checked against the limits of the buffers of the caller: it may not need more than 'history_max' input
+samples of history, and if a fixed-point type is given it must support the fixed-point path. Chains that don't meet
+these requirements are discarded with a warning, the caller should then keep using the old chain. The buffers between
+the stages of the new chain are allocated on the worker thread as well (see lowrider_resampler_chain::reserve), with the
+size and layout that the caller will use.
+*/
+
+class lowrider_resampler_rebuilder {
+
+private:
+	uint32_t m_rate_out, m_block_size, m_farrow_taps, m_history_max, m_reserve_size, m_reserve_stride;
+	lowrider_resampler_engine m_engine;
+	bool m_multistage, m_fixed_point, m_reserve_interleaved;
+	float m_passband, m_stopband, m_beta, m_gain;
+	lowrider_resampler_interpolation m_interpolation;
+	lowrider_resampler_phase m_phase;
+	lowrider_resampler_storage m_storage;
+	lowrider_resampler_fixed_point m_fixed_point_type;
+	std::string m_cache_dir;
+
+	sem_t m_semaphore;
+	std::thread m_thread;
+
+	std::atomic<bool> m_stop, m_busy;
+	std::atomic<uint32_t> m_request;
+	std::atomic<lowrider_resampler_chain*> m_ready, m_retired;
+
+private:
+	void worker_thread();
+
+	// Creates and checks a new chain, returns null if the chain can't be used.
+	lowrider_resampler_chain* create_chain(uint32_t rate_in);
+
+public:
+	// Starts the worker thread. The parameters are the same as for lowrider_resampler_chain, except for the input sample
+	// rate, which is passed to request(). If fixed_point is true, the new chains are prepared for the given fixed-point
+	// type. The reserve parameters are passed to lowrider_resampler_chain::reserve.
+	lowrider_resampler_rebuilder(uint32_t rate_out, lowrider_resampler_engine engine, bool multistage, uint32_t block_size,
+								 float passband, float stopband, float beta, float gain,
+								 lowrider_resampler_interpolation interpolation, lowrider_resampler_phase phase, uint32_t farrow_taps,
+								 lowrider_resampler_storage storage, bool fixed_point, lowrider_resampler_fixed_point fixed_point_type,
+								 uint32_t history_max, uint32_t reserve_size, bool reserve_interleaved, uint32_t reserve_stride,
+								 const std::string &cache_dir);
+
+	// Stops the worker thread and destroys any chain that wasn't taken or retired yet.
+	~lowrider_resampler_rebuilder();
+
+	// Requests a new chain for the given input sample rate. Returns false if a rebuild is already in progress.
+	bool request(uint32_t rate_in);
+
+	// Returns the new chain if it is ready, otherwise null. The caller becomes the owner of the chain, and must eventually
+	// pass the old chain to retire().
+	lowrider_resampler_chain* take();
+
+	// Destroys a chain on the worker thread and ends the rebuild.
+	void retire(lowrider_resampler_chain *chain);
+
+};
@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Interpolation method used to calculate filters between the rows of the filter bank. 'none' is only used for exact
+// rational ratios, where the filter bank contains a row for every phase.
+enum lowrider_resampler_interpolation {
+	lowrider_resampler_interpolation_linear,
+	lowrider_resampler_interpolation_cubic,
+	lowrider_resampler_interpolation_none,
+};
+
+// Phase response of the resampler filter.
+enum lowrider_resampler_phase {
+	lowrider_resampler_phase_linear,
+	lowrider_resampler_phase_minimum,
+};
+
+// Resampler engine used by lowrider_resampler_chain.
+// - polyphase: a single variable-rate resampler.
+// - rational: an exact rational resampler for the nominal ratio, combined with a short variable-rate resampler that only
+//   corrects the clock drift.
+// - fft: a long fixed lowpass filter applied in the frequency domain, combined with a short variable-rate resampler. This is
+//   only faster for very long filters that are processed in large blocks.
+// - farrow: a short Lagrange interpolator in Farrow form without a filter bank, with a latency of only a few samples. This
+//   is only possible if the input and output rates are the same, and it has no stopband.
+// - slip: no filter at all, the clock drift is corrected by dropping or repeating single samples at quiet points. This is
+//   almost as cheap as a copy, and it is only possible if the input and output rates are the same.
+// - auto: the fastest engine for the given sample rates, filter parameters and block size (see lowrider_resampler_chain).
+enum lowrider_resampler_engine {
+	lowrider_resampler_engine_auto,
+	lowrider_resampler_engine_polyphase,
+	lowrider_resampler_engine_rational,
+	lowrider_resampler_engine_fft,
+	lowrider_resampler_engine_farrow,
+	lowrider_resampler_engine_slip,
+};
+
+// Integer sample types supported by the fixed-point path of lowrider_resampler (see prepare_fixed_point).
+enum lowrider_resampler_fixed_point {
+	lowrider_resampler_fixed_point_s16,
+	lowrider_resampler_fixed_point_s32,
+};
+
+// Storage format of the coefficients of the filter bank. The 16-bit formats halve the memory bandwidth and cache footprint
+// of the filter bank, the coefficients are converted back to float by the kernels.
+// - f32: single precision (24-bit mantissa).
+// - f16: IEEE half precision (11-bit mantissa, 5-bit exponent).
+// - bf16: bfloat16, i.e. the upper half of a float (8-bit mantissa, 8-bit exponent).
+enum lowrider_resampler_storage {
+	lowrider_resampler_storage_f32,
+	lowrider_resampler_storage_f16,
+	lowrider_resampler_storage_bf16,
+};
@@ -19,10 +19,25 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <cstdint>
+
 enum lowrider_sample_format {
 	lowrider_sample_format_any,
 	lowrider_sample_format_f32,
 	lowrider_sample_format_s32,
 	lowrider_sample_format_s24,
 	lowrider_sample_format_s16,
+	lowrider_sample_format_s24_3le,
 };
+
+// Returns the size of one sample in bytes, or zero for 'any'.
+inline uint32_t get_sample_format_bytes(lowrider_sample_format format) {
+	switch(format) {
+		case lowrider_sample_format_f32: return 4;
+		case lowrider_sample_format_s32: return 4;
+		case lowrider_sample_format_s24: return 4;
+		case lowrider_sample_format_s16: return 2;
+		case lowrider_sample_format_s24_3le: return 3;
+		default: return 0;
+	}
+}
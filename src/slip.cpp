@@ -0,0 +1,293 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "slip.h"
+
+#include "miscmath.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+#include <algorithm>
+
+// Copies samples and applies the gain.
+static void copy_samples(float *out, const float *in, size_t size, float gain) {
+	if(gain == 1.0f) {
+		std::copy_n(in, size, out);
+	} else {
+		for(size_t i = 0; i < size; ++i) {
+			out[i] = in[i] * gain;
+		}
+	}
+}
+
+lowrider_slip::lowrider_slip(float ratio, float gain) {
+	assert(std::isfinite(ratio) && ratio > 0.0f);
+
+	m_ratio = rint64((float) RATIO_ONE * ratio);
+	m_gain = gain;
+
+	reset();
+}
+
+inline uint32_t lowrider_slip::advance() {
+	uint64_t new_offset = (uint64_t) m_offset + m_ratio;
+	m_offset = (uint32_t) new_offset;
+	uint32_t skip = (uint32_t) (new_offset >> 32);
+	m_delay += 1 - (int32_t) skip;
+
+	// finish the crossfade
+	if(m_slip != 0 && m_fade == FADE_LENGTH) {
+		m_delay += m_slip;
+		m_slip = 0;
+		m_fade = 0;
+	}
+
+	// If the ratio is too far from 1, the slips can't keep up. The delay must stay inside the filter, so in that case the
+	// signal simply jumps.
+	m_delay = clamp(m_delay, (int32_t) 1, (int32_t) FILTER_LENGTH - 2);
+
+	return skip;
+}
+
+inline uint32_t lowrider_slip::advance(uint32_t size) {
+	uint64_t new_offset = (uint64_t) m_offset + m_ratio * size;
+	m_offset = (uint32_t) new_offset;
+	uint32_t skip = (uint32_t) (new_offset >> 32);
+	m_delay += (int32_t) size - (int32_t) skip;
+	return skip;
+}
+
+uint32_t lowrider_slip::get_limit(int32_t low, int32_t high) {
+	// the delay after n output samples is m_delay - floor((m_offset + n * (m_ratio - RATIO_ONE)) / RATIO_ONE)
+	int64_t step = (int64_t) m_ratio - (int64_t) RATIO_ONE;
+	int64_t margin;
+	if(step > 0) {
+		margin = (int64_t) (m_delay - low + 1) * (int64_t) RATIO_ONE - 1 - (int64_t) m_offset;
+	} else if(step < 0) {
+		margin = (int64_t) (high - m_delay) * (int64_t) RATIO_ONE + (int64_t) m_offset;
+	} else {
+		return (m_delay >= low && m_delay <= high)? UINT32_MAX : 0;
+	}
+	if(margin < std::abs(step))
+		return 0;
+	return (uint32_t) std::min(margin / std::abs(step), (int64_t) UINT32_MAX);
+}
+
+uint32_t lowrider_slip::prepare_block(uint32_t size_in, uint32_t size_out, bool &search, bool &force) {
+
+	// The delay may move one sample away from DELAY_CENTER without a slip. Beyond that, the resampler searches for a quiet
+	// point until the delay reaches DELAY_CENTER +/- DELAY_FORCE.
+	uint32_t limit = get_limit(DELAY_CENTER - 1, DELAY_CENTER + 1);
+	search = (limit == 0);
+	if(search != m_search) {
+		m_search = search;
+		m_envelope = 0.0f;
+	}
+	int32_t low = DELAY_CENTER - 1;
+	if(search) {
+		low = DELAY_CENTER - DELAY_FORCE + 1;
+		limit = get_limit(low, DELAY_CENTER + DELAY_FORCE - 1);
+	}
+	force = (search && limit == 0);
+
+	// The input position can be up to one sample ahead of the output position for every sample that the delay drops below
+	// the lower limit.
+	uint32_t ahead = (uint32_t) std::max(0, m_delay - low);
+	uint32_t input_limit = size_in - FILTER_LENGTH + 1;
+	return std::min(std::min(limit, size_out), (input_limit > ahead)? input_limit - ahead : 0);
+}
+
+inline bool lowrider_slip::update_search(float level) {
+	m_envelope = std::max(level, m_envelope * ENVELOPE_DECAY);
+	return (level <= m_envelope * QUIET_RATIO);
+}
+
+inline void lowrider_slip::start_slip() {
+	m_slip = (m_delay < DELAY_CENTER)? 1 : -1;
+	m_fade = 0;
+	m_search = false;
+}
+
+void lowrider_slip::reset() {
+	m_offset = 0;
+	m_delay = DELAY_CENTER;
+	m_slip = 0;
+	m_fade = 0;
+	m_search = false;
+	m_envelope = 0.0f;
+}
+
+std::pair<uint32_t, uint32_t> lowrider_slip::resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+													  float * const *data_out, uint32_t size_out) {
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + FILTER_LENGTH <= size_in && pos_out < size_out) {
+
+		// produce one sample of the crossfade
+		if(m_slip != 0) {
+			uint32_t pos = pos_in + (uint32_t) m_delay;
+			float w = (float) (m_fade + 1) / (float) (FADE_LENGTH + 1);
+			for(uint32_t c = 0; c < channels; ++c) {
+				float a = data_in[c][pos], b = data_in[c][pos + m_slip];
+				data_out[c][pos_out] = (a + (b - a) * w) * m_gain;
+			}
+			++m_fade;
+			pos_in += advance();
+			++pos_out;
+			continue;
+		}
+
+		// if a slip is needed, look for a quiet point in the block
+		bool search, slip;
+		uint32_t size = prepare_block(size_in - pos_in, size_out - pos_out, search, slip);
+		if(search && size != 0) {
+			uint32_t pos = pos_in + (uint32_t) m_delay;
+			for(uint32_t i = 0; i < size; ++i) {
+				float level = 0.0f;
+				for(uint32_t c = 0; c < channels; ++c) {
+					level = std::max(level, std::fabs(data_in[c][pos + i]));
+				}
+				if(update_search(level)) {
+					size = i;
+					slip = true;
+					break;
+				}
+			}
+		}
+
+		// copy the block
+		if(size != 0) {
+			for(uint32_t c = 0; c < channels; ++c) {
+				copy_samples(data_out[c] + pos_out, data_in[c] + pos_in + m_delay, size, m_gain);
+			}
+			pos_in += advance(size);
+			pos_out += size;
+		}
+		if(slip) {
+			start_slip();
+			continue;
+		}
+
+		// There is not enough input data to copy a block, so copy a single sample. This doesn't change the search.
+		if(size == 0) {
+			uint32_t pos = pos_in + (uint32_t) m_delay;
+			for(uint32_t c = 0; c < channels; ++c) {
+				data_out[c][pos_out] = data_in[c][pos] * m_gain;
+			}
+			pos_in += advance();
+			++pos_out;
+		}
+
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+std::pair<uint32_t, uint32_t> lowrider_slip::resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+																  float *data_out, uint32_t size_out) {
+	uint32_t pos_in = 0, pos_out = 0;
+	while(pos_in + FILTER_LENGTH <= size_in && pos_out < size_out) {
+
+		// produce one sample of the crossfade
+		if(m_slip != 0) {
+			const float *in = data_in + (size_t) (pos_in + m_delay) * stride;
+			const float *in2 = in + (std::ptrdiff_t) m_slip * (std::ptrdiff_t) stride;
+			float *out = data_out + (size_t) pos_out * stride;
+			float w = (float) (m_fade + 1) / (float) (FADE_LENGTH + 1);
+			for(uint32_t c = 0; c < stride; ++c) {
+				out[c] = (in[c] + (in2[c] - in[c]) * w) * m_gain;
+			}
+			++m_fade;
+			pos_in += advance();
+			++pos_out;
+			continue;
+		}
+
+		// if a slip is needed, look for a quiet point in the block
+		bool search, slip;
+		uint32_t size = prepare_block(size_in - pos_in, size_out - pos_out, search, slip);
+		if(search && size != 0) {
+			const float *in = data_in + (size_t) (pos_in + m_delay) * stride;
+			for(uint32_t i = 0; i < size; ++i) {
+				float level = 0.0f;
+				for(uint32_t c = 0; c < stride; ++c) {
+					level = std::max(level, std::fabs(in[(size_t) i * stride + c]));
+				}
+				if(update_search(level)) {
+					size = i;
+					slip = true;
+					break;
+				}
+			}
+		}
+
+		// copy the block
+		if(size != 0) {
+			copy_samples(data_out + (size_t) pos_out * stride, data_in + (size_t) (pos_in + m_delay) * stride, (size_t) size * stride, m_gain);
+			pos_in += advance(size);
+			pos_out += size;
+		}
+		if(slip) {
+			start_slip();
+			continue;
+		}
+
+		// There is not enough input data to copy a block, so copy a single sample. This doesn't change the search.
+		if(size == 0) {
+			copy_samples(data_out + (size_t) pos_out * stride, data_in + (size_t) (pos_in + m_delay) * stride, stride, m_gain);
+			pos_in += advance();
+			++pos_out;
+		}
+
+	}
+	return std::make_pair(pos_in, pos_out);
+}
+
+uint32_t lowrider_slip::calculate_size_in(uint32_t size_out) {
+	return (uint32_t) (((uint64_t) m_offset + m_ratio * size_out) / RATIO_ONE) + (FILTER_LENGTH - 1);
+}
+
+uint32_t lowrider_slip::calculate_size_out(uint32_t size_in) {
+	return (size_in < FILTER_LENGTH)? 0 : ((uint64_t) (size_in - (FILTER_LENGTH - 1)) * RATIO_ONE - (uint64_t) m_offset - 1) / m_ratio + 1;
+}
+
+float lowrider_slip::get_latency_in() {
+	return (float) m_delay + (float) (m_slip * (int32_t) m_fade) / (float) (FADE_LENGTH + 1);
+}
+
+float lowrider_slip::get_latency_out() {
+	return get_latency_in() * (float) RATIO_ONE / (float) m_ratio;
+}
+
+double lowrider_slip::get_ratio() {
+	return (double) m_ratio / (double) RATIO_ONE;
+}
+
+void lowrider_slip::set_ratio(double ratio) {
+	m_ratio = rint64((double) RATIO_ONE * ratio);
+}
+
+uint32_t lowrider_slip::get_filter_length() {
+	return FILTER_LENGTH;
+}
+
+float lowrider_slip::get_filter_delay() {
+	// the delay stays close to DELAY_CENTER, the extra 0.5 matches lowrider_halfband
+	return (float) DELAY_CENTER + 0.5f;
+}
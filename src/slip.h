@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2020 Maarten Baert <info@maartenbaert.be>
+
+This file is part of lowrider.
+
+lowrider is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lowrider is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <utility>
+
+/*
+This is a drift corrector for equal input and output sample rates that doesn't filter the signal at all. The input is
+copied to the output unchanged, and the clock drift is corrected by occasionally dropping or repeating a single input
+sample, with a short crossfade (FADE_LENGTH samples) between the signal before and after the slip. This is much cheaper
+than any real resampler (most of the time it is just a copy), but every slip causes a small discontinuity, so it is only
+meant for systems where the CPU time of the other engines is not acceptable.
+
+The input position advances exactly like a regular resampler with the same ratio, so the consumed input and the
+produced output don't depend on the signal. The sample that is copied to the output is read at a variable delay from the
+input position, which changes by one sample whenever the input position skips or repeats a sample. When the delay
+moves more than one sample away from DELAY_CENTER, the resampler starts looking for a quiet point to slip, i.e. a
+sample whose level (the highest absolute value of all channels) is below QUIET_RATIO times the envelope of the signal.
+Slipping at a quiet point (e.g. near a zero crossing) makes the discontinuity much less audible. If no quiet point is
+found before the delay reaches DELAY_CENTER +/- DELAY_FORCE, the slip is done immediately. The search only
+calculates the level of one sample per output sample, so it is still very cheap.
+
+The user must keep FILTER_LENGTH samples of input data for the next invocation. Every output sample is a copy of the
+input sample at m_delay (relative to the first input sample that is still needed), so get_latency_in() returns m_delay
+plus the progress of the crossfade during a slip. The fractional drift in m_offset is not included, since it doesn't
+move the copied sample. get_filter_delay() returns DELAY_CENTER + 0.5, i.e. the average latency plus 0.5.
+*/
+
+class lowrider_slip {
+
+private:
+	uint64_t m_ratio;
+	uint32_t m_offset;
+	float m_gain;
+
+	// position of the next output sample relative to the input position
+	int32_t m_delay;
+
+	// current slip direction (+1 to drop a sample, -1 to repeat a sample, 0 if there is no crossfade in progress) and the
+	// number of crossfade samples that have been produced
+	int32_t m_slip;
+	uint32_t m_fade;
+
+	// whether the resampler is looking for a quiet point, and the envelope of the signal during the search
+	bool m_search;
+	float m_envelope;
+
+private:
+	// Advances to the next output sample and returns the number of input samples that should be skipped. This also
+	// finishes the crossfade.
+	uint32_t advance();
+
+	// Advances by 'size' output samples without a crossfade.
+	uint32_t advance(uint32_t size);
+
+	// Returns the number of output samples that can be produced before the delay leaves the range [low, high].
+	uint32_t get_limit(int32_t low, int32_t high);
+
+	// Returns the number of samples that can be copied in one block, given the remaining input and output. Sets 'search'
+	// if a quiet point should be found in the block, and 'force' if the slip can't be delayed any further.
+	uint32_t prepare_block(uint32_t size_in, uint32_t size_out, bool &search, bool &force);
+
+	// Updates the envelope with the level of the next output sample. Returns true if the sample is a quiet point.
+	bool update_search(float level);
+
+	// Starts the crossfade towards DELAY_CENTER.
+	void start_slip();
+
+public:
+	static constexpr uint32_t FILTER_LENGTH = 14;
+	static constexpr int32_t DELAY_CENTER = 6;
+	static constexpr int32_t DELAY_FORCE = 3;
+	static constexpr uint32_t FADE_LENGTH = 16;
+	static constexpr float QUIET_RATIO = 0.125f;
+	static constexpr float ENVELOPE_DECAY = 0.995f;
+	static constexpr uint64_t RATIO_ONE = (uint64_t) 1 << 32;
+
+public:
+	// Creates the resampler.
+	lowrider_slip(float ratio, float gain);
+
+	// See lowrider_resampler.
+	void reset();
+	std::pair<uint32_t, uint32_t> resample(uint32_t channels, const float * const *data_in, uint32_t size_in,
+										   float * const *data_out, uint32_t size_out);
+	std::pair<uint32_t, uint32_t> resample_interleaved(uint32_t stride, const float *data_in, uint32_t size_in,
+													   float *data_out, uint32_t size_out);
+	uint32_t calculate_size_in(uint32_t size_out);
+	uint32_t calculate_size_out(uint32_t size_in);
+	float get_latency_in();
+	float get_latency_out();
+	double get_ratio();
+	void set_ratio(double ratio);
+	uint32_t get_filter_length();
+	float get_filter_delay();
+
+};
@@ -29,6 +29,12 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 #include <sys/timerfd.h>
 #include <unistd.h>
 
+uint64_t get_time_nano() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (uint64_t) ts.tv_sec * (uint64_t) 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
 lowrider_timer::lowrider_timer() {
 	m_timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
 	if(m_timer == -1) {
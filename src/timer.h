@@ -21,6 +21,9 @@ along with lowrider.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cstdint>
 
+// Returns the current time of CLOCK_MONOTONIC_RAW in nanoseconds.
+uint64_t get_time_nano();
+
 class lowrider_timer {
 
 private: